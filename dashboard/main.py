@@ -4,17 +4,75 @@ import numpy as np
 import os
 import time
 import re
+import sys
+
+# The query client is generated in the mock folder
+sys.path.append('../mock')
+try:
+    import grpc
+    import data_analytics_pb2 as pb2, data_analytics_pb2_grpc as pb2_grpc
+except ImportError:
+    grpc = None
 
 BASE_FOLDER = "../processed/"
 FILE_NAMES = ["CountView", "CountBuy", "BuyRanking", "ProdView", "ViewRanking",
               "times_CountView", "times_CountBuy", "times_BuyRanking", "times_ProdView", "times_ViewRanking"]
 UPDATE_INTERVAL = 3 # In seconds
 
+SERVER_ADDRESS = "localhost:50051"
+QUERY_TIMEOUT = 0.5 # In seconds
+# Time range of each result, in seconds, and how many values of the rankings are shown
+RESULT_RANGES = {"CountView": 60, "CountBuy": 60, "ProdView": 60, "BuyRanking": 3600, "ViewRanking": 3600}
+RANKINGS = ["ProdView", "BuyRanking", "ViewRanking"]
+TOP_K = {"BuyRanking": 10, "ViewRanking": 10}
+
 def load_data(file_name):
     """Load data from a CSV file."""
     return pd.read_csv(BASE_FOLDER + file_name + ".csv")
 
+@st.cache_resource
+def query_stub():
+    """Connect to the query service of the server, if the client is available."""
+    if grpc is None:
+        return None
+    return pb2_grpc.QueryServiceStub(grpc.insecure_channel(SERVER_ADDRESS))
+
+def query_result(stub, name):
+    """Query a result from the server memory, in the same layout as its file."""
+    base_name = name.removeprefix("times_")
+    now_ms = int(time.time() * 1000)
+    request = pb2.QueryRequest(result=name, top_k=TOP_K.get(name, 0),
+                               from_timestamp=now_ms - RESULT_RANGES[base_name] * 1000)
+    response = stub.Query(request, timeout=QUERY_TIMEOUT)
+
+    if name.startswith("times_"):
+        return pd.DataFrame({"time": [response.latency.mean] if response.latency.samples else []})
+    if name in RANKINGS:
+        return pd.DataFrame({"Value": list(response.value), "Count": list(response.count)})
+    return pd.DataFrame({"Count": [response.total]})
+
+def query_all_data():
+    """Query all the results from the server, or return None if the server can not answer."""
+    stub = query_stub()
+    if stub is None:
+        return None
+    try:
+        return {name: {"path": None, "data": query_result(stub, name)} for name in FILE_NAMES}
+    except grpc.RpcError:
+        return None
+
+def is_queried(data_dict):
+    """Check whether the data was queried from the server instead of loaded from the files."""
+    return any(file_data["path"] is None for file_data in data_dict.values())
+
 def load_all_data():
+    """Query all data from the server when it is available, otherwise load it from the files."""
+    queried = query_all_data()
+    if queried is not None:
+        return queried
+    return load_all_files()
+
+def load_all_files():
     """Load all data from defined files and return a dictionary with their content and metadata."""
     data_dict = {}
     for file_name in FILE_NAMES:
@@ -31,6 +89,8 @@ def check_for_updates(data_dict):
     """Check for updates in the file modification times and reload data if changed."""
     changes = False
     for filename, file_data in data_dict.items():
+        if file_data["path"] is None:
+            continue
         mod_time = os.path.getmtime(file_data["path"])
         if mod_time != file_data["mod_time"]:
             file_data["data"] = load_data(filename)
@@ -180,8 +240,8 @@ if st.button("Manually Refresh Data", type="primary", use_container_width=True):
     st.session_state.data_dict = load_all_data()
     st.rerun()
 
-# Load data if not already loaded
-if 'data_dict' not in st.session_state:
+# Load data if not already loaded, and query it again on every run when it comes from the server
+if 'data_dict' not in st.session_state or is_queried(st.session_state.data_dict):
     st.session_state.data_dict = load_all_data()
 
 # Display data from loaded files
@@ -7,6 +7,16 @@ import data_analytics_pb2_grpc
 
 if __name__ == "__main__":
 
+    # Format of the reports sent to the server: "text" (log lines) or "columnar" (typed columns),
+    # and "--stream" to send them through a single long-lived stream instead of one call per cycle
+    args = sys.argv[1:]
+    stream = "--stream" in args
+    formats = [arg for arg in args if arg != "--stream"]
+    report_format = formats[0] if formats else "text"
+    if report_format not in ("text", "columnar"):
+        print(f"Unknown report format: {report_format}")
+        sys.exit(1)
+
     print("Starting simulation...")
 
     params = simulation.SimulationParams(
@@ -22,7 +32,7 @@ if __name__ == "__main__":
     connection = grpc.insecure_channel('localhost:50051')
     stub = data_analytics_pb2_grpc.SimulationServiceStreamStub(connection)
 
-    sim = simulation.Simulation(params, stub)
+    sim = simulation.Simulation(params, stub, report_format=report_format, stream=stream)
 
     
     sim.run()
@@ -4,9 +4,18 @@ sys.path.append('../shared_proto')
 import data_analytics_pb2 as pb2, data_analytics_pb2_grpc as pb2_grpc
 
 from typing import List, Tuple
-from time import time
+from time import time, sleep
 from models import User
 import socket
+import queue
+
+
+# Trailing metadata key of the delay asked by an overloaded server
+RETRY_AFTER_KEY = "retry-after-ms"
+# Trailing metadata key of the number of stream reports taken before the server was overloaded
+ACCEPTED_KEY = "accepted-reports"
+DEFAULT_RETRY_AFTER_MS = 100
+MAX_ATTEMPTS = 5
 
 
 def connect() -> pb2_grpc.SimulationServiceStreamStub:
@@ -21,13 +30,149 @@ def connect() -> pb2_grpc.SimulationServiceStreamStub:
     return stub
 
 
-def report_cycle(
-    stub: pb2_grpc.SimulationServiceStreamStub,
-    user_flow_report: List[str]
-):
-    request = pb2.logdataanalyticsWithTime(
+def build_report(user_flow_report: List[str]) -> pb2.logdataanalyticsWithTime:
+    return pb2.logdataanalyticsWithTime(
         timestamp=int(time() * 1000),
         log=user_flow_report
     )
-    response = stub.ReportCycle(request)
-    return
+
+
+def build_columnar_report(user_flow_report: List[str]) -> pb2.ColumnarReport:
+    """Builds the report as typed columns, so the server does not parse any text."""
+    report = pb2.ColumnarReport(
+        version=pb2.ColumnarReport.VERSION_1,
+        timestamp=int(time() * 1000)
+    )
+
+    # Dictionaries of the string columns, built while the events are added
+    contents = {}
+    products = {}
+
+    # The first line is the header of the text format
+    for line in user_flow_report[1:]:
+        fields = line.rstrip("\n").split(";")
+        fields += [""] * (5 - len(fields))
+        timestamp, event_type, content, action, product = fields[:5]
+
+        report.event_timestamp.append(int(timestamp))
+        report.type.append(pb2.ColumnarReport.EventType.Value(event_type.upper()))
+        report.action.append(pb2.ColumnarReport.Action.Value(action) if action else pb2.ColumnarReport.ACTION_UNSPECIFIED)
+        report.content_index.append(contents.setdefault(content, len(contents)))
+        report.product_index.append(products.setdefault(product, len(products)))
+
+    # Dicts keep the insertion order, so the keys are listed by index
+    report.content_dictionary.extend(contents.keys())
+    report.product_dictionary.extend(products.keys())
+
+    return report
+
+
+def retry_after_ms(error: grpc.RpcError) -> int:
+    """Returns the delay asked by the server when it rejected a report."""
+    for key, value in error.trailing_metadata() or ():
+        if key == RETRY_AFTER_KEY:
+            return int(value)
+    return DEFAULT_RETRY_AFTER_MS
+
+
+def accepted_reports(error: grpc.RpcError) -> int:
+    """Returns the number of reports the server took from a stream before it rejected one."""
+    for key, value in error.trailing_metadata() or ():
+        if key == ACCEPTED_KEY:
+            return int(value)
+    return 0
+
+
+def send_with_backoff(call, request) -> int:
+    """Sends a report, waiting as long as the server asks while it is overloaded.
+
+    Returns the pause, in ms, that the server asked for before the next report."""
+    for _ in range(MAX_ATTEMPTS):
+        try:
+            ack = call(request)
+            return ack.retry_after_ms
+        except grpc.RpcError as error:
+            if error.code() != grpc.StatusCode.RESOURCE_EXHAUSTED:
+                raise
+            sleep(retry_after_ms(error) / 1000)
+
+    print("Report dropped: the server is still overloaded")
+    return 0
+
+
+def report_cycle(
+    stub: pb2_grpc.SimulationServiceStreamStub,
+    user_flow_report: List[str]
+) -> int:
+    request = build_report(user_flow_report)
+    return send_with_backoff(stub.ReportCycle, request)
+
+
+def report_cycle_columnar(
+    stub: pb2_grpc.SimulationServiceStreamStub,
+    user_flow_report: List[str]
+) -> int:
+    request = build_columnar_report(user_flow_report)
+    return send_with_backoff(stub.ReportCycleColumnar, request)
+
+
+class ReportStream:
+    """Keeps one client stream open and sends each report as a message of the stream.
+
+    The chunks sent on a stream are kept until it ends: when the server rejects one, the chunks it did
+    not take are sent again on a new stream."""
+
+    def __init__(self, stub: pb2_grpc.SimulationServiceStreamStub, columnar: bool = False):
+        self.stub = stub
+        self.columnar = columnar
+        self.open()
+
+    def open(self, unacknowledged: List[pb2.ReportChunk] = ()):
+        self.chunks = queue.Queue()
+        self.sent = []
+
+        # The stream reads the chunks until it gets None
+        self.response = self.stub.StreamReportCycle.future(iter(self.chunks.get, None))
+        for chunk in unacknowledged:
+            self.put(chunk)
+
+    def put(self, chunk: pb2.ReportChunk):
+        self.sent.append(chunk)
+        self.chunks.put(chunk)
+
+    def reopen(self):
+        """Opens a new stream once the server ended the current one."""
+        error = self.response.exception()
+        if error is None:
+            # The server took every chunk
+            self.open()
+        elif error.code() == grpc.StatusCode.RESOURCE_EXHAUSTED:
+            # The server was overloaded: wait as asked and send the chunks it did not take on a new stream
+            sleep(retry_after_ms(error) / 1000)
+            self.open(self.sent[accepted_reports(error):])
+        else:
+            # The server ended the stream with an error, so report why
+            self.response.result()
+
+    def send(self, user_flow_report: List[str]):
+        if self.response.done():
+            self.reopen()
+
+        if self.columnar:
+            chunk = pb2.ReportChunk(columnar_report=build_columnar_report(user_flow_report))
+        else:
+            chunk = pb2.ReportChunk(log_report=build_report(user_flow_report))
+        self.put(chunk)
+
+    def close(self):
+        for _ in range(MAX_ATTEMPTS):
+            self.chunks.put(None)
+            try:
+                return self.response.result()
+            except grpc.RpcError as error:
+                if error.code() != grpc.StatusCode.RESOURCE_EXHAUSTED:
+                    raise
+            self.reopen()
+
+        print("Reports dropped: the server is still overloaded")
+        return None
@@ -26,7 +26,7 @@ class Simulation:
     silent: bool = True
     stub: rpc.pb2_grpc.SimulationServiceStreamStub
 
-    def __init__(self, params: SimulationParams, stub: rpc.pb2_grpc.SimulationServiceStreamStub, silent: bool = True):
+    def __init__(self, params: SimulationParams, stub: rpc.pb2_grpc.SimulationServiceStreamStub, silent: bool = True, report_format: str = "text", stream: bool = False):
         self.cycle = 0
         self.params = params
         self.silent = silent
@@ -44,6 +44,8 @@ class Simulation:
         self.log_flow = []
         self.user_flow_report = []
         self.stub = stub
+        self.report_format = report_format
+        self.report_stream = rpc.ReportStream(stub, columnar=(report_format == "columnar")) if stream else None
 
         self.G = G
 
@@ -399,7 +401,17 @@ class Simulation:
                 # self.release_lock(self.csv_complete_path[0])
 
     def write_log_dataAnalytics(self, request_cycle):
-        rpc.report_cycle(self.stub, self.user_flow_report)
+        pause_ms = 0
+        if self.report_stream is not None:
+            self.report_stream.send(self.user_flow_report)
+        elif self.report_format == "columnar":
+            pause_ms = rpc.report_cycle_columnar(self.stub, self.user_flow_report)
+        else:
+            pause_ms = rpc.report_cycle(self.stub, self.user_flow_report)
+
+        # Slow down when the server asks for it
+        if pause_ms > 0:
+            time.sleep(pause_ms / 1000)
 
     def write_log(self, log_cycle):
         if self.log_flow:
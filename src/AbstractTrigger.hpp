@@ -4,7 +4,13 @@
 #include <iostream>
 #include <vector>
 #include <memory> // For std::shared_ptr
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 #include "Observer.hpp"
+#include "TimerWheel.hpp"
+#include "Future.hpp"
 
 using namespace std;
 
@@ -12,32 +18,258 @@ using namespace std;
 // Abstract class Trigger
 /**
  * @brief Abstract base class for triggers.
- * 
+ *
  * This class defines the interface for triggers.
+ * A trigger fires on a TimerWheel, shared by default with all the other triggers, at absolute deadlines:
+ * the next deadline is computed from the previous one, so the period does not drift with the time the
+ * observers take. On each deadline the observers are notified on the executor of the trigger, such as a
+ * ThreadPool, or on the thread of the wheel without one.
+ *
+ * Each observer is notified as a job of its own, so a slow observer does not hold back the others. An
+ * observer still running from a previous deadline sits the deadline out while the others are notified,
+ * so it is never notified twice at once. An observer may be given a timeout: a watchdog on the wheel
+ * reports it once it runs longer. The duration, skips and timeouts of each observer are kept in its metrics.
  */
 class Trigger {
+public:
+    /**
+     * @brief The metrics of an observer of the trigger.
+     */
+    struct ObserverMetrics {
+        int notifications = 0; /**< The notifications that returned. */
+        int skipped = 0; /**< The deadlines skipped because the observer was still running. */
+        int timeouts = 0; /**< The notifications that ran longer than the timeout. */
+        std::chrono::microseconds lastDuration{0}; /**< The duration of the last notification. */
+        std::chrono::microseconds maxDuration{0}; /**< The longest notification. */
+        std::chrono::microseconds totalDuration{0}; /**< The time spent in all the notifications. */
+    };
+
 protected:
-    std::vector<std::shared_ptr<Observer>> observers;
+    /**
+     * @brief Get the time from the activation to the first deadline.
+     */
+    virtual std::chrono::milliseconds getFirstDelay() = 0;
+
+    /**
+     * @brief Get the time from a deadline to the next one.
+     */
+    virtual std::chrono::milliseconds getNextInterval() = 0;
+
+    /**
+     * @brief Notify an observer of a deadline.
+     *
+     * @param observer The observer to notify.
+     */
+    virtual void notify(Observer& observer) = 0;
 
 public:
+    /**
+     * @brief Constructs a new Trigger object.
+     *
+     * @param wheel The wheel that schedules the deadlines of the trigger.
+     */
+    Trigger(TimerWheel& wheel = TimerWheel::shared()) : wheel(wheel) {}
+
+    Trigger(const Trigger&) = delete;
+    Trigger& operator=(const Trigger&) = delete;
+
+    /**
+     * @brief Destructor for the Trigger object, which deactivates it.
+     */
+    virtual ~Trigger() {
+        deactivate();
+    }
+
     /**
      * @brief Activates the trigger.
      */
-    virtual void activate() = 0;
+    virtual void activate() {
+        if (active.exchange(true)) return;
+        std::lock_guard<std::mutex> lock(timerMutex);
+        scheduleAt(TimerWheel::Clock::now() + getFirstDelay());
+    }
 
     /**
      * @brief Deactivates the trigger.
+     *
+     * Once it returns, no deadline fires and the observers notified last have returned, unless it is
+     * called by one of them.
      */
-    virtual void deactivate() = 0;
+    virtual void deactivate() {
+        active.store(false);
+
+        // A deadline firing meanwhile may schedule the next one before it sees the trigger inactive
+        std::unique_lock<std::mutex> lock(timerMutex);
+        while (timer != 0) {
+            TimerWheel::TimerId id = timer;
+            lock.unlock();
+            wheel.cancel(id);
+            lock.lock();
+            if (timer == id) timer = 0;
+        }
+
+        if (notifyingTrigger != this) {
+            notifiedCondition.wait(lock, [this] { return runningObservers == 0; });
+        }
+    }
+
+    /**
+     * @brief Sets the executor that notifies the observers.
+     *
+     * Must be called before the trigger is activated.
+     *
+     * @param executor The executor, such as the one of a ThreadPool, or empty for the thread of the wheel.
+     */
+    void setExecutor(Executor executor) {
+        this->executor = std::move(executor);
+    }
 
     /**
      * @brief Adds an observer to the trigger.
-     * 
+     *
      * @param observer The observer to add.
+     * @param timeout The time after which a notification of the observer is reported, zero for none.
      */
      // Method to add observer
-    void addObserver(std::shared_ptr<Observer> observer) {
-        observers.push_back(observer);
+    void addObserver(std::shared_ptr<Observer> observer, std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        auto slot = std::make_shared<ObserverSlot>();
+        slot->observer = observer;
+        slot->timeout = timeout;
+        observerSlots.push_back(slot);
+    }
+
+    /**
+     * @brief Gets the metrics of the observers.
+     *
+     * @return The metrics of each observer, in the order they were added.
+     */
+    std::vector<ObserverMetrics> getObserverMetrics() {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        std::vector<ObserverMetrics> metrics;
+        for (const auto& slot : observerSlots) metrics.push_back(slot->metrics);
+        return metrics;
+    }
+
+    /**
+     * @brief Gets the number of deadlines that passed while the trigger could not fire, such as while
+     *        the thread of the wheel was busy.
+     *
+     * @return The number of skipped deadlines.
+     */
+    int getSkippedDeadlines() const {
+        return skippedDeadlines.load(std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * @brief An observer of the trigger and its state.
+     */
+    struct ObserverSlot {
+        std::shared_ptr<Observer> observer; /**< The observer. */
+        std::chrono::milliseconds timeout{0}; /**< The time after which a notification is reported. */
+        bool running = false; /**< Set while the observer is notified. */
+        ObserverMetrics metrics; /**< The metrics of the observer. */
+    };
+
+    std::vector<std::shared_ptr<ObserverSlot>> observerSlots; /**< The observers of the trigger. */
+    TimerWheel& wheel; /**< The wheel that schedules the deadlines. */
+    Executor executor; /**< Notifies the observers, on the thread of the wheel if empty. */
+    std::atomic<bool> active{false}; /**< Whether the trigger fires. */
+    std::atomic<int> skippedDeadlines{0}; /**< Deadlines that passed while the trigger could not fire. */
+
+    std::mutex timerMutex; /**< The mutex for the timer and the observers. */
+    std::condition_variable notifiedCondition; /**< Wakes deactivate once the observers return. */
+    TimerWheel::TimerId timer = 0; /**< The timer of the next deadline, 0 if none. */
+    int runningObservers = 0; /**< The observers being notified. */
+
+    static inline thread_local Trigger* notifyingTrigger = nullptr; /**< The trigger the thread notifies for. */
+
+    /**
+     * @brief Schedule the next deadline. Must be called with the timer mutex held.
+     */
+    void scheduleAt(TimerWheel::Clock::time_point deadline) {
+        timer = wheel.schedule(deadline, [this, deadline] { fire(deadline); });
+    }
+
+    /**
+     * @brief Notify the observers of a deadline, and schedule the next one.
+     *
+     * @param deadline The deadline that passed.
+     */
+    void fire(TimerWheel::Clock::time_point deadline) {
+        std::vector<std::shared_ptr<ObserverSlot>> notified;
+        {
+            std::lock_guard<std::mutex> lock(timerMutex);
+            if (!active.load()) return;
+
+            // The next deadline follows this one; the deadlines that passed meanwhile are skipped
+            TimerWheel::Clock::time_point next = deadline + getNextInterval();
+            auto now = TimerWheel::Clock::now();
+            while (next <= now) {
+                next += getNextInterval();
+                skippedDeadlines.fetch_add(1, std::memory_order_relaxed);
+            }
+            scheduleAt(next);
+
+            // An observer still busy with a previous deadline sits this one out
+            for (const auto& slot : observerSlots) {
+                if (slot->running) {
+                    slot->metrics.skipped++;
+                    continue;
+                }
+                slot->running = true;
+                runningObservers++;
+                notified.push_back(slot);
+            }
+        }
+
+        for (const auto& slot : notified) {
+            if (executor) executor([this, slot] { notifyObserver(*slot); });
+            else notifyObserver(*slot);
+        }
+    }
+
+    /**
+     * @brief Notify an observer, watching its timeout and recording its metrics.
+     *
+     * @param slot The observer and its state.
+     */
+    void notifyObserver(ObserverSlot& slot) {
+        // The watchdog reports the observer while it still runs; it is cancelled before the slot is released
+        TimerWheel::TimerId watchdog = 0;
+        if (slot.timeout > std::chrono::milliseconds(0)) {
+            watchdog = wheel.scheduleAfter(slot.timeout, [this, &slot] {
+                std::lock_guard<std::mutex> lock(timerMutex);
+                slot.metrics.timeouts++;
+                cerr << "Observer still running after " << slot.timeout.count() << " ms" << endl;
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        notifyingTrigger = this;
+        try {
+            notify(*slot.observer);
+        } catch (const exception& e) {
+            cerr << "Observer failed: " << e.what() << endl;
+        }
+        notifyingTrigger = nullptr;
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        // Without an executor the wheel runs the observer, so the watchdog could not fire in time
+        bool reported = watchdog != 0 && !wheel.cancel(watchdog);
+
+        std::lock_guard<std::mutex> lock(timerMutex);
+        ObserverMetrics& metrics = slot.metrics;
+        metrics.notifications++;
+        metrics.lastDuration = duration;
+        metrics.maxDuration = std::max(metrics.maxDuration, duration);
+        metrics.totalDuration += duration;
+        if (!reported && watchdog != 0 && duration > slot.timeout) metrics.timeouts++;
+
+        slot.running = false;
+        runningObservers--;
+        notifiedCondition.notify_all();
     }
 };
 
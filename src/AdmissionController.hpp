@@ -0,0 +1,159 @@
+#ifndef ADMISSION_CONTROLLER_HPP
+#define ADMISSION_CONTROLLER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+
+#include "DataFrame.hpp"
+#include "Queue.hpp"
+#include "BatchCoalescer.hpp"
+
+using namespace std;
+
+/**
+ * @brief The answer of the AdmissionController to a report.
+ */
+struct AdmissionDecision {
+    bool admitted; /**< Whether the report can be queued. */
+    long long retryAfterMs; /**< How long the client should wait before its next report (0 for no wait). */
+    int credits; /**< How many more reports the queue can take right now. */
+};
+
+/**
+ * @brief Class for deciding whether a report can enter the pipeline.
+ *
+ * The AdmissionController checks the depth of the input queue and an estimate of the memory held by the
+ * queued DataFrames before a report is parsed, so an overloaded server rejects the report at once
+ * instead of blocking a thread on the full queue. The memory estimate is the average wire size of the
+ * reports times a fixed expansion factor, for each report queued or being parsed.
+ *
+ * When the reports go through a BatchCoalescer, its pending batch takes a single slot of the queue, as it
+ * is pushed as one DataFrame, while each report in the batch still counts against the memory budget.
+ * The batches it deferred while the queue was full take a slot each until they are pushed.
+ *
+ * Each admitted report holds a slot until release is called, after it is pushed to the queue or dropped,
+ * or until reject is called, when the queue filled up before it could be pushed.
+ * Rejections come with a retry delay that doubles while the rejections go on.
+ */
+class AdmissionController {
+private:
+    static constexpr double MEMORY_FACTOR = 4.0; /**< Estimated DataFrame bytes per report byte. */
+    static constexpr double AVERAGE_WEIGHT = 0.1; /**< Weight of a new report in the average size. */
+    static constexpr int MAX_BACKOFF_SHIFT = 5; /**< Limit of the doublings of the retry delay. */
+
+    Queue<DataFrame*>* queue; /**< The input queue of the pipeline. */
+    BatchCoalescer* coalescer = nullptr; /**< The coalescer whose pending batch counts as queued, if any. */
+    size_t memoryBudget; /**< The memory the queued reports may take, in bytes. */
+    chrono::milliseconds retryAfter; /**< The base retry delay. */
+
+    atomic<int> inFlight{0}; /**< Reports admitted and not yet released. */
+    atomic<double> averageBytes{0.0}; /**< Moving average of the wire size of the reports. */
+    atomic<int> rejections{0}; /**< Consecutive rejections. */
+
+    /**
+     * @brief Fold the size of a report into the moving average.
+     */
+    void updateAverage(size_t requestBytes) {
+        double average = averageBytes.load(memory_order_relaxed);
+        double updated = average == 0.0 ? requestBytes : average + AVERAGE_WEIGHT * (requestBytes - average);
+        averageBytes.store(updated, memory_order_relaxed);
+    }
+
+    /**
+     * @brief Count a rejection and get its decision, whose retry delay doubles with each rejection in a row.
+     */
+    AdmissionDecision backOff() {
+        int shift = min(rejections.fetch_add(1), MAX_BACKOFF_SHIFT);
+        return {false, retryAfter.count() << shift, 0};
+    }
+
+public:
+    /**
+     * @brief Construct a new AdmissionController object.
+     *
+     * @param queue The input queue of the pipeline.
+     * @param memoryBudget The memory the queued reports may take, in bytes.
+     * @param retryAfter The base delay suggested to rejected clients.
+     */
+    AdmissionController(Queue<DataFrame*>* queue, size_t memoryBudget, chrono::milliseconds retryAfter)
+        : queue(queue), memoryBudget(memoryBudget), retryAfter(retryAfter) {}
+
+    /**
+     * @brief Decide whether a report can be queued.
+     *
+     * An admitted report must be released once it is pushed to the queue or dropped.
+     *
+     * @param requestBytes The wire size of the report.
+     * @return The decision, with the retry hint and the credits left.
+     */
+    AdmissionDecision admit(size_t requestBytes) {
+        int capacity = queue->capacity();
+        int slots = queue->size() + inFlight.fetch_add(1);
+        size_t batched = 0;
+        if (coalescer != nullptr) {
+            slots += static_cast<int>(coalescer->getDeferredBatches());
+            batched = coalescer->getPendingReports();
+        }
+        int depth = slots + (batched > 0 ? 1 : 0);
+        updateAverage(requestBytes);
+
+        double queuedBytes = (slots + batched) * averageBytes.load(memory_order_relaxed) * MEMORY_FACTOR;
+        double incomingBytes = requestBytes * MEMORY_FACTOR;
+
+        // Always admit into an empty queue, so a report larger than the budget is not rejected forever
+        bool admitted = depth < capacity && (depth == 0 || queuedBytes + incomingBytes <= memoryBudget);
+        if (!admitted) {
+            inFlight.fetch_sub(1);
+            return backOff();
+        }
+
+        rejections.store(0);
+
+        // Past half of the queue, ask the client to slow down in proportion to the fill
+        int credits = max(0, capacity - depth - 1);
+        long long hint = 0;
+        if (2 * (depth + 1) > capacity) hint = retryAfter.count() * (depth + 1) / capacity;
+        return {true, hint, credits};
+    }
+
+    /**
+     * @brief Count the pending batch of a coalescer as queued.
+     *
+     * Must be called before the first report is admitted.
+     *
+     * @param batchCoalescer The coalescer that pushes to the input queue.
+     */
+    void setCoalescer(BatchCoalescer* batchCoalescer) {
+        coalescer = batchCoalescer;
+    }
+
+    /**
+     * @brief Release the slot of an admitted report.
+     */
+    void release() {
+        inFlight.fetch_sub(1);
+    }
+
+    /**
+     * @brief Release the slot of an admitted report that could not be queued in time, and reject it.
+     *
+     * @return The decision, with the retry hint of a rejection.
+     */
+    AdmissionDecision reject() {
+        inFlight.fetch_sub(1);
+        return backOff();
+    }
+
+    /**
+     * @brief Get the number of reports admitted and not yet released.
+     *
+     * @return The number of reports in flight.
+     */
+    int getInFlight() const {
+        return inFlight.load();
+    }
+};
+
+#endif // ADMISSION_CONTROLLER_HPP
@@ -0,0 +1,172 @@
+#ifndef ASYNC_WRITER_HPP
+#define ASYNC_WRITER_HPP
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "DataFrame.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for writing DataFrame snapshots to disk in a background thread.
+ *
+ * The AsyncResultWriter takes ownership of the snapshots handed to it and writes them in order
+ * in its own thread, so the threads that produce the results never wait on disk.
+ */
+class AsyncResultWriter {
+public:
+    /**
+     * @brief Function that writes a DataFrame to a destination.
+     */
+    using WriteFunction = function<void(DataFrame*, const string&)>;
+
+private:
+    /**
+     * @brief A snapshot waiting to be written.
+     */
+    struct WriteJob {
+        DataFrame* df;
+        string destName;
+        WriteFunction write;
+    };
+
+    deque<WriteJob> jobs; /**< The snapshots waiting to be written. */
+    mutex jobsMutex; /**< The mutex for the jobs. */
+    condition_variable jobsCondition; /**< Signals new jobs to the writer thread. */
+    condition_variable idleCondition; /**< Signals that all the jobs were written. */
+    bool writing = false; /**< Whether the writer thread is writing a job. */
+    bool stop = false; /**< Flag to stop the writer thread. */
+    thread writerThread; /**< The writer thread. */
+
+    /**
+     * @brief The function that the writer thread executes.
+     */
+    void run() {
+        while (true) {
+            WriteJob job;
+            {
+                unique_lock<mutex> lock(jobsMutex);
+                jobsCondition.wait(lock, [this] { return !jobs.empty() || stop; });
+
+                // Write all the pending snapshots before stopping
+                if (jobs.empty()) return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                writing = true;
+            }
+
+            try {
+                job.write(job.df, job.destName);
+            } catch (const exception& e) {
+                cerr << "Failed to write " << job.destName << ": " << e.what() << endl;
+            }
+            delete job.df;
+
+            {
+                lock_guard<mutex> lock(jobsMutex);
+                writing = false;
+                if (jobs.empty()) idleCondition.notify_all();
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new AsyncResultWriter object and start the writer thread.
+     */
+    AsyncResultWriter() {
+        writerThread = thread(&AsyncResultWriter::run, this);
+    }
+
+    // The writer thread refers to the object
+    AsyncResultWriter(const AsyncResultWriter&) = delete;
+    AsyncResultWriter& operator=(const AsyncResultWriter&) = delete;
+
+    /**
+     * @brief Write the pending snapshots and stop the writer thread.
+     */
+    ~AsyncResultWriter() {
+        {
+            lock_guard<mutex> lock(jobsMutex);
+            stop = true;
+        }
+        jobsCondition.notify_one();
+        writerThread.join();
+    }
+
+    /**
+     * @brief Hand a snapshot to the writer thread.
+     *
+     * The writer takes ownership of the DataFrame and deletes it once it is written.
+     *
+     * @param df The snapshot to be written.
+     * @param destName The destination of the snapshot.
+     * @param write The function that writes the snapshot.
+     */
+    void submit(DataFrame* df, const string& destName, WriteFunction write) {
+        {
+            lock_guard<mutex> lock(jobsMutex);
+            jobs.push_back({df, destName, std::move(write)});
+        }
+        jobsCondition.notify_one();
+    }
+
+    /**
+     * @brief Wait until all the submitted snapshots are written.
+     */
+    void flush() {
+        unique_lock<mutex> lock(jobsMutex);
+        idleCondition.wait(lock, [this] { return jobs.empty() && !writing; });
+    }
+
+    /**
+     * @brief Get the number of snapshots waiting to be written.
+     *
+     * @return The number of pending snapshots.
+     */
+    size_t pending() {
+        lock_guard<mutex> lock(jobsMutex);
+        return jobs.size() + (writing ? 1 : 0);
+    }
+
+    /**
+     * @brief Publish a completely written file under its final name.
+     *
+     * The file is synced to disk before the rename, which is atomic, so the readers of the
+     * destination see either the previous version or the new one, never a partially written
+     * file, even after a crash. The file is removed if it cannot be published.
+     *
+     * @param tempName The name of the written file.
+     * @param destName The final name of the file.
+     * @return true if the file was published, false otherwise.
+     */
+    static bool publish(const string& tempName, const string& destName) {
+        int fd = open(tempName.c_str(), O_RDONLY);
+        if (fd < 0 || fsync(fd) != 0) {
+            perror(("Failed to sync " + tempName).c_str());
+            if (fd >= 0) close(fd);
+            remove(tempName.c_str());
+            return false;
+        }
+        close(fd);
+
+        if (rename(tempName.c_str(), destName.c_str()) != 0) {
+            perror(("Failed to publish " + destName).c_str());
+            remove(tempName.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // ASYNC_WRITER_HPP
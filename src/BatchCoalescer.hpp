@@ -0,0 +1,249 @@
+#ifndef BATCH_COALESCER_HPP
+#define BATCH_COALESCER_HPP
+
+#include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <deque>
+
+#include "DataFrame.hpp"
+#include "Queue.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for coalescing small DataFrames into larger batches before they are queued.
+ *
+ * The BatchCoalescer appends the rows of the DataFrames it receives to a pending batch, and pushes
+ * the batch to the queue once it reaches the row limit or once its oldest rows have waited for
+ * the maximum delay, whichever comes first. The batch keeps the timestamp of its first DataFrame,
+ * so the latency measured downstream includes the time spent in the batch.
+ *
+ * The coalescer counts the DataFrames added to the pending batch, so the admission of new reports can
+ * count the batch as a single queued DataFrame that holds the memory of all of them.
+ *
+ * A batch completed by add waits at most the push timeout for room in the queue, so the thread that
+ * adds a DataFrame is never held on a full queue. A batch that does not fit in time is deferred to the
+ * flusher thread, which pushes the deferred batches in order, and counts as queued until then.
+ */
+class BatchCoalescer {
+private:
+    Queue<DataFrame*>* queue; /**< The queue that receives the batches. */
+    size_t maxRows; /**< The number of rows that completes a batch. */
+    chrono::milliseconds maxDelay; /**< The maximum time the first rows of a batch wait. */
+    chrono::milliseconds pushTimeout; /**< The longest time add waits for room in the queue. */
+
+    DataFrame* pending = nullptr; /**< The batch being filled. */
+    size_t pendingReports = 0; /**< The number of DataFrames added to the pending batch. */
+    chrono::steady_clock::time_point deadline; /**< The time at which the pending batch is pushed. */
+    mutex batchMutex; /**< The mutex for the pending batch. */
+    deque<DataFrame*> deferred; /**< The batches left to the flusher thread, oldest first. */
+    condition_variable batchCondition; /**< Signals a new or deferred batch to the flusher thread. */
+    bool stop = false; /**< Flag to stop the flusher thread. */
+    thread flusherThread; /**< The thread that pushes the batches on their deadline. */
+
+    /**
+     * @brief Take the pending batch. Must be called with the mutex held.
+     */
+    DataFrame* takePending() {
+        DataFrame* batch = pending;
+        pending = nullptr;
+        pendingReports = 0;
+        return batch;
+    }
+
+    /**
+     * @brief Push a batch, waiting at most the push timeout, or defer it to the flusher thread.
+     *
+     * A batch is deferred at once while older batches are deferred, so the batches keep their order.
+     */
+    void pushOrDefer(DataFrame* batch) {
+        {
+            lock_guard<mutex> lock(batchMutex);
+            if (!deferred.empty()) {
+                deferred.push_back(batch);
+                return;
+            }
+        }
+
+        try {
+            if (queue->tryPushFor(batch, pushTimeout)) return;
+        } catch (const runtime_error&) {
+            // The queue is closed
+            delete batch;
+            throw;
+        }
+
+        {
+            lock_guard<mutex> lock(batchMutex);
+            deferred.push_back(batch);
+        }
+        batchCondition.notify_one();
+    }
+
+    /**
+     * @brief Push a batch, waiting while the queue is full. A batch is dropped if the queue is closed, as
+     * the pipeline no longer reads it.
+     */
+    void pushWaiting(DataFrame* batch) {
+        try {
+            queue->push(batch);
+        } catch (const runtime_error& e) {
+            cerr << "Batch dropped: " << e.what() << endl;
+            delete batch;
+        }
+    }
+
+    /**
+     * @brief The function that the flusher thread executes.
+     */
+    void run() {
+        unique_lock<mutex> lock(batchMutex);
+        while (!stop) {
+            // The deferred batch stays counted as queued until it is pushed
+            if (!deferred.empty()) {
+                DataFrame* batch = deferred.front();
+                lock.unlock();
+                pushWaiting(batch);
+                lock.lock();
+                deferred.pop_front();
+                continue;
+            }
+
+            if (pending == nullptr) {
+                batchCondition.wait(lock);
+                continue;
+            }
+
+            // Push the batch when its deadline passes, unless it was already pushed as full
+            if (batchCondition.wait_until(lock, deadline) == cv_status::timeout && pending != nullptr
+                && chrono::steady_clock::now() >= deadline) {
+                DataFrame* batch = takePending();
+                lock.unlock();
+                pushWaiting(batch);
+                lock.lock();
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new BatchCoalescer object and start the flusher thread.
+     *
+     * @param queue The queue that receives the batches.
+     * @param maxRows The number of rows that completes a batch.
+     * @param maxDelay The maximum time the first rows of a batch wait before it is pushed.
+     * @param pushTimeout The longest time add waits for room in the queue before it defers a batch.
+     */
+    BatchCoalescer(Queue<DataFrame*>* queue, size_t maxRows, chrono::milliseconds maxDelay,
+                   chrono::milliseconds pushTimeout = chrono::milliseconds(100))
+        : queue(queue), maxRows(maxRows), maxDelay(maxDelay), pushTimeout(pushTimeout) {
+        flusherThread = thread(&BatchCoalescer::run, this);
+    }
+
+    // The flusher thread refers to the object
+    BatchCoalescer(const BatchCoalescer&) = delete;
+    BatchCoalescer& operator=(const BatchCoalescer&) = delete;
+
+    /**
+     * @brief Stop the flusher thread and push the deferred and pending batches, in order.
+     */
+    ~BatchCoalescer() {
+        {
+            lock_guard<mutex> lock(batchMutex);
+            stop = true;
+        }
+        batchCondition.notify_one();
+        flusherThread.join();
+
+        for (DataFrame* batch : deferred) pushWaiting(batch);
+        deferred.clear();
+        if (pending != nullptr) pushWaiting(takePending());
+    }
+
+    /**
+     * @brief Add the rows of a DataFrame to the pending batch.
+     *
+     * The coalescer takes ownership of the DataFrame. A DataFrame with other columns than the
+     * pending batch pushes the batch and starts a new one.
+     *
+     * @param df The DataFrame to be added.
+     * @throws std::runtime_error If a batch is completed while the queue is closed. The DataFrame is
+     * dropped with the batch.
+     */
+    void add(DataFrame* df) {
+        DataFrame* full = nullptr;
+        DataFrame* mismatched = nullptr;
+        {
+            lock_guard<mutex> lock(batchMutex);
+            if (pending == nullptr) {
+                pending = df;
+                deadline = chrono::steady_clock::now() + maxDelay;
+                batchCondition.notify_one();
+            } else {
+                try {
+                    pending->appendRows(*df);
+                    delete df;
+                } catch (const runtime_error& e) {
+                    // Different columns, so the batch is pushed as is and the DataFrame starts a new one
+                    mismatched = takePending();
+                    pending = df;
+                    deadline = chrono::steady_clock::now() + maxDelay;
+                }
+            }
+            pendingReports++;
+
+            if (pending->getRowCount() >= maxRows) full = takePending();
+        }
+
+        // Push outside the lock, as the queue may block while it is full
+        if (mismatched != nullptr) pushOrDefer(mismatched);
+        if (full != nullptr) pushOrDefer(full);
+    }
+
+    /**
+     * @brief Push the pending batch now, if there is one, or defer it once the push timeout passes.
+     */
+    void flush() {
+        DataFrame* batch;
+        {
+            lock_guard<mutex> lock(batchMutex);
+            batch = takePending();
+        }
+        if (batch != nullptr) pushOrDefer(batch);
+    }
+
+    /**
+     * @brief Get the number of rows waiting in the pending batch.
+     *
+     * @return The number of pending rows.
+     */
+    size_t getPendingRows() {
+        lock_guard<mutex> lock(batchMutex);
+        return pending == nullptr ? 0 : pending->getRowCount();
+    }
+
+    /**
+     * @brief Get the number of DataFrames added to the pending batch.
+     *
+     * @return The number of pending DataFrames.
+     */
+    size_t getPendingReports() {
+        lock_guard<mutex> lock(batchMutex);
+        return pendingReports;
+    }
+
+    /**
+     * @brief Get the number of batches deferred to the flusher thread and not pushed yet.
+     *
+     * @return The number of deferred batches.
+     */
+    size_t getDeferredBatches() {
+        lock_guard<mutex> lock(batchMutex);
+        return deferred.size();
+    }
+};
+
+#endif // BATCH_COALESCER_HPP
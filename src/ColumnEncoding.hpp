@@ -0,0 +1,527 @@
+#ifndef COLUMN_ENCODING_HPP
+#define COLUMN_ENCODING_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief The encodings that can be applied to a column block.
+ *
+ * - PLAIN: the values as they are in memory;
+ * - RLE: run-length encoding, as (value, length) runs;
+ * - DELTA: the differences between consecutive values, zig-zag encoded as varints;
+ * - BIT_PACKED: frame of reference, the values minus the minimum bit-packed with the smallest width;
+ * - DICTIONARY: the distinct values once, and the bit-packed index of each value in the dictionary.
+ */
+enum class ColumnEncoding : uint8_t {
+    PLAIN = 0,
+    RLE = 1,
+    DELTA = 2,
+    BIT_PACKED = 3,
+    DICTIONARY = 4
+};
+
+/**
+ * @brief Lightweight codecs used to shrink the column blocks of archived DataFrames.
+ *
+ * The encoding of each column is chosen from its statistics (number of runs, range of values,
+ * size of the deltas and number of distinct values) by estimating the encoded size with each codec.
+ * The decoders fill a column sized up front, one block at a time. Bit-packed values are read with a
+ * single word load each, while the varint deltas and the runs are decoded one after the other.
+ */
+namespace encoding {
+    // Widest bit-packed value: a value shifted by up to 7 bits must fit a 64 bit word
+    constexpr uint8_t MAX_PACKED_WIDTH = 56;
+
+    // Padding after bit-packed data, so the decoder can always load a full word
+    constexpr size_t PACKED_PADDING = sizeof(uint64_t);
+
+    // Largest encoded size, as a fraction of the plain size, for an encoding to be used
+    constexpr double MAX_SIZE_RATIO = 0.9;
+
+    /**
+     * @brief Statistics of a column, used to choose its encoding.
+     */
+    struct ColumnStats {
+        size_t count = 0; /**< The number of values. */
+        size_t runs = 0; /**< The number of runs of equal consecutive values. */
+        long long min = 0; /**< The minimum value (integer columns). */
+        long long max = 0; /**< The maximum value (integer columns). */
+        size_t deltaBytes = 0; /**< The size of the varint deltas (integer columns). */
+        size_t distinct = 0; /**< The number of distinct values (string columns). */
+        size_t dictionaryBytes = 0; /**< The size of the distinct values (string columns). */
+        size_t plainBytes = 0; /**< The size of the plain block. */
+    };
+
+    /**
+     * @brief Map a signed integer to an unsigned one, keeping small magnitudes small.
+     */
+    inline uint64_t zigZag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    /**
+     * @brief Revert the zig-zag mapping.
+     */
+    inline int64_t unZigZag(uint64_t value) {
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    /**
+     * @brief Get the number of bytes of a varint.
+     */
+    inline size_t varintSize(uint64_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    /**
+     * @brief Get the number of bits needed to store a value.
+     */
+    inline uint8_t bitWidth(uint64_t value) {
+        uint8_t width = 0;
+        while (value != 0) {
+            value >>= 1;
+            width++;
+        }
+        return width;
+    }
+
+    /**
+     * @brief Get the number of bytes of n values bit-packed with a given width, padding included.
+     */
+    inline size_t packedSize(size_t n, uint8_t width) {
+        return (n * width + 7) / 8 + PACKED_PADDING;
+    }
+
+    /**
+     * @brief Check whether two values can share a run.
+     *
+     * Floating point values are compared bit by bit, so -0.0 does not join a run of 0.0 and NaN joins a run of itself.
+     */
+    template<typename T>
+    bool sameValue(const T& a, const T& b) {
+        if constexpr (is_same_v<T, float>) {
+            return bit_cast<uint32_t>(a) == bit_cast<uint32_t>(b);
+        } else if constexpr (is_same_v<T, double>) {
+            return bit_cast<uint64_t>(a) == bit_cast<uint64_t>(b);
+        } else {
+            return a == b;
+        }
+    }
+
+    /**
+     * @brief Check that n values bit-packed with a given width can fit a block of a given size.
+     *
+     * Values of width 0 take no space, so any number of them fits.
+     */
+    inline bool fitsPacked(uint64_t n, uint64_t width, size_t size) {
+        return width == 0 || n <= static_cast<uint64_t>(size) * 8 / width;
+    }
+
+    /**
+     * @brief Append a value to a byte buffer.
+     */
+    template<typename T>
+    void appendValue(vector<uint8_t>& out, const T& value) {
+        size_t position = out.size();
+        out.resize(position + sizeof(T));
+        memcpy(out.data() + position, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Append a varint to a byte buffer.
+     */
+    inline void appendVarint(vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    /**
+     * @brief Append n values bit-packed with a given width to a byte buffer.
+     */
+    inline void appendPacked(vector<uint8_t>& out, const uint64_t* values, size_t n, uint8_t width) {
+        size_t start = out.size();
+        out.resize(start + packedSize(n, width), 0);
+        uint8_t* packed = out.data() + start;
+
+        for (size_t i = 0; i < n; i++) {
+            size_t bit = i * width;
+            uint64_t word;
+            memcpy(&word, packed + (bit >> 3), sizeof(word));
+            word |= values[i] << (bit & 7);
+            memcpy(packed + (bit >> 3), &word, sizeof(word));
+        }
+    }
+
+    /**
+     * @brief A bounds checked cursor over an encoded block.
+     */
+    class BlockReader {
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+
+    public:
+        BlockReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        /**
+         * @brief Get a pointer to the next bytes and skip them.
+         *
+         * @throws runtime_error If the block is truncated.
+         */
+        const uint8_t* take(size_t bytes) {
+            if (bytes > size - position) {
+                throw runtime_error("Encoded column block is truncated.");
+            }
+            const uint8_t* ptr = data + position;
+            position += bytes;
+            return ptr;
+        }
+
+        template<typename T>
+        T read() {
+            T value;
+            memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        uint64_t readVarint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t byte = *take(1);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            throw runtime_error("Encoded column block has an invalid varint.");
+        }
+    };
+
+    /**
+     * @brief Unpack n values bit-packed with a given width.
+     *
+     * @param packed The packed data, followed by the padding.
+     * @param n The number of values.
+     * @param width The width of each value.
+     * @param reference The value added to each unpacked value.
+     * @param out The output values.
+     */
+    template<typename T>
+    void unpack(const uint8_t* packed, size_t n, uint8_t width, int64_t reference, T* out) {
+        const uint64_t mask = width == 0 ? 0 : (~uint64_t(0) >> (64 - width));
+        for (size_t i = 0; i < n; i++) {
+            size_t bit = i * width;
+            uint64_t word;
+            memcpy(&word, packed + (bit >> 3), sizeof(word));
+            out[i] = static_cast<T>(reference + static_cast<int64_t>((word >> (bit & 7)) & mask));
+        }
+    }
+
+    /**
+     * @brief Compute the statistics of a column.
+     *
+     * @param values The values of the column.
+     * @return The statistics of the column.
+     */
+    template<typename T>
+    ColumnStats computeStats(const vector<T>& values) {
+        ColumnStats stats;
+        stats.count = values.size();
+        if (values.empty()) return stats;
+
+        stats.runs = 1;
+        for (size_t i = 1; i < values.size(); i++) {
+            stats.runs += !sameValue(values[i], values[i - 1]);
+        }
+
+        if constexpr (is_integral_v<T>) {
+            stats.plainBytes = values.size() * sizeof(T);
+            stats.min = stats.max = values[0];
+            int64_t previous = 0;
+            for (const auto& value : values) {
+                if (value < stats.min) stats.min = value;
+                if (value > stats.max) stats.max = value;
+                int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous));
+                stats.deltaBytes += varintSize(zigZag(delta));
+                previous = value;
+            }
+        } else if constexpr (is_same_v<T, string>) {
+            stats.plainBytes = (values.size() + 1) * sizeof(uint64_t);
+            unordered_map<string_view, uint32_t> dictionary;
+            for (const auto& value : values) {
+                stats.plainBytes += value.size();
+                if (dictionary.emplace(value, 0).second) stats.dictionaryBytes += value.size();
+            }
+            stats.distinct = dictionary.size();
+        } else {
+            stats.plainBytes = values.size() * sizeof(T);
+        }
+
+        return stats;
+    }
+
+    /**
+     * @brief Estimate the size of a column block with an encoding.
+     *
+     * @return The estimated size, or SIZE_MAX if the encoding does not apply to the column.
+     */
+    template<typename T>
+    size_t estimateSize(const ColumnStats& stats, ColumnEncoding encoding) {
+        switch (encoding) {
+            case ColumnEncoding::PLAIN:
+                return stats.plainBytes;
+            case ColumnEncoding::RLE:
+                if constexpr (is_arithmetic_v<T>) return sizeof(uint64_t) + stats.runs * (sizeof(T) + sizeof(uint32_t));
+                break;
+            case ColumnEncoding::DELTA:
+                if constexpr (is_integral_v<T>) return stats.deltaBytes;
+                break;
+            case ColumnEncoding::BIT_PACKED:
+                if constexpr (is_integral_v<T>) {
+                    uint8_t width = bitWidth(static_cast<uint64_t>(stats.max) - static_cast<uint64_t>(stats.min));
+                    if (width <= MAX_PACKED_WIDTH) return sizeof(int64_t) + sizeof(uint64_t) + packedSize(stats.count, width);
+                }
+                break;
+            case ColumnEncoding::DICTIONARY:
+                if constexpr (is_same_v<T, string>) {
+                    uint8_t width = bitWidth(stats.distinct > 0 ? stats.distinct - 1 : 0);
+                    return sizeof(uint64_t) + (stats.distinct + 1) * sizeof(uint64_t) + stats.dictionaryBytes + packedSize(stats.count, width);
+                }
+                break;
+        }
+        return SIZE_MAX;
+    }
+
+    /**
+     * @brief Choose the encoding of a column from its statistics.
+     *
+     * The encoding with the smallest estimated size is chosen, as long as it is
+     * significantly smaller than the plain block.
+     *
+     * @param values The values of the column.
+     * @return The chosen encoding.
+     */
+    template<typename T>
+    ColumnEncoding chooseEncoding(const vector<T>& values) {
+        ColumnStats stats = computeStats(values);
+
+        ColumnEncoding best = ColumnEncoding::PLAIN;
+        size_t bestSize = static_cast<size_t>(stats.plainBytes * MAX_SIZE_RATIO);
+        for (ColumnEncoding encoding : {ColumnEncoding::RLE, ColumnEncoding::DELTA, ColumnEncoding::BIT_PACKED, ColumnEncoding::DICTIONARY}) {
+            size_t size = estimateSize<T>(stats, encoding);
+            if (size < bestSize) {
+                best = encoding;
+                bestSize = size;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Encode a column.
+     *
+     * @param values The values of the column.
+     * @param encoding The encoding, which must apply to the column type.
+     * @param out The buffer to which the encoded block is appended.
+     * @throws runtime_error If the encoding does not apply to the column type.
+     */
+    template<typename T>
+    void encode(const vector<T>& values, ColumnEncoding encoding, vector<uint8_t>& out) {
+        if (encoding == ColumnEncoding::RLE) {
+            if constexpr (is_arithmetic_v<T>) {
+                vector<T> runValues;
+                vector<uint32_t> runLengths;
+                for (size_t i = 0; i < values.size(); i++) {
+                    if (!runValues.empty() && sameValue(runValues.back(), values[i]) && runLengths.back() < UINT32_MAX) {
+                        runLengths.back()++;
+                    } else {
+                        runValues.push_back(values[i]);
+                        runLengths.push_back(1);
+                    }
+                }
+
+                appendValue<uint64_t>(out, runValues.size());
+                size_t position = out.size();
+                out.resize(position + runValues.size() * sizeof(T) + runLengths.size() * sizeof(uint32_t));
+                memcpy(out.data() + position, runValues.data(), runValues.size() * sizeof(T));
+                memcpy(out.data() + position + runValues.size() * sizeof(T), runLengths.data(), runLengths.size() * sizeof(uint32_t));
+                return;
+            }
+        } else if (encoding == ColumnEncoding::DELTA) {
+            if constexpr (is_integral_v<T>) {
+                int64_t previous = 0;
+                for (const auto& value : values) {
+                    appendVarint(out, zigZag(static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(previous))));
+                    previous = value;
+                }
+                return;
+            }
+        } else if (encoding == ColumnEncoding::BIT_PACKED) {
+            if constexpr (is_integral_v<T>) {
+                int64_t reference = values.empty() ? 0 : values[0];
+                int64_t maximum = reference;
+                for (const auto& value : values) {
+                    if (value < reference) reference = value;
+                    if (value > maximum) maximum = value;
+                }
+                uint8_t width = bitWidth(static_cast<uint64_t>(maximum) - static_cast<uint64_t>(reference));
+                if (width > MAX_PACKED_WIDTH) {
+                    throw runtime_error("Column range is too wide to be bit-packed.");
+                }
+
+                vector<uint64_t> offsets(values.size());
+                for (size_t i = 0; i < values.size(); i++) {
+                    offsets[i] = static_cast<uint64_t>(static_cast<int64_t>(values[i])) - static_cast<uint64_t>(reference);
+                }
+
+                appendValue<int64_t>(out, reference);
+                appendValue<uint64_t>(out, width);
+                appendPacked(out, offsets.data(), offsets.size(), width);
+                return;
+            }
+        } else if (encoding == ColumnEncoding::DICTIONARY) {
+            if constexpr (is_same_v<T, string>) {
+                unordered_map<string_view, uint64_t> dictionary;
+                vector<string_view> distinctValues;
+                vector<uint64_t> indexes(values.size());
+                for (size_t i = 0; i < values.size(); i++) {
+                    auto [it, inserted] = dictionary.emplace(values[i], distinctValues.size());
+                    if (inserted) distinctValues.push_back(values[i]);
+                    indexes[i] = it->second;
+                }
+                uint8_t width = bitWidth(distinctValues.empty() ? 0 : distinctValues.size() - 1);
+
+                appendValue<uint64_t>(out, distinctValues.size());
+                uint64_t offset = 0;
+                appendValue<uint64_t>(out, offset);
+                for (const auto& value : distinctValues) {
+                    offset += value.size();
+                    appendValue<uint64_t>(out, offset);
+                }
+                for (const auto& value : distinctValues) {
+                    out.insert(out.end(), value.begin(), value.end());
+                }
+                out.push_back(width);
+                appendPacked(out, indexes.data(), indexes.size(), width);
+                return;
+            }
+        }
+
+        throw runtime_error("Encoding not supported for the column type.");
+    }
+
+    /**
+     * @brief Decode a column block.
+     *
+     * @param data The encoded block.
+     * @param size The size of the encoded block.
+     * @param count The number of values in the column.
+     * @param encoding The encoding of the block.
+     * @return The decoded values.
+     * @throws runtime_error If the block is corrupted or the encoding does not apply to the column type.
+     */
+    template<typename T>
+    vector<T> decode(const uint8_t* data, size_t size, size_t count, ColumnEncoding encoding) {
+        BlockReader reader(data, size);
+
+        if (encoding == ColumnEncoding::RLE) {
+            if constexpr (is_arithmetic_v<T>) {
+                uint64_t runs = reader.read<uint64_t>();
+                if (runs > size) throw runtime_error("Encoded column block is corrupted.");
+                const uint8_t* runValues = reader.take(runs * sizeof(T));
+                const uint8_t* runLengths = reader.take(runs * sizeof(uint32_t));
+
+                // The runs must add up to the row count before the values are allocated
+                vector<uint32_t> lengths(runs);
+                memcpy(lengths.data(), runLengths, runs * sizeof(uint32_t));
+                uint64_t total = 0;
+                for (uint32_t length : lengths) total += length;
+                if (total != count) throw runtime_error("Encoded column block is corrupted.");
+
+                vector<T> values(count);
+                size_t position = 0;
+                for (uint64_t run = 0; run < runs; run++) {
+                    T value;
+                    memcpy(&value, runValues + run * sizeof(T), sizeof(T));
+                    fill_n(values.data() + position, lengths[run], value);
+                    position += lengths[run];
+                }
+                return values;
+            }
+        } else if (encoding == ColumnEncoding::DELTA) {
+            if constexpr (is_integral_v<T>) {
+                // Each delta takes at least one byte
+                if (count > size) throw runtime_error("Encoded column block is corrupted.");
+                vector<T> values(count);
+                uint64_t previous = 0;
+                for (size_t i = 0; i < count; i++) {
+                    previous += static_cast<uint64_t>(unZigZag(reader.readVarint()));
+                    values[i] = static_cast<T>(static_cast<int64_t>(previous));
+                }
+                return values;
+            }
+        } else if (encoding == ColumnEncoding::BIT_PACKED) {
+            if constexpr (is_integral_v<T>) {
+                int64_t reference = reader.read<int64_t>();
+                uint64_t width = reader.read<uint64_t>();
+                if (width > MAX_PACKED_WIDTH || !fitsPacked(count, width, size)) throw runtime_error("Encoded column block is corrupted.");
+                const uint8_t* packed = reader.take(packedSize(count, width));
+                vector<T> values(count);
+                unpack(packed, count, static_cast<uint8_t>(width), reference, values.data());
+                return values;
+            }
+        } else if (encoding == ColumnEncoding::DICTIONARY) {
+            if constexpr (is_same_v<T, string>) {
+                uint64_t distinct = reader.read<uint64_t>();
+                if (distinct > size) throw runtime_error("Encoded column block is corrupted.");
+                const uint8_t* offsetBytes = reader.take((distinct + 1) * sizeof(uint64_t));
+                vector<uint64_t> offsets(distinct + 1);
+                memcpy(offsets.data(), offsetBytes, offsets.size() * sizeof(uint64_t));
+                if (offsets[0] != 0) throw runtime_error("Encoded column block is corrupted.");
+                for (size_t i = 0; i < distinct; i++) {
+                    if (offsets[i + 1] < offsets[i]) throw runtime_error("Encoded column block is corrupted.");
+                }
+                const char* chars = reinterpret_cast<const char*>(reader.take(offsets[distinct]));
+
+                vector<string> dictionary(distinct);
+                for (size_t i = 0; i < distinct; i++) {
+                    dictionary[i].assign(chars + offsets[i], offsets[i + 1] - offsets[i]);
+                }
+
+                uint8_t width = reader.read<uint8_t>();
+                if (width > MAX_PACKED_WIDTH || !fitsPacked(count, width, size)) throw runtime_error("Encoded column block is corrupted.");
+                vector<uint64_t> indexes(count);
+                unpack(reader.take(packedSize(count, width)), count, width, 0, indexes.data());
+
+                vector<T> values(count);
+                for (size_t i = 0; i < count; i++) {
+                    if (indexes[i] >= distinct) throw runtime_error("Encoded column block is corrupted.");
+                    values[i] = dictionary[indexes[i]];
+                }
+                return values;
+            }
+        }
+
+        throw runtime_error("Encoding not supported for the column type.");
+    }
+}
+
+#endif // COLUMN_ENCODING_HPP
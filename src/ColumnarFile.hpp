@@ -0,0 +1,694 @@
+#ifndef COLUMNAR_FILE_HPP
+#define COLUMNAR_FILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DataFrame.hpp"
+#include "ColumnEncoding.hpp"
+
+using namespace std;
+
+/**
+ * @brief The type tags of the columns stored in a columnar file.
+ */
+enum class ColumnType : uint8_t {
+    INT32 = 1,
+    INT64 = 2,
+    FLOAT32 = 3,
+    FLOAT64 = 4,
+    CHAR = 5,
+    STRING = 6
+};
+
+/**
+ * @brief Layout of the native binary columnar file format.
+ *
+ * A file is made of:
+ * - a 64 byte header (magic, version, byte order, row count, timestamp and column count);
+ * - the schema, with the type, encoding and name of each column;
+ * - one block per column, each starting at a 64 byte aligned offset. Plain fixed size columns are
+ *   stored as an array of values. Plain string columns are stored as (rows + 1) uint64 offsets followed
+ *   by the concatenated characters. Encoded columns are stored as described in ColumnEncoding.hpp;
+ * - the footer index, with the offset and size of each column block;
+ * - a trailer with the offset of the footer index.
+ *
+ * The values are stored in the native byte order, so a mapped plain column can be read without any copy.
+ */
+namespace columnar {
+    constexpr char MAGIC[8] = {'D', 'F', 'C', 'O', 'L', 'U', 'M', 'N'};
+    constexpr char TRAILER_MAGIC[8] = {'D', 'F', 'C', 'O', 'L', 'E', 'N', 'D'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr size_t ALIGNMENT = 64;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t rowCount;
+        int64_t timestamp;
+        uint32_t columnCount;
+        uint32_t schemaSize;
+        uint8_t reserved[24];
+    };
+    static_assert(sizeof(FileHeader) == 64, "The header must fill one aligned block.");
+
+    struct SchemaEntry {
+        uint8_t type;
+        uint8_t encoding;
+        uint16_t reserved;
+        uint32_t nameLength;
+    };
+
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct FileTrailer {
+        uint64_t footerOffset;
+        uint32_t columnCount;
+        uint32_t reserved;
+        char magic[8];
+    };
+
+    /**
+     * @brief Get the type tag of a C++ type.
+     *
+     * @tparam T The type of the column values.
+     * @return The type tag of the column.
+     */
+    template<typename T>
+    constexpr ColumnType columnTypeOf() {
+        if constexpr (is_same_v<T, int>) return ColumnType::INT32;
+        else if constexpr (is_same_v<T, long long>) return ColumnType::INT64;
+        else if constexpr (is_same_v<T, float>) return ColumnType::FLOAT32;
+        else if constexpr (is_same_v<T, double>) return ColumnType::FLOAT64;
+        else if constexpr (is_same_v<T, char>) return ColumnType::CHAR;
+        else if constexpr (is_same_v<T, string>) return ColumnType::STRING;
+        else static_assert(is_same_v<T, int>, "Type not supported by the columnar format.");
+    }
+
+    /**
+     * @brief Get the type tag of a column from the type information of its series.
+     *
+     * @param type The type information of the series.
+     * @return The type tag of the column.
+     * @throws runtime_error If the type is not supported by the format.
+     */
+    inline ColumnType columnTypeOf(const type_info& type) {
+        if (type == typeid(int)) return ColumnType::INT32;
+        if (type == typeid(long long)) return ColumnType::INT64;
+        if (type == typeid(float)) return ColumnType::FLOAT32;
+        if (type == typeid(double)) return ColumnType::FLOAT64;
+        if (type == typeid(char)) return ColumnType::CHAR;
+        if (type == typeid(string)) return ColumnType::STRING;
+        throw runtime_error("Type not supported by the columnar format: " + string(type.name()));
+    }
+
+    /**
+     * @brief Get the size in bytes of a value of a fixed size column type.
+     *
+     * @param type The type tag of the column.
+     * @return The size of a value, or 0 for variable size types.
+     */
+    inline size_t valueSize(ColumnType type) {
+        switch (type) {
+            case ColumnType::INT32: return sizeof(int);
+            case ColumnType::INT64: return sizeof(long long);
+            case ColumnType::FLOAT32: return sizeof(float);
+            case ColumnType::FLOAT64: return sizeof(double);
+            case ColumnType::CHAR: return sizeof(char);
+            default: return 0;
+        }
+    }
+
+    /**
+     * @brief Round an offset up to the block alignment.
+     */
+    inline uint64_t alignUp(uint64_t offset) {
+        return (offset + ALIGNMENT - 1) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+    }
+}
+
+/**
+ * @brief A read-only view of a columnar file mapped in memory.
+ *
+ * The file is mapped with mmap and its columns are exposed as spans that point directly
+ * into the mapping, so reading a column does not copy nor parse any data.
+ * The spans are valid while the ColumnarFile object is alive.
+ */
+class ColumnarFile {
+private:
+    /**
+     * @brief Information of a column block in the mapped file.
+     */
+    struct ColumnInfo {
+        string name;
+        ColumnType type;
+        ColumnEncoding encoding;
+        const uint8_t* data;
+        uint64_t size;
+    };
+
+    int fd = -1; /**< The descriptor of the mapped file. */
+    const uint8_t* base = nullptr; /**< The start of the mapping. */
+    size_t fileSize = 0; /**< The size of the mapping. */
+    uint64_t rowCount = 0; /**< The number of rows of each column. */
+    long long timestamp = 0; /**< The timestamp of the stored DataFrame. */
+    vector<ColumnInfo> columnInfo; /**< The columns of the file. */
+
+    /**
+     * @brief Check the header, schema, index and trailer of the mapped file.
+     *
+     * @param path The path of the file, used in the error messages.
+     * @throws runtime_error If the file is not a valid columnar file.
+     */
+    void parseLayout(const string& path) {
+        using namespace columnar;
+
+        if (fileSize < sizeof(FileHeader) + sizeof(FileTrailer)) {
+            throw runtime_error("Columnar file is truncated: " + path);
+        }
+
+        FileHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw runtime_error("Not a columnar file: " + path);
+        }
+        if (header.version != VERSION) {
+            throw runtime_error("Unsupported columnar file version " + to_string(header.version) + ": " + path);
+        }
+        if (header.byteOrder != BYTE_ORDER_MARK) {
+            throw runtime_error("Columnar file written with another byte order: " + path);
+        }
+
+        FileTrailer trailer;
+        memcpy(&trailer, base + fileSize - sizeof(trailer), sizeof(trailer));
+        if (memcmp(trailer.magic, TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0 || trailer.columnCount != header.columnCount) {
+            throw runtime_error("Columnar file has an invalid trailer: " + path);
+        }
+
+        uint64_t indexSize = static_cast<uint64_t>(header.columnCount) * sizeof(IndexEntry);
+        if (trailer.footerOffset > fileSize - sizeof(trailer) || indexSize > fileSize - sizeof(trailer) - trailer.footerOffset) {
+            throw runtime_error("Columnar file has an invalid footer index: " + path);
+        }
+        if (header.schemaSize > trailer.footerOffset - sizeof(FileHeader)) {
+            throw runtime_error("Columnar file has an invalid schema: " + path);
+        }
+
+        rowCount = header.rowCount;
+        timestamp = header.timestamp;
+
+        const uint8_t* schema = base + sizeof(FileHeader);
+        const uint8_t* schemaEnd = schema + header.schemaSize;
+        const uint8_t* index = base + trailer.footerOffset;
+
+        columnInfo.reserve(header.columnCount);
+        for (uint32_t i = 0; i < header.columnCount; i++) {
+            SchemaEntry entry;
+            if (schemaEnd - schema < static_cast<ptrdiff_t>(sizeof(entry))) {
+                throw runtime_error("Columnar file has an invalid schema: " + path);
+            }
+            memcpy(&entry, schema, sizeof(entry));
+            schema += sizeof(entry);
+            if (static_cast<uint64_t>(schemaEnd - schema) < entry.nameLength) {
+                throw runtime_error("Columnar file has an invalid schema: " + path);
+            }
+
+            IndexEntry location;
+            memcpy(&location, index + i * sizeof(IndexEntry), sizeof(location));
+            if (location.offset % ALIGNMENT != 0 || location.offset > trailer.footerOffset || location.size > trailer.footerOffset - location.offset) {
+                throw runtime_error("Columnar file has an invalid column block: " + path);
+            }
+
+            ColumnInfo info;
+            info.name.assign(reinterpret_cast<const char*>(schema), entry.nameLength);
+            info.type = static_cast<ColumnType>(entry.type);
+            info.encoding = static_cast<ColumnEncoding>(entry.encoding);
+            info.data = base + location.offset;
+            info.size = location.size;
+            schema += entry.nameLength;
+
+            validateColumn(info, path);
+            columnInfo.push_back(std::move(info));
+        }
+    }
+
+    /**
+     * @brief Check that the size of a plain column block matches its type and the row count.
+     */
+    void validateColumn(const ColumnInfo& info, const string& path) const {
+        if (info.type < ColumnType::INT32 || info.type > ColumnType::STRING) {
+            throw runtime_error("Unsupported type in column " + info.name + ": " + path);
+        }
+
+        // Encoded blocks are checked while they are decoded
+        if (info.encoding != ColumnEncoding::PLAIN) {
+            if (info.encoding > ColumnEncoding::DICTIONARY) {
+                throw runtime_error("Unsupported encoding in column " + info.name + ": " + path);
+            }
+            return;
+        }
+
+        // Every row takes at least one byte in a plain block
+        if (rowCount > info.size) {
+            throw runtime_error("Column " + info.name + " does not match the row count: " + path);
+        }
+
+        if (info.type == ColumnType::STRING) {
+            uint64_t offsetsSize = (rowCount + 1) * sizeof(uint64_t);
+            if (info.size < offsetsSize) {
+                throw runtime_error("Column " + info.name + " is truncated: " + path);
+            }
+
+            // The offsets must be increasing and must not go beyond the block
+            const uint64_t* offsets = reinterpret_cast<const uint64_t*>(info.data);
+            if (offsets[0] != 0) throw runtime_error("Column " + info.name + " has invalid offsets: " + path);
+            for (uint64_t row = 0; row < rowCount; row++) {
+                if (offsets[row + 1] < offsets[row]) throw runtime_error("Column " + info.name + " has invalid offsets: " + path);
+            }
+            if (offsets[rowCount] > info.size - offsetsSize) {
+                throw runtime_error("Column " + info.name + " is truncated: " + path);
+            }
+            return;
+        }
+
+        size_t size = columnar::valueSize(info.type);
+        if (info.size != rowCount * size) {
+            throw runtime_error("Column " + info.name + " does not match the row count: " + path);
+        }
+    }
+
+    /**
+     * @brief Get a column after checking its index.
+     */
+    const ColumnInfo& getColumnInfo(size_t columnIndex) const {
+        if (columnIndex >= columnInfo.size()) {
+            throw runtime_error("Index out of bounds.");
+        }
+        return columnInfo[columnIndex];
+    }
+
+    /**
+     * @brief Get a plain column after checking its index, type and encoding.
+     */
+    const ColumnInfo& getPlainColumnInfo(size_t columnIndex, ColumnType type) const {
+        const ColumnInfo& info = getColumnInfo(columnIndex);
+        if (info.type != type) {
+            throw runtime_error("Type mismatch error: Unable to read column " + info.name + " with another type.");
+        }
+        if (info.encoding != ColumnEncoding::PLAIN) {
+            throw runtime_error("Column " + info.name + " is encoded and cannot be read in place, use readColumn.");
+        }
+        return info;
+    }
+
+    /**
+     * @brief Copy or decode a column into a column of a DataFrame.
+     */
+    template<typename T>
+    void copyColumn(DataFrame& df, size_t columnIndex) const {
+        df.setColumnData(columnIndex, readColumn<T>(columnIndex));
+    }
+
+    /**
+     * @brief Get the values of a series.
+     */
+    template<typename T>
+    static const vector<T>& seriesData(const ISeries& series) {
+        return static_cast<const Series<T>&>(series).getData();
+    }
+
+    /**
+     * @brief Write a column block, choosing its encoding from its statistics if requested.
+     *
+     * @return The encoding used for the block.
+     */
+    template<typename T>
+    static ColumnEncoding writeColumn(ofstream& out, const ISeries& series, bool encode) {
+        const vector<T>& values = seriesData<T>(series);
+        ColumnEncoding columnEncoding = encode ? encoding::chooseEncoding(values) : ColumnEncoding::PLAIN;
+
+        if (columnEncoding == ColumnEncoding::PLAIN) {
+            if constexpr (is_same_v<T, string>) writeStringColumn(out, series);
+            else writeFixedColumn<T>(out, series);
+            return columnEncoding;
+        }
+
+        vector<uint8_t> block;
+        encoding::encode(values, columnEncoding, block);
+        out.write(reinterpret_cast<const char*>(block.data()), block.size());
+        return columnEncoding;
+    }
+
+    /**
+     * @brief Write a fixed size column block from a series.
+     */
+    template<typename T>
+    static void writeFixedColumn(ofstream& out, const ISeries& series) {
+        const vector<T>& values = seriesData<T>(series);
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    /**
+     * @brief Write a string column block from a series.
+     */
+    static void writeStringColumn(ofstream& out, const ISeries& series) {
+        const vector<string>& values = seriesData<string>(series);
+
+        vector<uint64_t> offsets(values.size() + 1);
+        offsets[0] = 0;
+        for (size_t row = 0; row < values.size(); row++) {
+            offsets[row + 1] = offsets[row] + values[row].size();
+        }
+        out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+        for (const auto& value : values) {
+            out.write(value.data(), value.size());
+        }
+    }
+
+    /**
+     * @brief Pad the stream with zeros up to the next aligned offset.
+     */
+    static uint64_t padToAlignment(ofstream& out, uint64_t position) {
+        static const char zeros[columnar::ALIGNMENT] = {};
+        uint64_t aligned = columnar::alignUp(position);
+        out.write(zeros, aligned - position);
+        return aligned;
+    }
+
+public:
+    /**
+     * @brief Map a columnar file and check its layout.
+     *
+     * @param path The path of the file.
+     * @throws runtime_error If the file cannot be mapped or is not a valid columnar file.
+     */
+    explicit ColumnarFile(const string& path) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw runtime_error("Failed to open columnar file: " + path);
+        }
+
+        struct stat statbuf;
+        if (fstat(fd, &statbuf) != 0 || statbuf.st_size <= 0) {
+            close(fd);
+            throw runtime_error("Failed to read columnar file: " + path);
+        }
+        fileSize = static_cast<size_t>(statbuf.st_size);
+
+        void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Failed to map columnar file: " + path);
+        }
+        base = static_cast<const uint8_t*>(mapping);
+
+        try {
+            parseLayout(path);
+        } catch (...) {
+            munmap(const_cast<uint8_t*>(base), fileSize);
+            close(fd);
+            throw;
+        }
+    }
+
+    // The mapping is owned by the object
+    ColumnarFile(const ColumnarFile&) = delete;
+    ColumnarFile& operator=(const ColumnarFile&) = delete;
+
+    /**
+     * @brief Unmap the file.
+     */
+    ~ColumnarFile() {
+        munmap(const_cast<uint8_t*>(base), fileSize);
+        close(fd);
+    }
+
+    /**
+     * @brief Get the number of rows in the file.
+     */
+    size_t getRowCount() const {
+        return rowCount;
+    }
+
+    /**
+     * @brief Get the number of columns in the file.
+     */
+    size_t getColumnCount() const {
+        return columnInfo.size();
+    }
+
+    /**
+     * @brief Get the timestamp of the stored DataFrame.
+     */
+    long long getTimestamp() const {
+        return timestamp;
+    }
+
+    /**
+     * @brief Get the name of a column.
+     *
+     * @param columnIndex The index of the column.
+     * @return The name of the column.
+     * @throws runtime_error If the column index is out of bounds.
+     */
+    const string& getColumnName(size_t columnIndex) const {
+        return getColumnInfo(columnIndex).name;
+    }
+
+    /**
+     * @brief Get the type tag of a column.
+     *
+     * @param columnIndex The index of the column.
+     * @return The type tag of the column.
+     * @throws runtime_error If the column index is out of bounds.
+     */
+    ColumnType getColumnType(size_t columnIndex) const {
+        return getColumnInfo(columnIndex).type;
+    }
+
+    /**
+     * @brief Get the values of a fixed size column without copying them.
+     *
+     * @tparam T The type of the column values.
+     * @param columnIndex The index of the column.
+     * @return A span pointing into the mapped file.
+     * @throws runtime_error If the column index is out of bounds, T does not match the column type
+     *                       or the column is encoded.
+     */
+    template<typename T>
+    span<const T> getColumn(size_t columnIndex) const {
+        static_assert(!is_same_v<T, string>, "Use getStringAt to read string columns.");
+
+        const ColumnInfo& info = getPlainColumnInfo(columnIndex, columnar::columnTypeOf<T>());
+        return span<const T>(reinterpret_cast<const T*>(info.data), rowCount);
+    }
+
+    /**
+     * @brief Get the encoding of a column.
+     *
+     * @param columnIndex The index of the column.
+     * @return The encoding of the column block.
+     * @throws runtime_error If the column index is out of bounds.
+     */
+    ColumnEncoding getColumnEncoding(size_t columnIndex) const {
+        return getColumnInfo(columnIndex).encoding;
+    }
+
+    /**
+     * @brief Copy the values of a column, decoding them if the column is encoded.
+     *
+     * @tparam T The type of the column values.
+     * @param columnIndex The index of the column.
+     * @return The values of the column.
+     * @throws runtime_error If the column index is out of bounds, T does not match the column type
+     *                       or the encoded block is corrupted.
+     */
+    template<typename T>
+    vector<T> readColumn(size_t columnIndex) const {
+        const ColumnInfo& info = getColumnInfo(columnIndex);
+        if (info.type != columnar::columnTypeOf<T>()) {
+            throw runtime_error("Type mismatch error: Unable to read column " + info.name + " as " + string(typeid(T).name()));
+        }
+
+        if (info.encoding != ColumnEncoding::PLAIN) {
+            return encoding::decode<T>(info.data, info.size, rowCount, info.encoding);
+        }
+
+        if constexpr (is_same_v<T, string>) {
+            vector<string> values;
+            values.reserve(rowCount);
+            for (size_t row = 0; row < rowCount; row++) values.emplace_back(getStringAt(columnIndex, row));
+            return values;
+        } else {
+            span<const T> values = getColumn<T>(columnIndex);
+            return vector<T>(values.begin(), values.end());
+        }
+    }
+
+    /**
+     * @brief Get a value of a string column without copying it.
+     *
+     * @param columnIndex The index of the column.
+     * @param rowIndex The index of the row.
+     * @return A view pointing into the mapped file.
+     * @throws runtime_error If an index is out of bounds, the column is not a string column or the column is encoded.
+     */
+    string_view getStringAt(size_t columnIndex, size_t rowIndex) const {
+        const ColumnInfo& info = getPlainColumnInfo(columnIndex, ColumnType::STRING);
+        if (rowIndex >= rowCount) {
+            throw runtime_error("Index out of bounds.");
+        }
+
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(info.data);
+        const char* chars = reinterpret_cast<const char*>(offsets + rowCount + 1);
+        return string_view(chars + offsets[rowIndex], offsets[rowIndex + 1] - offsets[rowIndex]);
+    }
+
+    /**
+     * @brief Copy the file into a new DataFrame.
+     *
+     * Each plain fixed size column is copied in a single block and each encoded column is decoded
+     * in a single pass, without parsing nor type inference.
+     *
+     * @return A pointer to the new DataFrame.
+     */
+    DataFrame* toDataFrame() const {
+        vector<string> names;
+        for (const auto& info : columnInfo) names.push_back(info.name);
+
+        DataFrame* df = new DataFrame(names);
+        for (size_t i = 0; i < columnInfo.size(); i++) {
+            switch (columnInfo[i].type) {
+                case ColumnType::INT32: copyColumn<int>(*df, i); break;
+                case ColumnType::INT64: copyColumn<long long>(*df, i); break;
+                case ColumnType::FLOAT32: copyColumn<float>(*df, i); break;
+                case ColumnType::FLOAT64: copyColumn<double>(*df, i); break;
+                case ColumnType::CHAR: copyColumn<char>(*df, i); break;
+                case ColumnType::STRING: copyColumn<string>(*df, i); break;
+            }
+        }
+        df->setTimestamp(timestamp);
+
+        return df;
+    }
+
+    /**
+     * @brief Write a DataFrame to a columnar file.
+     *
+     * @param df The DataFrame to be written.
+     * @param destName The path of the file.
+     * @param encode If true, each column is stored with the encoding chosen from its statistics,
+     *               otherwise all the columns are stored plain and can be read in place.
+     * @throws runtime_error If a column type is not supported or the file cannot be written.
+     */
+    static void write(DataFrame* df, const string& destName, bool encode = false) {
+        using namespace columnar;
+
+        size_t columnCount = df->getColumnCount();
+        size_t rows = df->getRowCount();
+
+        // Resolve the series and the type of each column
+        vector<shared_ptr<ISeries>> series;
+        vector<string> names;
+        vector<ColumnType> types;
+        for (size_t i = 0; i < columnCount; i++) {
+            names.push_back(df->getColumnName(i));
+            series.push_back(df->getColumnPtr(names.back()));
+            types.push_back(columnTypeOf(series.back()->type()));
+            if (series.back()->size() != rows) {
+                throw runtime_error("Column " + names.back() + " does not match the row count.");
+            }
+        }
+
+        ofstream out(destName, ios::binary | ios::trunc);
+        if (!out.is_open()) {
+            throw runtime_error("Failed to open columnar file: " + destName);
+        }
+
+        // Header
+        FileHeader header = {};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.rowCount = rows;
+        header.timestamp = df->getTimestamp();
+        header.columnCount = static_cast<uint32_t>(columnCount);
+        for (const auto& name : names) header.schemaSize += sizeof(SchemaEntry) + name.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Schema, with the encodings patched once the column blocks are written
+        vector<SchemaEntry> schema(columnCount);
+        for (size_t i = 0; i < columnCount; i++) {
+            schema[i] = {static_cast<uint8_t>(types[i]), static_cast<uint8_t>(ColumnEncoding::PLAIN), 0, static_cast<uint32_t>(names[i].size())};
+            out.write(reinterpret_cast<const char*>(&schema[i]), sizeof(SchemaEntry));
+            out.write(names[i].data(), names[i].size());
+        }
+        uint64_t position = sizeof(header) + header.schemaSize;
+
+        // Column blocks
+        vector<IndexEntry> index(columnCount);
+        for (size_t i = 0; i < columnCount; i++) {
+            position = padToAlignment(out, position);
+            index[i].offset = position;
+
+            ColumnEncoding columnEncoding = ColumnEncoding::PLAIN;
+            switch (types[i]) {
+                case ColumnType::INT32: columnEncoding = writeColumn<int>(out, *series[i], encode); break;
+                case ColumnType::INT64: columnEncoding = writeColumn<long long>(out, *series[i], encode); break;
+                case ColumnType::FLOAT32: columnEncoding = writeColumn<float>(out, *series[i], encode); break;
+                case ColumnType::FLOAT64: columnEncoding = writeColumn<double>(out, *series[i], encode); break;
+                case ColumnType::CHAR: columnEncoding = writeColumn<char>(out, *series[i], encode); break;
+                case ColumnType::STRING: columnEncoding = writeColumn<string>(out, *series[i], encode); break;
+            }
+            schema[i].encoding = static_cast<uint8_t>(columnEncoding);
+
+            uint64_t end = static_cast<uint64_t>(out.tellp());
+            index[i].size = end - position;
+            position = end;
+        }
+
+        // Footer index and trailer
+        position = padToAlignment(out, position);
+        out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(IndexEntry));
+
+        FileTrailer trailer = {};
+        trailer.footerOffset = position;
+        trailer.columnCount = static_cast<uint32_t>(columnCount);
+        memcpy(trailer.magic, TRAILER_MAGIC, sizeof(TRAILER_MAGIC));
+        out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+        // Patch the encodings of the schema
+        if (encode) {
+            uint64_t schemaPosition = sizeof(header);
+            for (size_t i = 0; i < columnCount; i++) {
+                out.seekp(schemaPosition);
+                out.write(reinterpret_cast<const char*>(&schema[i]), sizeof(SchemaEntry));
+                schemaPosition += sizeof(SchemaEntry) + names[i].size();
+            }
+        }
+
+        // A short write, such as on a full disk, only shows once the stream is flushed
+        out.close();
+        if (out.fail()) {
+            throw runtime_error("Failed to write columnar file: " + destName);
+        }
+    }
+};
+
+#endif // COLUMNAR_FILE_HPP
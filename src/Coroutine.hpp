@@ -0,0 +1,208 @@
+#ifndef COROUTINE_HPP
+#define COROUTINE_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <type_traits>
+
+#include "Future.hpp"
+
+using namespace std;
+
+/**
+ * @brief The result of a coroutine, set by co_return.
+ */
+template <typename T>
+struct CoroutineResult {
+    optional<T> value; /**< The value, once returned. */
+
+    void return_value(T result) {
+        value.emplace(std::move(result));
+    }
+};
+
+template <>
+struct CoroutineResult<void> {
+    optional<monostate> value; /**< Set once the coroutine returns. */
+
+    void return_void() {
+        value.emplace();
+    }
+};
+
+/**
+ * @brief Class for a coroutine that runs on an executor, such as the one of a ThreadPool.
+ *
+ * A Coroutine starts suspended. Started on an executor, it gives the Future of its result and frees itself
+ * once it returns. Awaited by another coroutine, it runs on the executor of that coroutine and resumes it
+ * once it returns, without going through the executor.
+ *
+ * While it waits on a queue or a Future, the coroutine is suspended and its thread runs other jobs; it is
+ * resumed on its executor once it can go on. Many coroutines can so share a few threads.
+ */
+template <typename T = void>
+class Coroutine {
+public:
+    struct promise_type;
+    using Handle = coroutine_handle<promise_type>;
+
+    /**
+     * @brief Hands the result over once the coroutine returns.
+     */
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        coroutine_handle<> await_suspend(Handle handle) noexcept {
+            promise_type& promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+
+            // Started on its own: free the frame, then set the Future, whose waiters may free what it uses
+            Promise<T> completion = std::move(*promise.completion);
+            exception_ptr error = promise.error;
+            optional<conditional_t<is_void_v<T>, monostate, T>> value = std::move(promise.value);
+            handle.destroy();
+
+            if (error) completion.setException(error);
+            else if constexpr (is_void_v<T>) completion.setValue();
+            else completion.setValue(std::move(*value));
+            return noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    /**
+     * @brief The promise of the coroutine, which keeps its executor and its result.
+     */
+    struct promise_type : CoroutineResult<T> {
+        Executor executor; /**< Runs the coroutine, and resumes it after it waits. */
+        coroutine_handle<> continuation; /**< The coroutine awaiting this one, if any. */
+        optional<Promise<T>> completion; /**< The Promise of the result, for a started coroutine. */
+        exception_ptr error; /**< The exception thrown by the coroutine. */
+
+        Coroutine get_return_object() {
+            return Coroutine(Handle::from_promise(*this));
+        }
+
+        suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void unhandled_exception() {
+            error = current_exception();
+        }
+
+        const Executor& getExecutor() const {
+            return executor;
+        }
+    };
+
+    Coroutine(Coroutine&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    /**
+     * @brief Destroy the Coroutine object, and the coroutine if it was not started.
+     */
+    ~Coroutine() {
+        if (handle) handle.destroy();
+    }
+
+    /**
+     * @brief Start the coroutine on an executor.
+     *
+     * @param executor Runs the coroutine, inline if it is empty.
+     * @return The Future of the result of the coroutine.
+     */
+    Future<T> start(Executor executor) && {
+        Handle started = exchange(handle, nullptr);
+        promise_type& promise = started.promise();
+        promise.executor = executor;
+        promise.completion.emplace(executor);
+        Future<T> future = promise.completion->getFuture();
+
+        if (executor) executor([started] { started.resume(); });
+        else started.resume();
+        return future;
+    }
+
+    /**
+     * @brief Await the coroutine from another one, which it runs on the same executor.
+     */
+    struct Awaiter {
+        Handle child;
+
+        bool await_ready() {
+            return false;
+        }
+
+        template <typename Promise>
+        coroutine_handle<> await_suspend(coroutine_handle<Promise> parent) {
+            child.promise().executor = parent.promise().getExecutor();
+            child.promise().continuation = parent;
+            return child;
+        }
+
+        T await_resume() {
+            promise_type& promise = child.promise();
+            if (promise.error) rethrow_exception(promise.error);
+            if constexpr (!is_void_v<T>) return std::move(*promise.value);
+        }
+    };
+
+    Awaiter operator co_await() && {
+        return Awaiter{handle};
+    }
+
+private:
+    explicit Coroutine(Handle handle) : handle(handle) {}
+
+    Handle handle;
+};
+
+/**
+ * @brief Awaitable of a Future, which resumes the coroutine on its executor once the result is set.
+ */
+template <typename T>
+struct FutureAwaiter {
+    Future<T> future;
+
+    bool await_ready() {
+        return future.isReady();
+    }
+
+    template <typename Promise>
+    void await_suspend(coroutine_handle<Promise> handle) {
+        Executor executor = handle.promise().getExecutor();
+        future.onReady([handle, executor] {
+            if (executor) executor([handle] { handle.resume(); });
+            else handle.resume();
+        });
+    }
+
+    T await_resume() {
+        return future.get();
+    }
+};
+
+/**
+ * @brief Await a Future from a coroutine, without blocking its thread.
+ *
+ * @param future The Future to wait for.
+ * @return The awaitable, which gives the value or throws the exception of the Future.
+ */
+template <typename T>
+FutureAwaiter<T> operator co_await(Future<T> future) {
+    return FutureAwaiter<T>{std::move(future)};
+}
+
+#endif // COROUTINE_HPP
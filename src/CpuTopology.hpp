@@ -0,0 +1,211 @@
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <cctype>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Class for the NUMA nodes of the machine and their CPUs.
+ *
+ * The topology is read from /sys/devices/system/node, where each nodeN directory lists the CPUs of node N
+ * in its cpulist file. Nodes without CPUs, such as memory-only nodes, are left out. Without the
+ * directory, the machine is taken as a single node with all its CPUs.
+ */
+class CpuTopology {
+private:
+    vector<vector<int>> nodeCpus; /**< The CPUs of each node, in order. */
+
+    /**
+     * @brief Get the CPUs the process may run on.
+     */
+    static vector<int> allowedCpus() {
+        vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            int count = max(1u, thread::hardware_concurrency());
+            for (int cpu = 0; cpu < count; cpu++) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+public:
+    /**
+     * @brief Construct a new CpuTopology object.
+     *
+     * @param nodeCpus The CPUs of each node. Nodes without CPUs are left out.
+     */
+    CpuTopology(const vector<vector<int>>& nodeCpus = {}) {
+        for (const auto& cpus : nodeCpus) {
+            if (!cpus.empty()) this->nodeCpus.push_back(cpus);
+        }
+    }
+
+    /**
+     * @brief Parse a list of CPUs, such as "0-3,8,10-11".
+     *
+     * @param list The list, in the format of the cpulist files.
+     * @return The CPUs, in order.
+     * @throws invalid_argument If the list is malformed.
+     */
+    static vector<int> parseCpuList(const string& list) {
+        vector<int> cpus;
+        stringstream ranges(list);
+        string range;
+        while (getline(ranges, range, ',')) {
+            range.erase(remove_if(range.begin(), range.end(), ::isspace), range.end());
+            if (range.empty()) continue;
+
+            size_t dash = range.find('-');
+            int first = stoi(range.substr(0, dash));
+            int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+        }
+        sort(cpus.begin(), cpus.end());
+        return cpus;
+    }
+
+    /**
+     * @brief Read the topology from a sysfs node directory.
+     *
+     * @param root The directory with the nodeN directories.
+     * @return The topology, with a single node of the allowed CPUs if the directory cannot be read.
+     */
+    static CpuTopology discover(const string& root = "/sys/devices/system/node") {
+        vector<pair<int, vector<int>>> nodes;
+        error_code error;
+        for (const auto& entry : filesystem::directory_iterator(root, error)) {
+            string name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 || !all_of(name.begin() + 4, name.end(), ::isdigit)) continue;
+
+            ifstream file(entry.path() / "cpulist");
+            string list;
+            if (!getline(file, list)) continue;
+            try {
+                nodes.push_back({stoi(name.substr(4)), parseCpuList(list)});
+            } catch (const exception&) {
+                continue;
+            }
+        }
+
+        if (nodes.empty()) return CpuTopology({allowedCpus()});
+
+        sort(nodes.begin(), nodes.end());
+        vector<vector<int>> nodeCpus;
+        for (auto& node : nodes) nodeCpus.push_back(std::move(node.second));
+        return CpuTopology(nodeCpus);
+    }
+
+    /**
+     * @brief Get the topology of the machine, restricted to the CPUs the process may run on.
+     *
+     * @return The topology, discovered once.
+     */
+    static const CpuTopology& system() {
+        static const CpuTopology topology = discover().restrictTo(allowedCpus());
+        return topology;
+    }
+
+    /**
+     * @brief Keep only some CPUs, dropping the nodes left without any.
+     *
+     * @param cpus The CPUs to keep.
+     * @return The restricted topology, or this one if no CPU would be left.
+     */
+    CpuTopology restrictTo(const vector<int>& cpus) const {
+        vector<vector<int>> restricted;
+        for (const auto& node : nodeCpus) {
+            vector<int> kept;
+            for (int cpu : node) {
+                if (find(cpus.begin(), cpus.end(), cpu) != cpus.end()) kept.push_back(cpu);
+            }
+            restricted.push_back(kept);
+        }
+        CpuTopology topology(restricted);
+        return topology.getNodeCount() > 0 ? topology : *this;
+    }
+
+    /**
+     * @brief Get the number of nodes with CPUs.
+     *
+     * @return The number of nodes.
+     */
+    int getNodeCount() const {
+        return static_cast<int>(nodeCpus.size());
+    }
+
+    /**
+     * @brief Get the CPUs of a node.
+     *
+     * @param node The index of the node.
+     * @return The CPUs of the node, in order.
+     */
+    const vector<int>& getCpus(int node) const {
+        return nodeCpus.at(node);
+    }
+
+    /**
+     * @brief Get all the CPUs, node by node.
+     *
+     * @return The CPUs of the first node, then of the second one, and so on.
+     */
+    vector<int> getCpusByNode() const {
+        vector<int> cpus;
+        for (const auto& node : nodeCpus) cpus.insert(cpus.end(), node.begin(), node.end());
+        return cpus;
+    }
+
+    /**
+     * @brief Get the node of a CPU.
+     *
+     * @param cpu The CPU.
+     * @return The index of its node, or -1 if the CPU is unknown.
+     */
+    int getNodeOfCpu(int cpu) const {
+        for (int node = 0; node < getNodeCount(); node++) {
+            if (find(nodeCpus[node].begin(), nodeCpus[node].end(), cpu) != nodeCpus[node].end()) return node;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Pin the calling thread to a set of CPUs.
+     *
+     * @param cpus The CPUs the thread may run on.
+     * @return true If the thread was pinned, false if the platform does not support it.
+     */
+    static bool pinCurrentThread(const vector<int>& cpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif // CPU_TOPOLOGY_HPP
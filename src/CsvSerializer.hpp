@@ -0,0 +1,250 @@
+#ifndef CSV_SERIALIZER_HPP
+#define CSV_SERIALIZER_HPP
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <memory>
+
+#include "DataFrame.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for writing a DataFrame as csv.
+ *
+ * The CsvSerializer resolves the typed data of every column once, then walks the rows in blocks
+ * and formats the cells straight into a reusable buffer: numbers with to_chars and strings with a
+ * copy, quoted only when they contain the delimiter, a quote or a line break. No string is
+ * allocated per cell, and the buffer is kept between calls, so a serializer reused by a thread
+ * only allocates while its buffer grows.
+ *
+ * The numbers are formatted like to_string, so the output is the same as getValueAt.
+ */
+class CsvSerializer {
+private:
+    /**
+     * @brief The kind of the values of a column.
+     */
+    enum class CellKind {
+        INT,
+        LONG,
+        LONG_LONG,
+        FLOAT,
+        DOUBLE,
+        CHAR,
+        STRING,
+        OTHER /**< Formatted through getStringAtIndex. */
+    };
+
+    /**
+     * @brief A column resolved to its typed data.
+     */
+    struct CsvColumn {
+        CellKind kind;
+        const void* data; /**< The vector holding the values of the column. */
+        const ISeries* series;
+    };
+
+    static constexpr size_t ROW_BLOCK = 1024; /**< Rows formatted between two checks of the buffer. */
+    static constexpr size_t MAX_NUMBER_SIZE = 64; /**< Upper bound of a formatted number. */
+
+    char delimiter; /**< The delimiter between the cells. */
+    size_t chunkSize; /**< The size at which the buffer is written to the stream. */
+    vector<char> buffer; /**< The reusable output buffer. */
+    size_t used = 0; /**< The number of bytes of the buffer in use. */
+
+    /**
+     * @brief Resolve the kind and the typed data of a column.
+     */
+    static CsvColumn resolveColumn(const ISeries* series) {
+        const type_info& type = series->type();
+        if (type == typeid(int)) return {CellKind::INT, &static_cast<const Series<int>*>(series)->getData(), series};
+        if (type == typeid(long)) return {CellKind::LONG, &static_cast<const Series<long>*>(series)->getData(), series};
+        if (type == typeid(long long)) return {CellKind::LONG_LONG, &static_cast<const Series<long long>*>(series)->getData(), series};
+        if (type == typeid(float)) return {CellKind::FLOAT, &static_cast<const Series<float>*>(series)->getData(), series};
+        if (type == typeid(double)) return {CellKind::DOUBLE, &static_cast<const Series<double>*>(series)->getData(), series};
+        if (type == typeid(char)) return {CellKind::CHAR, &static_cast<const Series<char>*>(series)->getData(), series};
+        if (type == typeid(string)) return {CellKind::STRING, &static_cast<const Series<string>*>(series)->getData(), series};
+        return {CellKind::OTHER, nullptr, series};
+    }
+
+    /**
+     * @brief Make room for at least size more bytes in the buffer.
+     *
+     * @return A pointer to the first free byte.
+     */
+    char* reserve(size_t size) {
+        if (used + size > buffer.size()) {
+            buffer.resize(max(buffer.size() * 2, used + size));
+        }
+        return buffer.data() + used;
+    }
+
+    /**
+     * @brief Append raw bytes to the buffer.
+     */
+    void append(const char* data, size_t size) {
+        memcpy(reserve(size), data, size);
+        used += size;
+    }
+
+    void append(char c) {
+        *reserve(1) = c;
+        used++;
+    }
+
+    /**
+     * @brief Append a number formatted with to_chars.
+     */
+    template<typename T>
+    void appendNumber(T value) {
+        char* first = reserve(MAX_NUMBER_SIZE);
+        char* last = first + MAX_NUMBER_SIZE;
+        to_chars_result result;
+        if constexpr (is_floating_point_v<T>) {
+            // Same format as to_string
+            result = to_chars(first, last, value, chars_format::fixed, 6);
+        } else {
+            result = to_chars(first, last, value);
+        }
+
+        // Numbers larger than the bound are only possible for huge floats
+        if (result.ec != errc()) {
+            string text = to_string(value);
+            append(text.data(), text.size());
+            return;
+        }
+        used += result.ptr - first;
+    }
+
+    /**
+     * @brief Append a text cell, quoting it only when needed.
+     */
+    void appendText(string_view text) {
+        bool needsQuotes = false;
+        for (char c : text) {
+            if (c == delimiter || c == '"' || c == '\n' || c == '\r') {
+                needsQuotes = true;
+                break;
+            }
+        }
+
+        if (!needsQuotes) {
+            append(text.data(), text.size());
+            return;
+        }
+
+        // Every quote is doubled, so at most twice the text plus the enclosing quotes
+        char* out = reserve(2 * text.size() + 2);
+        char* start = out;
+        *out++ = '"';
+        for (char c : text) {
+            if (c == '"') *out++ = '"';
+            *out++ = c;
+        }
+        *out++ = '"';
+        used += out - start;
+    }
+
+    /**
+     * @brief Append the cell of a column at a row.
+     */
+    void appendCell(const CsvColumn& column, size_t row) {
+        switch (column.kind) {
+            case CellKind::INT: appendNumber((*static_cast<const vector<int>*>(column.data))[row]); break;
+            case CellKind::LONG: appendNumber((*static_cast<const vector<long>*>(column.data))[row]); break;
+            case CellKind::LONG_LONG: appendNumber((*static_cast<const vector<long long>*>(column.data))[row]); break;
+            case CellKind::FLOAT: appendNumber((*static_cast<const vector<float>*>(column.data))[row]); break;
+            case CellKind::DOUBLE: appendNumber((*static_cast<const vector<double>*>(column.data))[row]); break;
+            case CellKind::CHAR: {
+                char c = (*static_cast<const vector<char>*>(column.data))[row];
+                appendText(string_view(&c, 1));
+                break;
+            }
+            case CellKind::STRING: appendText((*static_cast<const vector<string>*>(column.data))[row]); break;
+            case CellKind::OTHER: appendText(column.series->getStringAtIndex(row)); break;
+        }
+    }
+
+    /**
+     * @brief Write the buffer to the stream and empty it.
+     */
+    void flush(ostream& out) {
+        out.write(buffer.data(), used);
+        used = 0;
+    }
+
+public:
+    /**
+     * @brief Construct a new CsvSerializer object.
+     *
+     * @param delimiter The delimiter between the cells.
+     * @param chunkSize The size at which the buffer is written to the stream.
+     */
+    CsvSerializer(char delimiter = ',', size_t chunkSize = 1 << 20) : delimiter(delimiter), chunkSize(chunkSize) {}
+
+    /**
+     * @brief Write a DataFrame as csv, with a header line.
+     *
+     * @param df The DataFrame to be written.
+     * @param out The stream to write to.
+     * @throws runtime_error If a column does not match the row count.
+     */
+    void write(DataFrame* df, ostream& out) {
+        size_t columnCount = df->getColumnCount();
+        size_t rows = df->getRowCount();
+        used = 0;
+
+        // Resolve the typed data of the columns once
+        vector<CsvColumn> columns;
+        columns.reserve(columnCount);
+        for (size_t j = 0; j < columnCount; j++) {
+            string name = df->getColumnName(j);
+            shared_ptr<ISeries> series = df->getColumnPtr(name);
+            if (series->size() != rows) {
+                throw runtime_error("Column " + name + " does not match the row count.");
+            }
+            columns.push_back(resolveColumn(series.get()));
+
+            // Write the header
+            if (j > 0) append(delimiter);
+            appendText(name);
+        }
+        append('\n');
+
+        // Format the rows in blocks, writing the buffer once it reaches the chunk size
+        for (size_t blockStart = 0; blockStart < rows; blockStart += ROW_BLOCK) {
+            size_t blockEnd = min(rows, blockStart + ROW_BLOCK);
+            for (size_t i = blockStart; i < blockEnd; i++) {
+                for (size_t j = 0; j < columnCount; j++) {
+                    if (j > 0) append(delimiter);
+                    appendCell(columns[j], i);
+                }
+                append('\n');
+            }
+
+            if (used >= chunkSize) flush(out);
+        }
+
+        flush(out);
+    }
+
+    /**
+     * @brief Format a DataFrame as csv into a string.
+     *
+     * @param df The DataFrame to be formatted.
+     * @return The csv text.
+     */
+    string toString(DataFrame* df) {
+        ostringstream out;
+        write(df, out);
+        return out.str();
+    }
+};
+
+#endif // CSV_SERIALIZER_HPP
@@ -11,8 +11,11 @@
 #include <iomanip>
 #include <initializer_list>
 #include <chrono>
+#include <numeric>
+#include <iterator>
 
 #include "Series.hpp"
+#include "MorselExecutor.hpp"
 
 using namespace std;
 
@@ -125,6 +128,26 @@ private:
     size_t rowCount = 0; /**< The number of rows in the DataFrame. */
     long long timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count(); /**< The timestamp of the DataFrame creation. */
 
+    /**
+     * @brief Keep some rows of the DataFrame, in a given order.
+     * 
+     * The columns are gathered one job per column.
+     * 
+     * @param indices The indexes of the rows to keep, in their new order.
+     * @param morsels Runs the gathering of the columns.
+     */
+    void takeRows(const vector<size_t>& indices, const MorselExecutor& morsels) {
+        vector<shared_ptr<ISeries>> taken(columnNames.size());
+        morsels.forEachIndex(columnNames.size(), [&](size_t index) {
+            taken[index] = columns.at(columnNames[index])->take(indices);
+        });
+
+        for (size_t index = 0; index < columnNames.size(); index++) {
+            columns[columnNames[index]] = taken[index];
+        }
+        rowCount = indices.size();
+    }
+
 public:
     
     /**
@@ -237,6 +260,37 @@ public:
         rowCount++;
     }
 
+    /**
+     * @brief Append the rows of another DataFrame.
+     * 
+     * This method appends all the rows of another DataFrame with the same columns, one column at a time.
+     * When this DataFrame is empty, the columns of the other DataFrame are copied with their types.
+     * 
+     * @param other The DataFrame whose rows are to be appended.
+     * @throws runtime_error If the columns or their types do not match.
+     */
+    void appendRows(const DataFrame& other) {
+        if (other.columnNames != columnNames) {
+            throw runtime_error("Column names do not match.");
+        }
+        if (other.rowCount == 0) return;
+
+        // Check all the types first, so a mismatch leaves the DataFrame unchanged
+        if (rowCount > 0) {
+            for (const auto& name : columnNames) {
+                if (columns.at(name)->type() != other.columns.at(name)->type()) {
+                    throw runtime_error("Column types do not match.");
+                }
+            }
+        }
+
+        for (const auto& name : columnNames) {
+            if (rowCount == 0) columns[name] = other.columns.at(name)->clone();
+            else columns[name]->append(other.columns.at(name).get());
+        }
+        rowCount += other.rowCount;
+    }
+
     /**
      * @brief Get the number of rows in the DataFrame.
      * 
@@ -412,6 +466,43 @@ public:
         }
     }
 
+    /**
+     * @brief Filter the DataFrame by a column, one morsel of rows per job.
+     * 
+     * Each morsel collects the indexes of its matching rows, then the columns are gathered at once,
+     * in the original order of the rows.
+     * 
+     * @param columnName The name of the column to filter by.
+     * @param filterValue The value to filter by.
+     * @param op The comparison operation to use for filtering.
+     * @param morsels Splits the rows into morsels and runs them.
+     * @throws runtime_error If the column does not exist or its type does not match the filter value.
+     */
+    void filterByColumn(const string& columnName, const any& filterValue, CompareOperation op, const MorselExecutor& morsels) {
+        auto colIt = columns.find(columnName);
+        if (colIt == columns.end()) {
+            throw runtime_error("Column not found: " + columnName);
+        }
+
+        shared_ptr<ISeries> column = colIt->second;
+        const auto& columnType = column->type();
+
+        vector<vector<size_t>> kept(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const any& columnValue = column->getDataAtIndex(i);
+                if (columnValue.type() != filterValue.type()) {
+                    throw runtime_error("Type mismatch error: Column value type does not match filter value type.");
+                }
+                if (compareValues(columnType, columnValue, filterValue, op)) kept[morsel].push_back(i);
+            }
+        });
+
+        vector<size_t> indices;
+        for (const auto& rows : kept) indices.insert(indices.end(), rows.begin(), rows.end());
+        if (indices.size() < rowCount) takeRows(indices, morsels);
+    }
+
     /**
      * @brief Merge two DataFrames.
      * 
@@ -488,7 +579,18 @@ public:
      * This method prints the entire DataFrame to the console.
      */
     void print() const {
-        print(0, rowCount - 1);
+        print(cout, 0, rowCount - 1);
+    }
+
+    /**
+     * @brief Print the DataFrame to a stream.
+     * 
+     * This method prints the entire DataFrame to the given stream.
+     * 
+     * @param out The stream to print to.
+     */
+    void print(ostream& out) const {
+        print(out, 0, rowCount - 1);
     }
 
     /**
@@ -500,48 +602,61 @@ public:
      * @param endIndex The index of the last row to be printed.
      */
     void print(size_t startIndex, size_t endIndex) const {
+        print(cout, startIndex, endIndex);
+    }
+
+    /**
+     * @brief Print a range of rows from the DataFrame to a stream.
+     * 
+     * This method prints a range of rows from the DataFrame to the given stream.
+     * 
+     * @param out The stream to print to.
+     * @param startIndex The index of the first row to be printed.
+     * @param endIndex The index of the last row to be printed.
+     */
+    void print(ostream& out, size_t startIndex, size_t endIndex) const {
         if (endIndex >= rowCount) endIndex = rowCount - 1; // Ensure endIndex is within bounds
 
         // Check if the dataframe is empty
         if (rowCount == 0 || endIndex < startIndex) {
-            cout << "DataFrame is empty." << endl;
+            out << "DataFrame is empty." << endl;
             return;
         }
 
-        cout << endl;
+        out << endl;
         for (size_t i = 0; i < columnNames.size(); ++i) {
-            cout << "----------------";
+            out << "----------------";
         }
-        cout << endl;
+        out << endl;
 
         // Print column headers
         for (const auto& columnName : columnNames) {
-            cout << columnName << "\t\t";
+            out << columnName << "\t\t";
         }
 
-        cout << endl;
+        out << endl;
         for (size_t i = 0; i < columnNames.size(); ++i) {
-            cout << "################";
+            out << "################";
         }
-        cout << endl;
+        out << endl;
 
         // Print data for each row in the specified range
         for (size_t rowIndex = startIndex; rowIndex <= endIndex; ++rowIndex) {
             for (const auto& columnName : columnNames) {
                 // Directly access and print the data for each column at rowIndex
-                cout << columns.at(columnName)->getStringAtIndex(rowIndex) << "\t\t";
+                out << columns.at(columnName)->getStringAtIndex(rowIndex) << "\t\t";
             }
-            cout << endl;
+            out << endl;
         }
         
         for (size_t i = 0; i < columnNames.size(); ++i) {
-            cout << "----------------";
+            out << "----------------";
         }
 
         // Print the timestamp
-        cout << endl << "Timestamp: " << timestamp << endl;
+        out << endl << "Timestamp: " << timestamp << endl;
 
-        cout << endl;
+        out << endl;
     }
 
     /**
@@ -559,6 +674,16 @@ public:
         return it->second;
     }
 
+    /**
+     * @brief Check whether the DataFrame has a column.
+     *
+     * @param name The name of the column.
+     * @return True if the column exists, false otherwise.
+     */
+    bool hasColumn(const string& name) const {
+        return columns.find(name) != columns.end();
+    }
+
     /**
      * @brief Clone the value of a column in a row.
      * 
@@ -744,6 +869,27 @@ public:
         }
     }
 
+    /**
+     * Replaces the data of a column with a whole vector of values.
+     * 
+     * The column type becomes T and the row count becomes the size of the vector,
+     * so all the columns must be set with vectors of the same size.
+     * 
+     * @tparam T The type of the column values.
+     * @param index The index of the column.
+     * @param values The values of the column, moved into the column.
+     * @throws runtime_error if the index is out of bounds.
+     */
+    template<typename T>
+    void setColumnData(size_t index, vector<T>&& values) {
+        if (index >= columnNames.size()) {
+            throw runtime_error("Index out of bounds.");
+        }
+
+        rowCount = values.size();
+        columns[columnNames[index]] = make_shared<Series<T>>(columnNames[index], std::move(values));
+    }
+
     /**
      * @brief Get the index of a column based on the column name.
      * 
@@ -828,6 +974,30 @@ public:
         return sum(getColumnIndex(columnName));
     }
 
+    /**
+     * @brief Calculate the sum of a column, one morsel of rows per job.
+     * 
+     * The partial sums of the morsels are added at the end, in the type of the column.
+     * 
+     * @param columnName The name of the column to calculate the sum for.
+     * @param morsels Splits the rows into morsels and runs them.
+     * @return The sum of the column.
+     * @throws runtime_error If the column does not exist or is not numeric.
+     */
+    any sum(const string& columnName, const MorselExecutor& morsels) {
+        shared_ptr<ISeries> column = getColumnPtr(columnName);
+
+        vector<any> partials(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            partials[morsel] = column->sum(begin, end);
+        });
+
+        // Add the partial sums in a series of the same type
+        shared_ptr<ISeries> partialSeries = column->take({});
+        for (const auto& partial : partials) partialSeries->add(partial);
+        return partialSeries->sum();
+    }
+
     /**
      * @brief Calculate the mean of a column in the DataFrame.
      * 
@@ -858,6 +1028,77 @@ public:
         return mean(getColumnIndex(columnName));
     }
 
+    /**
+     * @brief Calculate the mean of a column, one morsel of rows per job.
+     * 
+     * The means of the morsels are weighted by their number of rows at the end.
+     * 
+     * @param columnName The name of the column to calculate the mean for.
+     * @param morsels Splits the rows into morsels and runs them.
+     * @return The mean of the column.
+     * @throws runtime_error If the column does not exist or is not numeric.
+     */
+    double mean(const string& columnName, const MorselExecutor& morsels) {
+        shared_ptr<ISeries> column = getColumnPtr(columnName);
+        if (rowCount == 0) return column->mean();
+
+        vector<double> partials(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            partials[morsel] = column->mean(begin, end) * (end - begin);
+        });
+        return accumulate(partials.begin(), partials.end(), 0.0) / rowCount;
+    }
+
+    /**
+     * @brief Summarize every numeric column in one pass over its values.
+     * 
+     * @return A DataFrame with a row per numeric column, in the order of the columns, and its Count, Sum,
+     *         Mean, Min, Max and sample Variance.
+     */
+    DataFrame describe() {
+        return describe(MorselExecutor());
+    }
+
+    /**
+     * @brief Summarize every numeric column in one pass over its values, one morsel of rows per job.
+     * 
+     * The jobs cover every morsel of every numeric column at once, and the statistics of the morsels of a
+     * column are merged at the end.
+     * 
+     * @param morsels Splits the rows into morsels and runs them.
+     * @return A DataFrame with a row per numeric column, in the order of the columns, and its Count, Sum,
+     *         Mean, Min, Max and sample Variance.
+     */
+    DataFrame describe(const MorselExecutor& morsels) {
+        vector<shared_ptr<ISeries>> numeric;
+        vector<string> names;
+        for (const auto& name : columnNames) {
+            const auto& series = columns.at(name);
+            if (rowCount > 0 && series->isNumeric()) {
+                numeric.push_back(series);
+                names.push_back(name);
+            }
+        }
+
+        size_t morselCount = morsels.getMorselCount(rowCount);
+        size_t morselRows = morsels.getMorselRows();
+        vector<SeriesStats> partials(numeric.size() * morselCount);
+        morsels.forEachIndex(partials.size(), [&](size_t index) {
+            size_t begin = (index % morselCount) * morselRows;
+            partials[index] = numeric[index / morselCount]->describe(begin, min(begin + morselRows, rowCount));
+        });
+
+        DataFrame result({"Column", "Count", "Sum", "Mean", "Min", "Max", "Variance"});
+        for (size_t column = 0; column < numeric.size(); column++) {
+            SeriesStats stats;
+            for (size_t morsel = 0; morsel < morselCount; morsel++) stats.merge(partials[column * morselCount + morsel]);
+            result.addRow(names[column], static_cast<int>(stats.count), stats.getSum(), stats.getMean(),
+                          stats.getMin(), stats.getMax(), stats.getVariance());
+        }
+        result.setTimestamp(timestamp);
+        return result;
+    }
+
     /**
      * @brief Count the occurrences of each value in a column.
      * 
@@ -910,6 +1151,102 @@ public:
     DataFrame valueCounts(const string& columnName) {
         return valueCounts(getColumnIndex(columnName));
     }
+
+    /**
+     * @brief Count the occurrences of each value in a column, one morsel of rows per job.
+     * 
+     * Each morsel counts its own rows, and the counts of the morsels are added at the end.
+     * 
+     * @param columnName The name of the column to count the occurrences for.
+     * @param morsels Splits the rows into morsels and runs them.
+     * @return A DataFrame containing the value counts.
+     * @throws runtime_error If the column does not exist.
+     */
+    DataFrame valueCounts(const string& columnName, const MorselExecutor& morsels) {
+        shared_ptr<ISeries> column = getColumnPtr(columnName);
+
+        vector<map<string, int>> partials(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) partials[morsel][column->getStringAtIndex(i)]++;
+        });
+
+        map<string, int> valueCountMap;
+        for (const auto& partial : partials) {
+            for (const auto& [value, count] : partial) valueCountMap[value] += count;
+        }
+
+        DataFrame countDataFrame({"Value", "Count"});
+        for (const auto& [value, count] : valueCountMap) {
+            countDataFrame.addRow(value, count);
+        }
+
+        return countDataFrame;
+    }
+
+    /**
+     * @brief Sum a column for each value of another column.
+     * 
+     * @param keyColumnName The name of the column to group by, whose values are turned into strings.
+     * @param sumColumnName The name of the numeric column to sum.
+     * @return A DataFrame with the values of the key column, in order, and the sum of each group,
+     *         in the type of the summed column.
+     * @throws runtime_error If a column does not exist, both are the same, or the sum column is not numeric.
+     */
+    DataFrame groupBySum(const string& keyColumnName, const string& sumColumnName) {
+        return groupBySum(keyColumnName, sumColumnName, MorselExecutor());
+    }
+
+    /**
+     * @brief Sum a column for each value of another column, one morsel of rows per job.
+     * 
+     * Each morsel sums its own groups, and the partial sums of each group are added at the end.
+     * 
+     * @param keyColumnName The name of the column to group by, whose values are turned into strings.
+     * @param sumColumnName The name of the numeric column to sum.
+     * @param morsels Splits the rows into morsels and runs them.
+     * @return A DataFrame with the values of the key column, in order, and the sum of each group,
+     *         in the type of the summed column.
+     * @throws runtime_error If a column does not exist, both are the same, or the sum column is not numeric.
+     */
+    DataFrame groupBySum(const string& keyColumnName, const string& sumColumnName, const MorselExecutor& morsels) {
+        if (keyColumnName == sumColumnName) {
+            throw runtime_error("Cannot group a column by itself.");
+        }
+        shared_ptr<ISeries> keyColumn = getColumnPtr(keyColumnName);
+        shared_ptr<ISeries> sumColumn = getColumnPtr(sumColumnName);
+
+        vector<map<string, any>> partials(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            map<string, vector<size_t>> groups;
+            for (size_t i = begin; i < end; i++) groups[keyColumn->getStringAtIndex(i)].push_back(i);
+            for (const auto& [key, indices] : groups) partials[morsel][key] = sumColumn->take(indices)->sum();
+        });
+
+        // Gather the partial sums of each group in a series of the type of the summed column
+        map<string, shared_ptr<ISeries>> groupPartials;
+        for (const auto& partial : partials) {
+            for (const auto& [key, value] : partial) {
+                auto& series = groupPartials[key];
+                if (!series) series = sumColumn->take({});
+                series->add(value);
+            }
+        }
+
+        vector<string> keys;
+        shared_ptr<ISeries> sums = sumColumn->take({});
+        for (const auto& [key, series] : groupPartials) {
+            keys.push_back(key);
+            sums->add(series->sum());
+        }
+
+        DataFrame result;
+        result.columnNames = {keyColumnName, sumColumnName};
+        result.columns[keyColumnName] = make_shared<Series<string>>(keyColumnName, std::move(keys));
+        result.columns[sumColumnName] = sums;
+        result.rowCount = groupPartials.size();
+        result.timestamp = timestamp;
+        return result;
+    }
     /**
      * @brief Sort the DataFrame by a column.
      *
@@ -973,6 +1310,55 @@ public:
         sortByColumn(getColumnIndex(columnName), ascending);
     }
 
+    /**
+     * @brief Sort the DataFrame by a column, one morsel of rows per job.
+     *
+     * Each morsel sorts its own rows, then the sorted runs are merged two by two, each merge being a
+     * job, and the columns are gathered at once in the final order.
+     * 
+     * @param columnName The name of the column to sort by.
+     * @param ascending The order of sorting (ascending or descending).
+     * @param morsels Splits the rows into morsels and runs them.
+     * @throws runtime_error If the column does not exist.
+     */
+    void sortByColumn(const string& columnName, bool ascending, const MorselExecutor& morsels) {
+        shared_ptr<ISeries> column = getColumnPtr(columnName);
+        const auto& columnType = column->type();
+
+        auto before = [&](const pair<size_t, any>& a, const pair<size_t, any>& b) {
+            return compareValues(columnType, a.second, b.second, ascending ? CompareOperation::LESS_THAN : CompareOperation::GREATER_THAN);
+        };
+
+        vector<vector<pair<size_t, any>>> runs(morsels.getMorselCount(rowCount));
+        morsels.forEachMorsel(rowCount, [&](size_t morsel, size_t begin, size_t end) {
+            auto& run = runs[morsel];
+            run.reserve(end - begin);
+            for (size_t i = begin; i < end; ++i) run.push_back({i, column->getDataAtIndex(i)});
+            sort(run.begin(), run.end(), before);
+        });
+
+        while (runs.size() > 1) {
+            vector<vector<pair<size_t, any>>> merged((runs.size() + 1) / 2);
+            morsels.forEachIndex(merged.size(), [&](size_t index) {
+                auto& left = runs[2 * index];
+                if (2 * index + 1 == runs.size()) {
+                    merged[index] = std::move(left);
+                    return;
+                }
+                auto& right = runs[2 * index + 1];
+                merged[index].reserve(left.size() + right.size());
+                merge(left.begin(), left.end(), right.begin(), right.end(), back_inserter(merged[index]), before);
+            });
+            runs = std::move(merged);
+        }
+
+        if (runs.empty()) return;
+        vector<size_t> indices;
+        indices.reserve(rowCount);
+        for (const auto& [index, value] : runs[0]) indices.push_back(index);
+        takeRows(indices, morsels);
+    }
+
     /**
      * @brief Left join this DataFrame with another DataFrame on a given key column.
      * 
@@ -0,0 +1,232 @@
+#ifndef DATAFRAME_BUILDER_HPP
+#define DATAFRAME_BUILDER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <variant>
+#include <charconv>
+#include <stdexcept>
+
+#include "DataFrame.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for building a DataFrame from delimited lines.
+ *
+ * The DataFrameBuilder splits each line as a string_view and parses the fields straight into
+ * typed column vectors, which are moved into the DataFrame when it is built. The type of each
+ * column is inferred from the first row. Unlike the CSV and TXT strategies of the DataRepo, which
+ * keep their schema, a number may have a sign and an exponent.
+ *
+ * A builder is meant to be reused: it keeps the parsed header between calls while it does not
+ * change, and reserves the columns for as many rows as the previous build.
+ */
+class DataFrameBuilder {
+private:
+    /**
+     * @brief The values of a column, untyped until the first row is added.
+     */
+    using ColumnData = variant<monostate, vector<int>, vector<long long>, vector<float>, vector<char>, vector<string>>;
+
+    string header; /**< The last header line. */
+    char delimiter = ','; /**< The delimiter of the last header line. */
+    vector<string> columnNames; /**< The column names parsed from the header. */
+    vector<ColumnData> columns; /**< The values of each column. */
+    size_t rowCount = 0; /**< The number of rows added since the last start. */
+    size_t expectedRows = 0; /**< The number of rows of the previous build. */
+
+    /**
+     * @brief Remove the sign at the start of a value.
+     */
+    static string_view skipSign(string_view value) {
+        if (!value.empty() && (value[0] == '-' || value[0] == '+')) value.remove_prefix(1);
+        return value;
+    }
+
+    static bool isDigits(string_view value) {
+        if (value.empty()) return false;
+        for (char c : value) {
+            if (c < '0' || c > '9') return false;
+        }
+        return true;
+    }
+
+    static bool isNumeric(string_view value) {
+        return isDigits(skipSign(value));
+    }
+
+    static bool isFloat(string_view value) {
+        value = skipSign(value);
+
+        // A mantissa with a dot, an exponent, or both
+        size_t exponent = value.find_first_of("eE");
+        string_view mantissa = value.substr(0, exponent);
+        int dots = 0;
+        int digits = 0;
+        for (char c : mantissa) {
+            if (c == '.') dots++;
+            else if (c >= '0' && c <= '9') digits++;
+            else return false;
+        }
+        if (digits == 0 || dots > 1) return false;
+        if (exponent == string_view::npos) return dots == 1;
+        return isDigits(skipSign(value.substr(exponent + 1)));
+    }
+
+    /**
+     * @brief Create a column of the type inferred from its first value.
+     */
+    ColumnData inferColumn(string_view value) const {
+        ColumnData column;
+        if (isNumeric(value)) {
+            // Int when it fits, long long otherwise
+            int parsed;
+            string_view digits = value[0] == '+' ? value.substr(1) : value;
+            if (from_chars(digits.data(), digits.data() + digits.size(), parsed).ec == errc()) column = vector<int>();
+            else column = vector<long long>();
+        } else if (isFloat(value)) {
+            column = vector<float>();
+        } else if (value.size() == 1) {
+            column = vector<char>();
+        } else {
+            column = vector<string>();
+        }
+
+        visit([this](auto& values) {
+            if constexpr (!is_same_v<decay_t<decltype(values)>, monostate>) values.reserve(expectedRows);
+        }, column);
+        return column;
+    }
+
+    /**
+     * @brief Parse a number with from_chars, which takes a minus sign but not a plus sign.
+     *
+     * @throws runtime_error If the value is not a number of type T.
+     */
+    template<typename T>
+    static T parseNumber(string_view value) {
+        T parsed{};
+        if (value.size() > 1 && value[0] == '+' && value[1] != '-') value.remove_prefix(1);
+        auto result = from_chars(value.data(), value.data() + value.size(), parsed);
+        if (result.ec != errc() || result.ptr != value.data() + value.size()) {
+            throw runtime_error("Failed to parse value: " + string(value));
+        }
+        return parsed;
+    }
+
+    /**
+     * @brief Parse a field and add it to its column.
+     */
+    void addValue(size_t index, string_view value) {
+        ColumnData& column = columns[index];
+        if (holds_alternative<monostate>(column)) column = inferColumn(value);
+
+        // An empty field takes the default value of its column
+        if (value.empty()) {
+            visit([](auto& values) {
+                if constexpr (!is_same_v<decay_t<decltype(values)>, monostate>) values.emplace_back();
+            }, column);
+            return;
+        }
+
+        if (auto* ints = get_if<vector<int>>(&column)) ints->push_back(parseNumber<int>(value));
+        else if (auto* longs = get_if<vector<long long>>(&column)) longs->push_back(parseNumber<long long>(value));
+        else if (auto* floats = get_if<vector<float>>(&column)) floats->push_back(parseNumber<float>(value));
+        else if (auto* chars = get_if<vector<char>>(&column)) chars->push_back(value[0]);
+        else get<vector<string>>(column).emplace_back(value);
+    }
+
+public:
+    /**
+     * @brief Remove the line break at the end of a line.
+     *
+     * @param line The line.
+     * @return The line without the trailing "\n" or "\r\n".
+     */
+    static string_view trimLine(string_view line) {
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.remove_suffix(1);
+        return line;
+    }
+
+    /**
+     * @brief Start a new DataFrame with the columns of a header line.
+     *
+     * @param headerLine The header line, with the column names separated by the delimiter.
+     * @param headerDelimiter The delimiter of the header and of the lines.
+     */
+    void start(string_view headerLine, char headerDelimiter) {
+        headerLine = trimLine(headerLine);
+
+        // Parse the header only when it changes
+        if (headerLine != header || headerDelimiter != delimiter || columnNames.empty()) {
+            header = headerLine;
+            delimiter = headerDelimiter;
+            columnNames.clear();
+
+            size_t begin = 0;
+            while (true) {
+                size_t end = headerLine.find(delimiter, begin);
+                columnNames.emplace_back(headerLine.substr(begin, end - begin));
+                if (end == string_view::npos) break;
+                begin = end + 1;
+            }
+        }
+
+        columns.assign(columnNames.size(), monostate());
+        rowCount = 0;
+    }
+
+    /**
+     * @brief Parse a line and add it as a row.
+     *
+     * Empty fields, and missing fields at the end of the line, are added as the default value of
+     * their column: zero for numbers, '\0' for chars and an empty string for strings.
+     *
+     * @param line The line, with the values separated by the delimiter.
+     * @throws runtime_error If a value does not match the type of its column.
+     */
+    void addLine(string_view line) {
+        line = trimLine(line);
+
+        size_t begin = 0;
+        for (size_t i = 0; i < columns.size(); i++) {
+            string_view value;
+            if (begin <= line.size()) {
+                size_t end = line.find(delimiter, begin);
+                if (end == string_view::npos) end = line.size();
+                value = line.substr(begin, end - begin);
+                begin = end + 1;
+            }
+            addValue(i, value);
+        }
+
+        rowCount++;
+    }
+
+    /**
+     * @brief Move the parsed rows into a new DataFrame.
+     *
+     * The builder must be started again before adding more lines.
+     *
+     * @return A pointer to the new DataFrame.
+     */
+    DataFrame* build() {
+        DataFrame* df = new DataFrame(columnNames);
+        if (rowCount > 0) {
+            for (size_t i = 0; i < columns.size(); i++) {
+                visit([df, i](auto& values) {
+                    if constexpr (!is_same_v<decay_t<decltype(values)>, monostate>) df->setColumnData(i, std::move(values));
+                }, columns[i]);
+            }
+        }
+
+        expectedRows = rowCount;
+        columns.clear();
+        rowCount = 0;
+        return df;
+    }
+};
+
+#endif // DATAFRAME_BUILDER_HPP
@@ -4,33 +4,194 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <chrono>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <utility>
+#include <memory>
 #include "DataFrame.hpp"
 #include "Queue.hpp"
+#include "Coroutine.hpp"
+#include "MorselExecutor.hpp"
 
 /**
  * @brief Class for handling data in a separate thread.
  *  
  * This class is a base class for handling data in a separate thread.
  * It reads data from an input queue, processes it and writes the result to an output queue.
+ * A handler runs as a long-lived actor: it waits for data on its input queue until the queue is closed
+ * and drained, then closes its output queues, so the end of the stream flows down the pipeline.
+ * A handler allowed to have replicas can be run on more threads while its input backs up: the extra
+ * runs leave once the input stays empty or an output queue is full.
+ * Each handler also runs as a coroutine, with the Async version of its method: the coroutine is suspended
+ * instead of its thread while it waits on a queue, so many handlers can share a few threads.
+ * The handlers that filter, count or sort split a large DataFrame into morsels of rows, which run on the
+ * executor of their MorselExecutor, so a single large batch is not left to a single thread.
+ * A run that throws stops the stream of the handler: its input queue is closed, so the stages upstream
+ * fail on their next push instead of waiting on it, and its output queues are closed, so the stages
+ * downstream drain and end. The exception reaches the Future of the main run.
  */
 class DataHandler {
 protected:
+    using Transform = std::function<DataFrame*(DataFrame*)>; /**< Turns an input DataFrame into the one to push. */
+
     Queue<DataFrame*> *inputQueue;
     std::vector<Queue<DataFrame*>*> outputQueues;
+    std::atomic<bool> running{false}; /**< Set while a thread runs the handler. */
+    std::atomic<bool> finished{false}; /**< Set once the input stream ended and the outputs are closed. */
+    int maxReplicas = 0; /**< The number of extra threads that may run the handler. */
+    std::atomic<int> replicas{0}; /**< The extra threads running the handler. */
+    std::atomic<int> runners{0}; /**< All the threads running the handler. */
+    std::atomic<bool> failed{false}; /**< Set once a run threw. */
+    std::exception_ptr failure; /**< The exception of the first run that threw. */
+    std::mutex failureMutex; /**< The mutex for the failure. */
+    MorselExecutor morsels; /**< Runs the morsels of a large DataFrame, inline by default. */
+
+    static constexpr std::chrono::milliseconds REPLICA_IDLE{50}; /**< How long a replica waits for input. */
+
+    /**
+     * @brief Scope in which the main thread runs the handler.
+     *
+     * The thread pool may start a handler on several threads at once. Only the first one runs it as the
+     * main thread; the others run it as replicas if the handler allows them, and return otherwise.
+     */
+    class RunScope {
+    public:
+        RunScope(std::atomic<bool>& running)
+            : running(running), claimed(!running.exchange(true, std::memory_order_acquire)) {}
+
+        ~RunScope() {
+            if (claimed) running.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief Whether this thread runs the handler.
+         */
+        bool isClaimed() const {
+            return claimed;
+        }
+
+    private:
+        std::atomic<bool>& running;
+        bool claimed;
+    };
+
+    /**
+     * @brief Scope in which a thread counts as a runner of the handler.
+     *
+     * Leaving the scope always calls endRun, also when the run throws, so the last runner closes the
+     * output queues.
+     */
+    class RunnerScope {
+    public:
+        RunnerScope(DataHandler& handler, bool replica) : handler(handler), replica(replica) {
+            handler.runners.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        ~RunnerScope() {
+            if (replica) handler.replicas.fetch_sub(1, std::memory_order_relaxed);
+            handler.endRun();
+        }
+
+    private:
+        DataHandler& handler;
+        bool replica;
+    };
 
 public:
     /**
      * @brief Construct a new DataHandler object.
      * 
+     * The handler registers as the consumer of its input queue and a producer of its output queues,
+     * so the queues can pick their mode when the wiring seals them.
+     * 
      * @param inputQueue Reference to the input queue.
      * @param outputQueues Reference to the output queues.
      */
     // Constructor
     DataHandler(Queue<DataFrame*> *inputQueue, std::vector<Queue<DataFrame*>*> outputQueues)
-        : inputQueue(inputQueue), outputQueues(outputQueues) {}
+        : inputQueue(inputQueue), outputQueues(outputQueues) {
+        inputQueue->addConsumer();
+        for (auto& outputQueue : outputQueues) outputQueue->addProducer();
+    }
+
+    /**
+     * @brief Allow extra threads to run the handler while its input backs up.
+     *
+     * Must be called before the queues are sealed: the queues of a handler with replicas keep the mode
+     * for several producers and consumers.
+     *
+     * @param count The maximum number of replicas.
+     */
+    void setMaxReplicas(int count) {
+        if (maxReplicas == 0 && count > 0) {
+            inputQueue->addConsumer();
+            for (auto& outputQueue : outputQueues) outputQueue->addProducer();
+        }
+        maxReplicas = count;
+    }
+
+    /**
+     * @brief Set the executor of the morsels of a large DataFrame. Must be called before the handler runs.
+     *
+     * @param morsels Splits a DataFrame into morsels of rows and runs them, such as on a ThreadPool.
+     */
+    void setMorselExecutor(const MorselExecutor& morsels) {
+        this->morsels = morsels;
+    }
+
+    /**
+     * @brief Get the maximum number of replicas.
+     *
+     * @return The number of extra threads that may run the handler.
+     */
+    int getMaxReplicas() const {
+        return maxReplicas;
+    }
+
+    /**
+     * @brief Get the number of replicas running.
+     *
+     * @return The number of extra threads running the handler.
+     */
+    int getReplicas() const {
+        return replicas.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Get how full the input queue is.
+     *
+     * @return The size of the input queue over its capacity, from 0 to 1.
+     */
+    double getInputFill() const {
+        return static_cast<double>(inputQueue->size()) / inputQueue->capacity();
+    }
+
+    /**
+     * @brief Get the room left downstream, in the fullest output queue.
+     *
+     * @return The free part of the fullest output queue, from 0 to 1.
+     */
+    double getOutputSlack() const {
+        double slack = 1.0;
+        for (auto& outputQueue : outputQueues) {
+            slack = std::min(slack, 1.0 - static_cast<double>(outputQueue->size()) / outputQueue->capacity());
+        }
+        return slack;
+    }
+
+    /**
+     * @brief Check if the stream of the handler ended.
+     *
+     * @return true If the input is drained and the outputs are closed.
+     */
+    bool isFinished() const {
+        return finished.load(std::memory_order_acquire);
+    }
 
     /**
      * @brief Push a DataFrame to the output queues.
@@ -47,6 +208,209 @@ public:
         }
         delete df;
     }
+
+    /**
+     * @brief Push a batch of DataFrames to the output queues.
+     *
+     * Creates a deep copy of each DataFrame for each output queue and pushes the copies as one batch.
+     * 
+     * @param dfs The DataFrames to push.
+     */
+    void pushToOutputQueues(const std::vector<DataFrame*>& dfs) {
+        std::vector<DataFrame*> copies;
+        for (auto& outputQueue : outputQueues) {
+            copyFrames(dfs, copies);
+            outputQueue->pushBatch(copies);
+        }
+        for (DataFrame* df : dfs) delete df;
+    }
+
+protected:
+    /**
+     * @brief Replace the copies with a deep copy of each DataFrame.
+     */
+    static void copyFrames(const std::vector<DataFrame*>& dfs, std::vector<DataFrame*>& copies) {
+        copies.clear();
+        for (DataFrame* df : dfs) {
+            DataFrame* dfCopy = new DataFrame;
+            *dfCopy = DataFrame::deepCopy(*df);
+            copies.push_back(dfCopy);
+        }
+    }
+
+    /**
+     * @brief Push a batch of DataFrames to the output queues from a coroutine.
+     *
+     * The coroutine is suspended while an output queue is full. The DataFrames must live until it returns.
+     *
+     * @param dfs The DataFrames to push.
+     */
+    Coroutine<void> pushToOutputQueuesAsync(const std::vector<DataFrame*>& dfs) {
+        std::vector<DataFrame*> copies;
+        for (auto& outputQueue : outputQueues) {
+            copyFrames(dfs, copies);
+            co_await outputQueue->pushBatchAsync(copies);
+        }
+        for (DataFrame* df : dfs) delete df;
+    }
+
+    /**
+     * @brief Leave the handler. The last runner to leave once the input is drained, or once a run failed,
+     * ends the stream of the output queues.
+     */
+    void endRun() {
+        if (runners.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        // Checked once this is the last runner: a runner that saw the input open may leave last, after the
+        // main runner drained the closed input
+        bool drained = inputQueue->isClosed() && inputQueue->isEmpty();
+        bool stopped = failed.load(std::memory_order_acquire);
+        if ((drained || stopped) && !finished.exchange(true)) {
+            // The DataFrames left in the input of a failed handler are never processed
+            std::vector<DataFrame*> left;
+            if (stopped) inputQueue->drainTo(left);
+            for (DataFrame* df : left) delete df;
+
+            int registrations = maxReplicas > 0 ? 2 : 1;
+            for (auto& outputQueue : outputQueues) {
+                for (int i = 0; i < registrations; i++) outputQueue->closeProducer();
+            }
+        }
+    }
+
+    /**
+     * @brief Stop the stream of the handler after a run threw.
+     *
+     * The DataFrames held by the run are deleted, and the input queue is closed, so no more DataFrames
+     * wait for the handler. The first exception is kept for the main run.
+     *
+     * @param batch The input DataFrames not yet given to the transform.
+     * @param results The DataFrames transformed but not yet pushed.
+     * @param error The exception of the run.
+     */
+    void fail(std::vector<DataFrame*>& batch, std::vector<DataFrame*>& results, std::exception_ptr error) {
+        for (DataFrame* df : batch) delete df;
+        for (DataFrame* df : results) delete df;
+        batch.clear();
+        results.clear();
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure) failure = error;
+        }
+        failed.store(true, std::memory_order_release);
+        inputQueue->close();
+    }
+
+    /**
+     * @brief Throw the exception of a failed run, so a replica that failed fails the main run too.
+     */
+    void rethrowFailure() {
+        if (!failed.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(failureMutex);
+        std::rethrow_exception(failure);
+    }
+
+    /**
+     * @brief Process the input queue batch by batch until its stream ends.
+     *
+     * The thread sleeps while the input queue is empty. Each batch holds all the DataFrames waiting at
+     * once, so the queues are synchronized once per batch instead of once per DataFrame. Once the input
+     * queue is closed and drained, the last thread running the handler closes its output queues.
+     *
+     * A replica returns as soon as the input stays empty for a while or an output queue is full, so it
+     * gives its thread back instead of adding to the backlog downstream.
+     *
+     * If the transform or a push throws, the handler fails: see fail. The exception is thrown again, and
+     * the main run also throws the exception of a replica that failed.
+     * 
+     * @param process The function that turns an input DataFrame, which it owns also when it throws, into the
+     * DataFrame to push.
+     */
+    template <typename Process>
+    void processInput(Process process) {
+        RunScope scope(running);
+        bool replica = !scope.isClaimed();
+        if (replica && replicas.fetch_add(1, std::memory_order_acq_rel) >= maxReplicas) {
+            replicas.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+
+        RunnerScope runner(*this, replica);
+        if (!finished.load(std::memory_order_acquire)) {
+            std::vector<DataFrame*> batch;
+            std::vector<DataFrame*> results;
+            try {
+                while (true) {
+                    if (!replica) {
+                        if (!inputQueue->popBatch(batch, inputQueue->capacity())) break;
+                    } else {
+                        if (getOutputSlack() <= 0.0) break;
+                        batch = inputQueue->popBatch(inputQueue->capacity(), REPLICA_IDLE);
+                        if (batch.empty()) break;
+                    }
+
+                    // The transform owns each DataFrame it is given, so it is no longer held by the batch
+                    for (DataFrame*& df : batch) results.push_back(process(std::exchange(df, nullptr)));
+
+                    // Write the DataFrames to the output queues
+                    pushToOutputQueues(results);
+                    batch.clear();
+                    results.clear();
+                }
+            } catch (...) {
+                fail(batch, results, std::current_exception());
+                throw;
+            }
+        }
+        if (!replica) rethrowFailure();
+    }
+
+    /**
+     * @brief Process the input queue batch by batch until its stream ends, as a coroutine.
+     *
+     * Works as processInput, but the coroutine is suspended instead of its thread while the input queue
+     * is empty or an output queue is full. A replica leaves as soon as the input is empty, as a new one
+     * costs no thread to start.
+     *
+     * @param process The function that turns an input DataFrame, which it owns, into the DataFrame to push.
+     */
+    template <typename Process>
+    Coroutine<void> processInputAsync(Process process) {
+        RunScope scope(running);
+        bool replica = !scope.isClaimed();
+        if (replica && replicas.fetch_add(1, std::memory_order_acq_rel) >= maxReplicas) {
+            replicas.fetch_sub(1, std::memory_order_relaxed);
+            co_return;
+        }
+
+        RunnerScope runner(*this, replica);
+        if (!finished.load(std::memory_order_acquire)) {
+            std::vector<DataFrame*> batch;
+            std::vector<DataFrame*> results;
+            try {
+                while (true) {
+                    if (!replica) {
+                        if (!co_await inputQueue->popBatchAsync(batch, inputQueue->capacity())) break;
+                    } else {
+                        if (getOutputSlack() <= 0.0) break;
+                        if (inputQueue->tryPopBatch(batch, inputQueue->capacity()) == 0) break;
+                    }
+
+                    // The transform owns each DataFrame it is given, so it is no longer held by the batch
+                    for (DataFrame*& df : batch) results.push_back(process(std::exchange(df, nullptr)));
+
+                    // Write the DataFrames to the output queues
+                    co_await pushToOutputQueuesAsync(results);
+                    batch.clear();
+                    results.clear();
+                }
+            } catch (...) {
+                fail(batch, results, std::current_exception());
+                throw;
+            }
+        }
+        if (!replica) rethrowFailure();
+    }
 };
 
 /**
@@ -61,12 +425,18 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void copy() {
-        while (!inputQueue->isEmpty()) {
-            DataFrame* df = inputQueue->pop();
+        processInput(pass());
+    }
 
-            // Write the DataFrame to the output queues
-            pushToOutputQueues(df);
-        }
+    Coroutine<void> copyAsync() {
+        return processInputAsync(pass());
+    }
+
+private:
+    static Transform pass() {
+        return [](DataFrame* df) {
+            return df;
+        };
     }
 };
 
@@ -83,10 +453,16 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void countLines() {
-        while (!inputQueue->isEmpty()) {
+        processInput(count());
+    }
 
-            // Read the DataFrame from the input queue
-            DataFrame* df = inputQueue->pop();
+    Coroutine<void> countLinesAsync() {
+        return processInputAsync(count());
+    }
+
+private:
+    static Transform count() {
+        return [](DataFrame* df) {
             long long timestamp = df->getTimestamp();
 
             // Count the lines in the DataFrame
@@ -99,10 +475,8 @@ public:
             DataFrame* countDf = new DataFrame({"Count"});
             countDf->setTimestamp(timestamp);
             countDf->addRow(lines);
-
-            // Write the DataFrame to the output queues
-            pushToOutputQueues(countDf);
-        }
+            return countDf;
+        };
     }
 };
 
@@ -129,16 +503,23 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void filterByColumn(std::string columnName, const std::any& filterValue, CompareOperation op) {
-        while (!inputQueue->isEmpty()) {
-            // Read the DataFrame from the input queue
-            DataFrame* df = inputQueue->pop();
+        processInput(filter(columnName, filterValue, op, morsels));
+    }
 
-            // Filter the DataFrame
-            df->filterByColumn(columnName, filterValue, op);
+    Coroutine<void> filterByColumnAsync(std::string columnName, std::any filterValue, CompareOperation op) {
+        return processInputAsync(filter(columnName, filterValue, op, morsels));
+    }
 
-            // Write the DataFrame to the output queue
-            pushToOutputQueues(df);
-        }
+private:
+    static Transform filter(std::string columnName, std::any filterValue, CompareOperation op, MorselExecutor morsels) {
+        return [columnName, filterValue, op, morsels](DataFrame* df) {
+            // Deleted if the filter throws
+            std::unique_ptr<DataFrame> input(df);
+
+            // Filter the DataFrame
+            input->filterByColumn(columnName, filterValue, op, morsels);
+            return input.release();
+        };
     }
 };
 
@@ -161,22 +542,26 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void countByColumn(std::string columnName) {
-        while (!inputQueue->isEmpty()) {
-            // Read the DataFrame from the input queue
-            DataFrame* df = inputQueue->pop();
-            long long timestamp = df->getTimestamp();
+        processInput(valueCount(columnName, morsels));
+    }
 
-            // Count the values in the DataFrame
-            DataFrame* countDf = new DataFrame();
-            countDf->setTimestamp(timestamp);
-            *countDf = df->valueCounts(columnName);
+    Coroutine<void> countByColumnAsync(std::string columnName) {
+        return processInputAsync(valueCount(columnName, morsels));
+    }
 
-            // Delete the DataFrame
-            delete df;
+private:
+    static Transform valueCount(std::string columnName, MorselExecutor morsels) {
+        return [columnName, morsels](DataFrame* df) {
+            // Deleted once counted, or if the count throws
+            std::unique_ptr<DataFrame> input(df);
+            long long timestamp = input->getTimestamp();
 
-            // Write the DataFrame to the output queue
-            pushToOutputQueues(countDf);
-        }
+            // Count the values in the DataFrame
+            auto countDf = std::make_unique<DataFrame>();
+            countDf->setTimestamp(timestamp);
+            *countDf = input->valueCounts(columnName, morsels);
+            return countDf.release();
+        };
     }
 };
 
@@ -202,23 +587,26 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void join(DataFrame& dfRight, std::string keyColumnName, bool dropKeyColumn=false) {
-        while (!inputQueue->isEmpty()) {
-            // Read the DataFrame from the input queue
-            DataFrame* dfLeft = inputQueue->pop();
-            long long timestamp = dfLeft->getTimestamp();
-
-            // Join the DataFrames
-            DataFrame* dfJoined = new DataFrame();
-            dfJoined->setTimestamp(timestamp);
-            *dfJoined = dfLeft->leftJoin(dfRight, keyColumnName, dropKeyColumn);
+        processInput(leftJoin(dfRight, keyColumnName, dropKeyColumn));
+    }
 
-            // Delete the left DataFrame
-            delete dfLeft;
+    Coroutine<void> joinAsync(DataFrame& dfRight, std::string keyColumnName, bool dropKeyColumn=false) {
+        return processInputAsync(leftJoin(dfRight, keyColumnName, dropKeyColumn));
+    }
 
+private:
+    static Transform leftJoin(DataFrame& dfRight, std::string keyColumnName, bool dropKeyColumn) {
+        return [&dfRight, keyColumnName, dropKeyColumn](DataFrame* dfLeft) {
+            // Deleted once joined, or if the join throws
+            std::unique_ptr<DataFrame> input(dfLeft);
+            long long timestamp = input->getTimestamp();
 
-            // Write the DataFrame to the output queue
-            pushToOutputQueues(dfJoined);
-        }
+            // Join the DataFrames
+            auto dfJoined = std::make_unique<DataFrame>();
+            dfJoined->setTimestamp(timestamp);
+            *dfJoined = input->leftJoin(dfRight, keyColumnName, dropKeyColumn);
+            return dfJoined.release();
+        };
     }
 };
 
@@ -243,17 +631,23 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void sortByColumn(std::string columnName, bool ascending=true) {
-        while (!inputQueue->isEmpty()) {
+        processInput(sort(columnName, ascending, morsels));
+    }
 
-            // Read the DataFrame from the input queue
-            DataFrame* df = inputQueue->pop();
+    Coroutine<void> sortByColumnAsync(std::string columnName, bool ascending=true) {
+        return processInputAsync(sort(columnName, ascending, morsels));
+    }
 
-            // Sort the DataFrame
-            df->sortByColumn(columnName, ascending);
+private:
+    static Transform sort(std::string columnName, bool ascending, MorselExecutor morsels) {
+        return [columnName, ascending, morsels](DataFrame* df) {
+            // Deleted if the sort throws
+            std::unique_ptr<DataFrame> input(df);
 
-            // Write the DataFrame to the output queue
-            pushToOutputQueues(df);
-        }
+            // Sort the DataFrame
+            input->sortByColumn(columnName, ascending, morsels);
+            return input.release();
+        };
     }
 };    
 
@@ -279,20 +673,24 @@ public:
         : DataHandler(inputQueue, outputQueues) {};
 
     void mergeAndSum(DataFrame& df1, DataFrame& df2, std::string columnName, std::string sumColumn) {
-        while (!inputQueue->isEmpty()) {
-            // Read the DataFrame from the input queue
-            DataFrame* df = inputQueue->pop();
+        processInput(merge(df1, df2, columnName, sumColumn));
+    }
 
-            // Merge and sum the DataFrames
-            DataFrame* dfMerged = new DataFrame();
-            *dfMerged = DataFrame::mergeAndSum(df1, df2, columnName, sumColumn);
+    Coroutine<void> mergeAndSumAsync(DataFrame& df1, DataFrame& df2, std::string columnName, std::string sumColumn) {
+        return processInputAsync(merge(df1, df2, columnName, sumColumn));
+    }
 
-            // Delete the DataFrame
-            delete df;
+private:
+    static Transform merge(DataFrame& df1, DataFrame& df2, std::string columnName, std::string sumColumn) {
+        return [&df1, &df2, columnName, sumColumn](DataFrame* df) {
+            // Deleted once merged, or if the merge throws
+            std::unique_ptr<DataFrame> input(df);
 
-            // Write the DataFrame to the output queue
-            pushToOutputQueues(dfMerged);
-        }
+            // Merge and sum the DataFrames
+            auto dfMerged = std::make_unique<DataFrame>();
+            *dfMerged = DataFrame::mergeAndSum(df1, df2, columnName, sumColumn);
+            return dfMerged.release();
+        };
     }
 };
 
@@ -4,9 +4,15 @@
 #include <iostream>
 #include "DataFrame.hpp"
 #include "Observer.hpp"
+#include "ColumnarFile.hpp"
+#include "AsyncWriter.hpp"
+#include "ResultStore.hpp"
+#include "CsvSerializer.hpp"
+#include "DataFrameBuilder.hpp"
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <memory>
 #include <any>
 #include <typeinfo>
 
@@ -239,35 +245,19 @@ public:
         cout << "Loading data into " << destName << " using csv loading strategy." << endl;
 
         // Open the file
-        ofstream out(destName);
-
-        // Write the header to the file
-        for (int i = 0; i < df->getColumnCount(); i++) {
-            out << df->getColumnName(i);
-
-            // Write a comma if it is not the last column
-            if (i < df->getColumnCount() - 1) {
-                out << ",";
-            }
+        ofstream out(destName, ios::binary);
+        if (!out.is_open()) {
+            throw runtime_error("Failed to open csv file: " + destName);
         }
 
-        out << endl;
-
-        // Iterate over the rows of the DataFrame
-        for (int i = 0; i < df->getRowCount(); i++) {
-            // Iterate over the columns of the DataFrame
-            for (int j = 0; j < df->getColumnCount(); j++) {
-                // Write the value of the cell to the file
-                out << df->getValueAt(i, j);
-
-                // Write a comma if it is not the last column
-                if (j < df->getColumnCount() - 1) {
-                    out << ",";
-                }
-            }
+        // Reuse the buffer of the serializer across the loads of this thread
+        thread_local CsvSerializer serializer;
+        serializer.write(df, out);
 
-            // Print a new line
-            out << endl;
+        // A short write, such as on a full disk, only shows once the stream is flushed
+        out.close();
+        if (out.fail()) {
+            throw runtime_error("Failed to write csv file: " + destName);
         }
     }
 };
@@ -330,20 +320,78 @@ public:
         cout << "Loading data into " << destName << " using txt loading strategy." << endl;
 
         ofstream out(destName);
+        if (!out.is_open()) {
+            throw runtime_error("Failed to open txt file: " + destName);
+        }
 
-        // Save cout buffer
-        streambuf* coutbuf = cout.rdbuf();
-        
-        // Set the file as output of print
-        cout.rdbuf(out.rdbuf());
+        // Print the DataFrame to the file
+        df->print(out);
 
-        // Print the DataFrame
-        df->print();
+        out.close();
+        if (out.fail()) {
+            throw runtime_error("Failed to write txt file: " + destName);
+        }
+    }
+};
 
-        // Restore cout buffer
-        cout.rdbuf(coutbuf);
+/**
+ * @brief A class representing a data repository strategy for extracting data from a columnar file.
+ * 
+ * The ColumnarExtractionStrategy class provides a way to extract and load data using the native binary columnar format.
+ * The file stores the types of the columns, so it is read back without parsing nor type inference.
+ * It implements the DataRepoStrategy interface.
+ */
+class ColumnarExtractionStrategy : public DataRepoStrategy {
+private:
+    bool encode; /**< Whether the columns are stored with lightweight encodings. */
 
-        out.close();
+public:
+    /**
+     * @brief Construct a new ColumnarExtractionStrategy object.
+     * 
+     * @param encode If true, each column is stored with the encoding (run-length, delta, bit-packing or dictionary)
+     *               chosen from its statistics, which shrinks archived outputs. Otherwise the columns are stored
+     *               plain, so they can be read in place from the mapped file.
+     */
+    ColumnarExtractionStrategy(bool encode = false) : encode(encode) {}
+
+    /**
+     * @brief Extracts data from the source.
+     *
+     * This method maps the columnar file in memory and copies or decodes each column in a single block.
+     * 
+     * @param sourceName The source from which to extract data. The delimiter, start line and list are not used.
+     */
+    DataFrame* extractData(const string sourceName, const char, int, vector<string> = {}) override {
+        cout << "Extracting data from " << sourceName << " using columnar extraction strategy." << endl;
+
+        try {
+            ColumnarFile file(sourceName);
+            return file.toDataFrame();
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @brief Loads data into the source.
+     *
+     * This method loads data into the source using the columnar loading strategy.
+     * 
+     * @param df The DataFrame object containing the data to be loaded.
+     * @param destName The destination to which to load data.
+     */
+    void loadData(DataFrame* df, string destName) override {
+        // Set a default name for the destination if it is not provided
+        if (destName == "") {
+            destName = "output.col";
+        }
+
+        cout << "Loading data into " << destName << " using " << (encode ? "archive" : "columnar") << " loading strategy." << endl;
+
+        ColumnarFile::write(df, destName, encode);
     }
 };
 
@@ -363,18 +411,34 @@ public:
      * @param listData The list of strings from which to extract data.
      */
     DataFrame* extractData(const string sourceName, const char delimiter, int startLine, vector<string> listData) override {
-        // Create a DataFrame object with the header
-        DataFrame* df = createDataFrame(listData[0], delimiter);
+        return extractLines(listData, delimiter);
+    }
 
-        // Read the rest of the lines
-        for (int i = 1; i < listData.size(); i++) {
-            // Dummy variable to count the number of columns in the line
-            int emptyCount;
+    /**
+     * @brief Extracts data from a range of lines without copying them.
+     *
+     * The first line is the header. The lines are parsed in place as string_views into typed columns,
+     * by a builder reused across the calls of the same thread, and a trailing line break is ignored.
+     *
+     * @tparam Lines A range of string-like lines, such as a vector of strings or a repeated protobuf field.
+     * @param lines The lines from which to extract data.
+     * @param delimiter The delimiter between the values of a line.
+     * @return A pointer to the DataFrame object containing the extracted data, or nullptr if there are no lines.
+     */
+    template<typename Lines>
+    DataFrame* extractLines(const Lines& lines, const char delimiter) {
+        auto it = begin(lines);
+        if (it == end(lines)) return nullptr;
+
+        thread_local DataFrameBuilder builder;
+        builder.start(string_view(*it), delimiter);
 
-            addLineToDataFrame(listData[i], delimiter, *df, emptyCount);
+        // Read the rest of the lines
+        for (++it; it != end(lines); ++it) {
+            builder.addLine(string_view(*it));
         }
 
-        return df;
+        return builder.build();
     }
 
     // Not implemented
@@ -399,6 +463,34 @@ private:
     DataFrame** extractDf; /**< The DataFrame object containing the extracted data. */
     mutex* mtx; /**< The mutex for the DataFrame object. */
     string loadFileName; /**< The name of the file to load the data into. */
+    shared_ptr<AsyncResultWriter> asyncWriter; /**< The writer for the snapshots taken on time triggers. */
+    ResultStore* resultStore = nullptr; /**< The store that keeps the windows closed by the time triggers. */
+    string resultName; /**< The name of the result in the store. */
+
+    /**
+     * @brief Writes the data into the destination using the specified loading strategy.
+     * 
+     * @param df The DataFrame object containing the data to be loaded.
+     * @param destName The name of the destination to which to load data.
+     * @throws runtime_error If the strategy is not supported or the data could not be written.
+     */
+    void writeData(DataFrame* df, const string& destName) {
+        if (loadStrategy == "csv") {
+            CsvExtractionStrategy csvExtractionStrategy;
+            csvExtractionStrategy.loadData(df, destName);
+        } else if (loadStrategy == "txt") {
+            TxtExtractionStrategy txtExtractionStrategy;
+            txtExtractionStrategy.loadData(df, destName);
+        } else if (loadStrategy == "columnar") {
+            ColumnarExtractionStrategy columnarExtractionStrategy;
+            columnarExtractionStrategy.loadData(df, destName);
+        } else if (loadStrategy == "archive") {
+            ColumnarExtractionStrategy archiveExtractionStrategy(true);
+            archiveExtractionStrategy.loadData(df, destName);
+        } else {
+            throw runtime_error("Loading strategy not supported.");
+        }
+    }
 
 public:
     /**
@@ -438,6 +530,9 @@ public:
         } else if (extractStrategy == "txt") {
             TxtExtractionStrategy txtExtractionStrategy;
             return txtExtractionStrategy.extractData(sourceName, delimiter, startLine);
+        } else if (extractStrategy == "columnar" || extractStrategy == "archive") {
+            ColumnarExtractionStrategy columnarExtractionStrategy;
+            return columnarExtractionStrategy.extractData(sourceName, delimiter, startLine);
         } else if (extractStrategy == "list") {
             ListExtractionStrategy listExtractionStrategy;
             return listExtractionStrategy.extractData("", delimiter, startLine, listData);
@@ -447,23 +542,54 @@ public:
         }
     }
 
+    /**
+     * @brief Extracts data from a range of lines using the list extraction strategy.
+     * 
+     * Unlike extractData, the lines are parsed in place, so the caller does not have to copy them into a vector.
+     * 
+     * @tparam Lines A range of string-like lines, such as a vector of strings or a repeated protobuf field.
+     * @param lines The lines from which to extract data, the first one being the header.
+     * @param delimiter The delimiter between the values of a line.
+     * @return A pointer to the DataFrame object containing the extracted data.
+     */
+    template<typename Lines>
+    DataFrame* extractLines(const Lines& lines, const char delimiter = ',') {
+        if (extractStrategy != "list") {
+            cout << "Extraction strategy not supported." << endl;
+            return nullptr;
+        }
+
+        ListExtractionStrategy listExtractionStrategy;
+        return listExtractionStrategy.extractLines(lines, delimiter);
+    }
+
     /**
      * @brief Loads data into the destination using the specified loading strategy.
      * 
      * This method loads data into the destination using the specified loading strategy.
+     * A named destination is written to a temporary file first and then renamed, so
+     * readers of the destination never see a partially written file. A failed write
+     * removes the temporary file and keeps the previous version of the destination.
      * 
      * @param destName The name of the destination to which to load data.
      * @param df The DataFrame object containing the data to be loaded.
+     * @throws runtime_error If the data could not be written.
      */
     void loadData(DataFrame* df, const string& destName="") {
-        if (loadStrategy == "csv") {
-            CsvExtractionStrategy csvExtractionStrategy;
-            csvExtractionStrategy.loadData(df, destName);
-        } else if (loadStrategy == "txt") {
-            TxtExtractionStrategy txtExtractionStrategy;
-            txtExtractionStrategy.loadData(df, destName);
-        } else {
-            cout << "Loading strategy not supported." << endl;
+        if (destName == "") {
+            writeData(df, destName);
+            return;
+        }
+
+        string tempName = destName + ".tmp";
+        try {
+            writeData(df, tempName);
+        } catch (...) {
+            remove(tempName.c_str());
+            throw;
+        }
+        if (!AsyncResultWriter::publish(tempName, destName)) {
+            throw runtime_error("Failed to publish " + destName);
         }
     }
 
@@ -486,27 +612,61 @@ public:
         this->loadFileName = fileName;
     }
 
+    /**
+     * @brief Sets the writer for the snapshots taken on time triggers.
+     * 
+     * With a writer, the time trigger only takes the DataFrame and hands it to the writer thread.
+     * Without one, the DataFrame is written in the trigger thread.
+     * 
+     * @param writer The writer shared by the data repositories.
+     */
+    void setAsyncWriter(shared_ptr<AsyncResultWriter> writer) {
+        this->asyncWriter = writer;
+    }
+
+    /**
+     * @brief Sets the store in which the snapshots taken on time triggers are archived.
+     * 
+     * @param store The store, which must outlive the repository.
+     * @param name The name of the result in the store.
+     */
+    void setResultStore(ResultStore* store, const string& name) {
+        this->resultStore = store;
+        this->resultName = name;
+    }
+
     // Interface for notification (update) from triggers
     void updateOnTimeTrigger() override {
-        {
-            // Check if there is data to load
-            if (*extractDf == nullptr) {
-                cout << "No data to load." << endl;
-                return;
-            }
+        DataFrame* snapshot;
+        if (resultStore != nullptr) {
+            // The store takes the DataFrame and keeps the aggregates of the closed window for the queries
+            snapshot = resultStore->closeWindow(resultName, extractDf, mtx);
+        } else {
             // Lock the mutex
             lock_guard<mutex> lock(*mtx);
-            
-            // Load the data
-            loadData(*extractDf, loadFileName);
 
-            // Delete the old DataFrame
-            delete (*extractDf);
-
-            // Reset the pointer
+            // Take the DataFrame and reset the pointer, so the merges start a new one
+            snapshot = *extractDf;
             (*extractDf) = nullptr;
         }
 
+        // Check if there is data to load
+        if (snapshot == nullptr) {
+            cout << "No data to load." << endl;
+            return;
+        }
+
+        // Write the data outside the lock
+        if (asyncWriter) {
+            asyncWriter->submit(snapshot, loadFileName, [loadStrategy = loadStrategy](DataFrame* df, const string& destName) {
+                DataRepo repo;
+                repo.setLoadStrategy(loadStrategy);
+                repo.loadData(df, destName);
+            });
+        } else {
+            unique_ptr<DataFrame> owned(snapshot);
+            loadData(owned.get(), loadFileName);
+        }
     }
 
     // Interface for handling request from triggers
@@ -1,20 +1,49 @@
-// creates a class that receives a path and overrides Observer. It has a method that should return the new files that appeared on the directory since the last time it was called. 
+#ifndef DIRECTORY_MONITOR_HPP
+#define DIRECTORY_MONITOR_HPP
 
 #include "Observer.hpp"
+#include <iostream>
 #include <string>
 #include <vector>
-#include <algorithm>
+#include <deque>
+#include <unordered_set>
+#include <chrono>
+#include <thread>
+#include <atomic>
 #include <mutex>  // for std::mutex
+#include <condition_variable>
+#include <cerrno>
+#include <climits>
 #include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
 
-
+/**
+ * @brief Class for watching a directory for new files.
+ *
+ * The DirectoryMonitor uses inotify to be notified by the kernel when a file is completely written
+ * (IN_CLOSE_WRITE) or moved into the directory (IN_MOVED_TO). A background thread pushes each
+ * file-ready event into a queue, so new files are picked up within milliseconds and the directory
+ * is never scanned periodically. The files already present when the monitor is created are reported
+ * once, as the first batch of new files.
+ */
 class DirectoryMonitor : public Observer {
 private:
     std::mutex mutex;
-    std::vector<std::string> prevFiles;
+    std::condition_variable readyCondition;
+    std::deque<std::string> readyFiles; /**< Queue of file-ready events not yet consumed. */
+    std::unordered_set<std::string> seenFiles; /**< Paths already pushed into the queue. */
     std::string dirPath;
 
+    int inotifyFd = -1; /**< The inotify instance. */
+    int watchFd = -1; /**< The watch descriptor of the directory. */
+    int wakeFd = -1; /**< Eventfd used to wake the watcher thread on destruction. */
+    std::atomic<bool> running{false};
+    std::thread watcherThread;
+
     bool isRegularFile(const std::string& path) {
         struct stat statbuf;
         if (stat(path.c_str(), &statbuf) == 0) {
@@ -23,47 +52,196 @@ private:
         return false;
     }
 
-public:
-    // Public constructor
-    DirectoryMonitor(const std::string& dir) : dirPath(dir) {}
-
-    // Delete copy constructor and assignment operator
-    DirectoryMonitor(const DirectoryMonitor&) = delete;
-    DirectoryMonitor& operator=(const DirectoryMonitor&) = delete;
-
-    std::vector<std::string> getNewFiles() {
-        std::lock_guard<std::mutex> lock(mutex);  // Acquire mutex lock
-
-        std::vector<std::string> newFiles;
-        std::vector<std::string> currentFiles;
+    /**
+     * @brief Push a file to the ready queue if it was not seen before.
+     *
+     * Must be called with the mutex held.
+     *
+     * @param fullPath The full path of the file.
+     * @return true if the file was pushed, false if it was already seen.
+     */
+    bool pushReadyFile(const std::string& fullPath) {
+        if (!seenFiles.insert(fullPath).second) return false;
+        readyFiles.push_back(fullPath);
+        return true;
+    }
 
-        // Get the list of files in the directory
+    /**
+     * @brief Scan the directory once and push the regular files not seen yet.
+     *
+     * Used to seed the queue with the files present at startup and to recover
+     * from an inotify queue overflow (IN_Q_OVERFLOW), when events may have been lost.
+     */
+    void scanDirectory() {
         DIR *directory = opendir(dirPath.c_str());
         if (directory == nullptr) {
-            std::cerr << "Failed to open directory" << std::endl;
-            return newFiles;
+            std::cerr << "Failed to open directory: " << dirPath << std::endl;
+            return;
         }
 
-        struct dirent *entry;
-        while ((entry = readdir(directory)) != nullptr) {
-            std::string fullPath = dirPath + "/" + entry->d_name;
-            if (isRegularFile(fullPath)) {
-                currentFiles.push_back(entry->d_name);
+        bool pushed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            struct dirent *entry;
+            while ((entry = readdir(directory)) != nullptr) {
+                std::string fullPath = dirPath + "/" + entry->d_name;
+                if (isRegularFile(fullPath)) {
+                    pushed |= pushReadyFile(fullPath);
+                }
             }
         }
         closedir(directory);
 
-        // Find new files by comparing current files with previous files
-        std::set_difference(currentFiles.begin(), currentFiles.end(),
-                            prevFiles.begin(), prevFiles.end(),
-                            std::back_inserter(newFiles));
+        if (pushed) readyCondition.notify_all();
+    }
+
+    /**
+     * @brief Loop of the watcher thread.
+     *
+     * Blocks on the inotify descriptor and translates the events into file-ready entries.
+     */
+    void watch() {
+        // Buffer aligned as required by inotify_event
+        alignas(struct inotify_event) char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+        struct pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+
+        while (running) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Failed to poll directory: " << dirPath << std::endl;
+                return;
+            }
+
+            // Woken up for destruction
+            if (fds[1].revents & POLLIN) return;
+            if (!(fds[0].revents & POLLIN)) continue;
 
-        // Update previous files list
-        prevFiles = currentFiles;
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) continue;
 
+            bool pushed = false;
+            bool overflow = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        overflow = true;
+                    } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                        pushed |= pushReadyFile(dirPath + "/" + event->name);
+                    }
+                    ptr += sizeof(struct inotify_event) + event->len;
+                }
+            }
+
+            // Events were dropped by the kernel, so fall back to a single scan
+            if (overflow) scanDirectory();
+            if (pushed) readyCondition.notify_all();
+        }
+    }
+
+    /**
+     * @brief Move the pending file-ready events to a vector.
+     *
+     * Must be called with the mutex held.
+     */
+    std::vector<std::string> takeReadyFiles() {
+        std::vector<std::string> newFiles(std::make_move_iterator(readyFiles.begin()),
+                                          std::make_move_iterator(readyFiles.end()));
+        readyFiles.clear();
         return newFiles;
     }
 
+public:
+    /**
+     * @brief Construct a new DirectoryMonitor object and start watching the directory.
+     *
+     * @param dir The directory to watch.
+     */
+    DirectoryMonitor(const std::string& dir) : dirPath(dir) {
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (inotifyFd >= 0) {
+            watchFd = inotify_add_watch(inotifyFd, dirPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        }
+        if (inotifyFd < 0 || watchFd < 0 || wakeFd < 0) {
+            std::cerr << "Failed to watch directory: " << dirPath << std::endl;
+        }
+
+        // Register the watch before scanning, so no file falls between the scan and the first event
+        scanDirectory();
+
+        if (watchFd >= 0 && wakeFd >= 0) {
+            running = true;
+            watcherThread = std::thread(&DirectoryMonitor::watch, this);
+        }
+    }
+
+    // Delete copy constructor and assignment operator
+    DirectoryMonitor(const DirectoryMonitor&) = delete;
+    DirectoryMonitor& operator=(const DirectoryMonitor&) = delete;
+
+    /**
+     * @brief Stop the watcher thread and release the inotify resources.
+     */
+    ~DirectoryMonitor() {
+        if (running) {
+            running = false;
+            uint64_t one = 1;
+            if (write(wakeFd, &one, sizeof(one)) < 0) {
+                std::cerr << "Failed to wake directory watcher: " << dirPath << std::endl;
+            }
+        }
+        if (watcherThread.joinable()) watcherThread.join();
+        if (inotifyFd >= 0) close(inotifyFd);
+        if (wakeFd >= 0) close(wakeFd);
+
+        // Wake any consumer still blocked on the queue
+        readyCondition.notify_all();
+    }
+
+    /**
+     * @brief Get the files that became ready since the last call.
+     *
+     * Does not block and does not touch the file system, unless inotify is unavailable,
+     * in which case the directory is scanned instead.
+     *
+     * @return The full paths of the new files.
+     */
+    std::vector<std::string> getNewFiles() {
+        if (!running) scanDirectory();
+
+        std::lock_guard<std::mutex> lock(mutex);  // Acquire mutex lock
+        return takeReadyFiles();
+    }
+
+    /**
+     * @brief Wait until new files are ready or the timeout expires.
+     *
+     * @param timeout The maximum time to wait.
+     * @return The full paths of the new files (empty on timeout).
+     */
+    std::vector<std::string> waitForNewFiles(std::chrono::milliseconds timeout) {
+        // Without inotify, degrade to polling the directory once per timeout
+        if (!running) {
+            std::this_thread::sleep_for(timeout);
+            return getNewFiles();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        readyCondition.wait_for(lock, timeout, [this] { return !readyFiles.empty() || !running; });
+        return takeReadyFiles();
+    }
+
+    /**
+     * @brief Check if the monitor is receiving events from the kernel.
+     *
+     * @return true if the directory is being watched, false otherwise.
+     */
+    bool isWatching() const {
+        return running;
+    }
+
     void updateOnTimeTrigger() override {
         std::vector<std::string> newFiles = getNewFiles();
         for (const auto& file : newFiles) {
@@ -77,5 +255,7 @@ public:
             std::cout << "New file appeared: " << file << std::endl;
         }
     }
-    
-};
\ No newline at end of file
+
+};
+
+#endif // DIRECTORY_MONITOR_HPP
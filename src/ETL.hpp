@@ -6,68 +6,49 @@
 #include <chrono>
 #include <algorithm>
 #include <thread>
+#include <atomic>
+#include <memory>
 #include <filesystem>
-#include <dirent.h>
-#include <sys/stat.h>
 #include <string>
+#include <unordered_set>
 #include <mutex>  // for std::mutex
 #include "Observer.hpp"
 #include "DataFrame.hpp"
 #include "DataRepo.hpp"
 #include "Queue.hpp"
 #include "DataHandler.hpp"
+#include "DirectoryMonitor.hpp"
 
 class ETL : public Observer {
 private:
 
-    std::vector<std::string> processedCSVFiles;
-    std::vector<std::string> processedTXTFiles;
-    std::vector<std::string> processedRequestFiles;
+    std::unordered_set<std::string> processedCSVFiles;
+    std::unordered_set<std::string> processedTXTFiles;
+    std::unordered_set<std::string> processedRequestFiles;
     std::string csvDirPath;
     std::string txtDirPath;
     std::string requestDirPath;
 
-    // create dataRepo object that should be live throughout the pipeline
-    DataRepo repo;
-
     // queues references for the dataframes
     Queue<DataFrame*>& queueOutDC;
     Queue<DataFrame*>& queueOutCA;
     // reference pointer for vector of dataframes
     Queue<DataFrame*>& queueOutCV;
-    
 
-    bool isRegularFile(const std::string& path) {
-        struct stat statbuf;
-        if (stat(path.c_str(), &statbuf) == 0) {
-            return S_ISREG(statbuf.st_mode);
-        }
-        return false;
-    }
+    // inotify watchers that queue the files of each directory as soon as they are written
+    std::unique_ptr<DirectoryMonitor> txtMonitor;
+    std::unique_ptr<DirectoryMonitor> requestMonitor;
 
-    std::vector<std::string> monitorDirectory(const std::string& dirPath, std::vector<std::string>& processedFiles) {
-        std::vector<std::string> newFiles;
-
-        // Get the list of files in the directory
-        DIR *directory = opendir(dirPath.c_str());
-        if (directory == nullptr) {
-            std::cerr << "Failed to open directory: " << dirPath << std::endl;
-            return newFiles;
-        }
+    // threads that consume the watcher events as they arrive
+    std::atomic<bool> watching{false};
+    std::thread txtWatchThread;
+    std::thread requestWatchThread;
 
-        struct dirent *entry;
-        while ((entry = readdir(directory)) != nullptr) {
-            std::string fullPath = dirPath + "/" + entry->d_name;
-            if (isRegularFile(fullPath) && std::find(processedFiles.begin(), processedFiles.end(), fullPath) == processedFiles.end()) {
-                newFiles.push_back(fullPath);
-            }
-        }
-        closedir(directory);
-
-        return newFiles;
-    }
+    // serializes the processing of each pipeline between triggers and watcher threads
+    std::mutex txtMutex;
+    std::mutex requestMutex;
 
-    void processFiles(const std::vector<std::string>& files, std::vector<std::string>& processedFiles, Queue<DataFrame*>& queueOut, string strategy) {
+    void processFiles(const std::vector<std::string>& files, std::unordered_set<std::string>& processedFiles, Queue<DataFrame*>& queueOut, string strategy) {
         if (files.empty()) {
             // std::cout << "No new files found." << std::endl;
             return;
@@ -75,12 +56,12 @@ private:
 
         for (const auto& filePath : files) {    
             // Check if the file is already processed
-            if (std::find(processedFiles.begin(), processedFiles.end(), filePath) != processedFiles.end()) {
+            if (!processedFiles.insert(filePath).second) {
                 continue;
             }
 
-            processedFiles.push_back(filePath);
-            
+            // Each call owns its repo, since the pipelines may run concurrently
+            DataRepo repo;
             repo.setExtractionStrategy(strategy);
             DataFrame* df = repo.extractData(filePath, ';');
             if (df == nullptr) {
@@ -102,25 +83,61 @@ private:
     }
 
     void procccessTxtPipeline(){
-        std::vector<std::string> updatedTXTFiles = monitorDirectory(txtDirPath, processedTXTFiles);
+        std::lock_guard<std::mutex> lock(txtMutex);
+        std::vector<std::string> updatedTXTFiles = txtMonitor->getNewFiles();
         processFiles(updatedTXTFiles, processedTXTFiles, queueOutDC, "txt");
     }
 
     void processRequestPipeline(){
-        std::vector<std::string> updatedRequestFiles = monitorDirectory(requestDirPath, processedRequestFiles);
+        std::lock_guard<std::mutex> lock(requestMutex);
+        std::vector<std::string> updatedRequestFiles = requestMonitor->getNewFiles();
         processFiles(updatedRequestFiles, processedRequestFiles, queueOutCA, "txt");
     }
 
+    // Block on a watcher and process each batch of files as soon as it is ready
+    void watchDirectory(DirectoryMonitor& monitor, std::mutex& pipelineMutex, std::unordered_set<std::string>& processedFiles, Queue<DataFrame*>& queueOut) {
+        while (watching) {
+            std::vector<std::string> newFiles = monitor.waitForNewFiles(std::chrono::milliseconds(500));
+            if (newFiles.empty()) continue;
+
+            std::lock_guard<std::mutex> lock(pipelineMutex);
+            processFiles(newFiles, processedFiles, queueOut, "txt");
+        }
+    }
+
     public:
         ETL(const std::string& csvDirectory, const std::string& txtDirectory, const std::string& requestDirectory, Queue<DataFrame*>& queueCV, Queue<DataFrame*>& queueDC, Queue<DataFrame*>& queueCA)
-            : csvDirPath(csvDirectory), txtDirPath(txtDirectory), requestDirPath(requestDirectory), queueOutCV(queueCV), queueOutDC(queueDC), queueOutCA(queueCA) {
+            : csvDirPath(csvDirectory), txtDirPath(txtDirectory), requestDirPath(requestDirectory), queueOutCV(queueCV), queueOutDC(queueDC), queueOutCA(queueCA),
+              txtMonitor(std::make_unique<DirectoryMonitor>(txtDirectory)), requestMonitor(std::make_unique<DirectoryMonitor>(requestDirectory)) {
             std::cout << "ETL created!" << std::endl;
         }
 
         ~ETL() {
+            stopWatching();
             std::cout << "ETL destroyed!" << std::endl;
         }
 
+    /**
+     * @brief Start processing the log and request files as soon as they are written.
+     *
+     * The watcher threads block on the inotify events of each directory, so the files are
+     * processed without waiting for a trigger. Triggers can still be used alongside.
+     */
+    void startWatching() {
+        if (watching.exchange(true)) return;
+        txtWatchThread = std::thread(&ETL::watchDirectory, this, std::ref(*txtMonitor), std::ref(txtMutex), std::ref(processedTXTFiles), std::ref(queueOutDC));
+        requestWatchThread = std::thread(&ETL::watchDirectory, this, std::ref(*requestMonitor), std::ref(requestMutex), std::ref(processedRequestFiles), std::ref(queueOutCA));
+    }
+
+    /**
+     * @brief Stop the watcher threads started by startWatching.
+     */
+    void stopWatching() {
+        if (!watching.exchange(false)) return;
+        if (txtWatchThread.joinable()) txtWatchThread.join();
+        if (requestWatchThread.joinable()) requestWatchThread.join();
+    }
+
     // Interface for notification (update) from triggers
     void updateOnRequestTrigger() override {
 
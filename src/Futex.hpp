@@ -0,0 +1,123 @@
+#ifndef FUTEX_HPP
+#define FUTEX_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+/**
+ * @brief Class for parking threads on a 32-bit atomic word.
+ *
+ * On Linux the threads sleep in the kernel with the futex system call, which also supports deadlines.
+ * Elsewhere the atomic wait of the standard library is used, and deadlines are polled.
+ */
+class Futex {
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The futex word must be a plain 32-bit integer");
+
+#ifdef __linux__
+    static long call(std::atomic<uint32_t>& word, int op, uint32_t value, const timespec* timeout, uint32_t mask) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op | FUTEX_PRIVATE_FLAG, value, timeout, nullptr, mask);
+    }
+#endif
+
+public:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    /**
+     * @brief Sleep while the word holds the expected value.
+     *
+     * The call may return early, so the caller must check its condition again.
+     *
+     * @param word The word to wait on.
+     * @param expected The value the word must hold for the thread to sleep.
+     */
+    static void wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+        call(word, FUTEX_WAIT, expected, nullptr, 0);
+#else
+        word.wait(expected, std::memory_order_acquire);
+#endif
+    }
+
+    /**
+     * @brief Sleep while the word holds the expected value, until a deadline.
+     *
+     * The call may return early, so the caller must check its condition again.
+     *
+     * @param word The word to wait on.
+     * @param expected The value the word must hold for the thread to sleep.
+     * @param deadline The time at which to give up.
+     * @return false If the deadline passed, true otherwise.
+     */
+    static bool waitUntil(std::atomic<uint32_t>& word, uint32_t expected, Deadline deadline) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+
+#ifdef __linux__
+        // The steady clock is CLOCK_MONOTONIC, which FUTEX_WAIT_BITSET takes as an absolute deadline
+        auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec timeout{static_cast<time_t>(since / 1000000000), static_cast<long>(since % 1000000000)};
+        long result = call(word, FUTEX_WAIT_BITSET, expected, &timeout, FUTEX_BITSET_MATCH_ANY);
+        return !(result == -1 && errno == ETIMEDOUT);
+#else
+        // Poll the word, as the standard wait has no deadline
+        while (word.load(std::memory_order_acquire) == expected) {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Wake one thread sleeping on the word.
+     *
+     * @param word The word the threads wait on.
+     */
+    static void wakeOne(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+        call(word, FUTEX_WAKE, 1, nullptr, 0);
+#else
+        word.notify_one();
+#endif
+    }
+
+    /**
+     * @brief Wake up to a number of threads sleeping on the word.
+     *
+     * @param word The word the threads wait on.
+     * @param count The largest number of threads to wake.
+     */
+    static void wake(std::atomic<uint32_t>& word, int count) {
+#ifdef __linux__
+        call(word, FUTEX_WAKE, static_cast<uint32_t>(count), nullptr, 0);
+#else
+        for (int i = 0; i < count; i++) word.notify_one();
+#endif
+    }
+
+    /**
+     * @brief Wake all the threads sleeping on the word.
+     *
+     * @param word The word the threads wait on.
+     */
+    static void wakeAll(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+        call(word, FUTEX_WAKE, INT32_MAX, nullptr, 0);
+#else
+        word.notify_all();
+#endif
+    }
+};
+
+#endif // FUTEX_HPP
@@ -0,0 +1,290 @@
+#ifndef FUTURE_HPP
+#define FUTURE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <optional>
+#include <variant>
+#include <exception>
+#include <functional>
+#include <type_traits>
+
+#include "Futex.hpp"
+
+using namespace std;
+
+/**
+ * @brief Function that runs a job, on a thread pool or inline.
+ */
+using Executor = function<void(function<void()>)>;
+
+template <typename T>
+class Future;
+
+/**
+ * @brief Class for setting the result of a Future.
+ *
+ * The Promise and its Future share a state. Setting the value or the exception wakes the threads waiting
+ * on the Future and runs its continuations.
+ */
+template <typename T>
+class Promise {
+public:
+    using Value = conditional_t<is_void_v<T>, monostate, T>;
+
+    /**
+     * @brief The state shared by a Promise and its Futures.
+     */
+    struct State {
+        mutex stateMutex; /**< The mutex for the continuations. */
+        atomic<uint32_t> ready{0}; /**< Futex word, set to 1 once the result is set. */
+        atomic<int> waiters{0}; /**< The number of threads waiting for the result. */
+        optional<Value> value; /**< The value, once set. */
+        exception_ptr error; /**< The exception, if the job failed. */
+        vector<function<void()>> callbacks; /**< The callbacks to run once the result is set. */
+        Executor executor; /**< Runs the continuations, inline if empty. */
+    };
+
+    /**
+     * @brief Construct a new Promise object.
+     *
+     * @param executor Runs the continuations of the Future, which run inline if it is empty.
+     */
+    Promise(Executor executor = nullptr) : state(make_shared<State>()) {
+        state->executor = std::move(executor);
+    }
+
+    /**
+     * @brief Get the Future of the Promise.
+     *
+     * @return The Future that receives the result.
+     */
+    Future<T> getFuture() const {
+        return Future<T>(state);
+    }
+
+    /**
+     * @brief Set the value of the Future.
+     *
+     * @param value The value, omitted for a Future of void.
+     */
+    template <typename... Args>
+    void setValue(Args&&... value) {
+        state->value.emplace(std::forward<Args>(value)...);
+        complete();
+    }
+
+    /**
+     * @brief Set the exception of the Future.
+     *
+     * @param error The exception thrown by the job.
+     */
+    void setException(exception_ptr error) {
+        state->error = error;
+        complete();
+    }
+
+    /**
+     * @brief Run a job and set its result, or the exception it throws.
+     *
+     * @param job The job, called with the arguments.
+     * @param args The arguments of the job.
+     */
+    template <typename F, typename... Args>
+    void setFrom(F& job, Args&&... args) {
+        try {
+            if constexpr (is_void_v<T>) {
+                job(std::forward<Args>(args)...);
+                setValue();
+            } else {
+                setValue(job(std::forward<Args>(args)...));
+            }
+        } catch (...) {
+            setException(current_exception());
+        }
+    }
+
+private:
+    shared_ptr<State> state;
+
+    void complete() {
+        vector<function<void()>> callbacks;
+        {
+            lock_guard<mutex> lock(state->stateMutex);
+            state->ready.store(1, memory_order_seq_cst);
+            callbacks.swap(state->callbacks);
+        }
+        if (state->waiters.load(memory_order_seq_cst) > 0) Futex::wakeAll(state->ready);
+        for (auto& callback : callbacks) callback();
+    }
+};
+
+/**
+ * @brief Class for the result of a job that runs asynchronously.
+ *
+ * A Future can be waited on, or continued with then, which runs a job on the result once it is set and
+ * gives the Future of that job. Copies of a Future share the result.
+ */
+template <typename T>
+class Future {
+public:
+    using State = typename Promise<T>::State;
+
+    Future() = default;
+    explicit Future(shared_ptr<State> state) : state(std::move(state)) {}
+
+    /**
+     * @brief Check if the Future has a shared state.
+     *
+     * @return true If the Future comes from a Promise.
+     */
+    bool isValid() const {
+        return state != nullptr;
+    }
+
+    /**
+     * @brief Check if the result is set.
+     *
+     * @return true If the value or the exception is set.
+     */
+    bool isReady() const {
+        return state->ready.load(memory_order_acquire) == 1;
+    }
+
+    /**
+     * @brief Wait until the result is set.
+     */
+    void wait() const {
+        while (!isReady()) {
+            state->waiters.fetch_add(1, memory_order_seq_cst);
+            if (!isReady()) Futex::wait(state->ready, 0);
+            state->waiters.fetch_sub(1, memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Wait for the result and get it.
+     *
+     * @return The value, nothing for a Future of void.
+     * @throws The exception of the job, if it failed.
+     */
+    T get() const {
+        wait();
+        if (state->error) rethrow_exception(state->error);
+        if constexpr (is_void_v<T>) return;
+        else return *state->value;
+    }
+
+    /**
+     * @brief Run a callback on the thread that sets the result, or now if it is set.
+     *
+     * Meant for short callbacks, such as counting the results of whenAll.
+     *
+     * @param callback The callback to run.
+     */
+    void onReady(function<void()> callback) const {
+        {
+            lock_guard<mutex> lock(state->stateMutex);
+            if (!isReady()) {
+                state->callbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+    /**
+     * @brief Continue the Future with a job on its result.
+     *
+     * The job runs on the executor of the Future once the result is set. If the Future failed, the job is
+     * skipped and its Future gets the same exception.
+     *
+     * @param job The job, called with the value, or without arguments for a Future of void.
+     * @return The Future of the job.
+     */
+    template <typename F>
+    auto then(F job) const {
+        using R = typename decltype(continuationResult<F>())::type;
+        Promise<R> promise(state->executor);
+        Future<R> next = promise.getFuture();
+
+        shared_ptr<State> source = state;
+        onReady([source, promise, job]() mutable {
+            auto run = [source, promise, job]() mutable {
+                if (source->error) {
+                    promise.setException(source->error);
+                } else if constexpr (is_void_v<T>) {
+                    promise.setFrom(job);
+                } else {
+                    promise.setFrom(job, *source->value);
+                }
+            };
+            if (source->executor) source->executor(std::move(run));
+            else run();
+        });
+        return next;
+    }
+
+private:
+    /**
+     * @brief Get the result type of a continuation, which takes no argument after a Future of void.
+     */
+    template <typename F>
+    static auto continuationResult() {
+        if constexpr (is_void_v<T>) return type_identity<invoke_result_t<F>>{};
+        else return type_identity<invoke_result_t<F, const T&>>{};
+    }
+
+    shared_ptr<State> state;
+};
+
+/**
+ * @brief Combine Futures into the Future of all their results.
+ *
+ * The results keep the order of the Futures. If one fails, the combined Future gets the first exception
+ * once all of them are set.
+ *
+ * @param futures The Futures to wait for.
+ * @param executor Runs the continuations of the combined Future.
+ * @return The Future of the results, of void for Futures of void.
+ */
+template <typename T>
+auto whenAll(const vector<Future<T>>& futures, Executor executor = nullptr) {
+    using R = conditional_t<is_void_v<T>, void, vector<T>>;
+    Promise<R> promise(std::move(executor));
+    Future<R> combined = promise.getFuture();
+
+    if (futures.empty()) {
+        if constexpr (is_void_v<T>) promise.setValue();
+        else promise.setValue(R{});
+        return combined;
+    }
+
+    // The last Future to be set completes the combined Future, when all the results can be read at once
+    auto inputs = make_shared<vector<Future<T>>>(futures);
+    auto remaining = make_shared<atomic<size_t>>(futures.size());
+    for (const Future<T>& future : futures) {
+        future.onReady([inputs, remaining, promise]() mutable {
+            if (remaining->fetch_sub(1, memory_order_acq_rel) != 1) return;
+
+            try {
+                if constexpr (is_void_v<T>) {
+                    for (const Future<T>& done : *inputs) done.get();
+                    promise.setValue();
+                } else {
+                    R results;
+                    results.reserve(inputs->size());
+                    for (const Future<T>& done : *inputs) results.push_back(done.get());
+                    promise.setValue(std::move(results));
+                }
+            } catch (...) {
+                promise.setException(current_exception());
+            }
+        });
+    }
+    return combined;
+}
+
+#endif // FUTURE_HPP
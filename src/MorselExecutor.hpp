@@ -0,0 +1,154 @@
+#ifndef MORSEL_EXECUTOR_HPP
+#define MORSEL_EXECUTOR_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "Futex.hpp"
+#include "Future.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for splitting the rows of a large DataFrame into morsels that run on several threads.
+ *
+ * A morsel is a fixed-size range of rows. The morsels are handed out one at a time from a shared counter:
+ * helpers are started on the executor, and the calling thread takes morsels as well, so a loop makes
+ * progress even when every thread of the pool is busy, or when it is called from one of them. The call
+ * returns once every morsel is done, and rethrows the first exception thrown by one of them.
+ *
+ * An executor built without an executor runs the morsels inline, one after the other.
+ */
+class MorselExecutor {
+public:
+    static constexpr size_t DEFAULT_MORSEL_ROWS = 16384; /**< Rows of a morsel, small enough to stay in cache. */
+
+    /**
+     * @brief Construct a new MorselExecutor object.
+     *
+     * @param executor Runs the helpers, such as the executor of a ThreadPool, or inline if it is empty.
+     * @param workers The number of helpers a loop may start, usually the number of threads of the pool.
+     * @param morselRows The number of rows of a morsel.
+     */
+    MorselExecutor(Executor executor = nullptr, int workers = 0, size_t morselRows = DEFAULT_MORSEL_ROWS)
+        : executor(std::move(executor)), workers(max(workers, 0)), morselRows(max<size_t>(morselRows, 1)) {}
+
+    /**
+     * @brief Get the number of rows of a morsel.
+     *
+     * @return The rows of a morsel.
+     */
+    size_t getMorselRows() const {
+        return morselRows;
+    }
+
+    /**
+     * @brief Get the number of morsels a range of rows is split into.
+     *
+     * @param rows The number of rows.
+     * @return The number of morsels, the last one of which may be shorter.
+     */
+    size_t getMorselCount(size_t rows) const {
+        return (rows + morselRows - 1) / morselRows;
+    }
+
+    /**
+     * @brief Run a function on each morsel of a range of rows.
+     *
+     * @param rows The number of rows.
+     * @param body Called with the index of the morsel and its range of rows [begin, end).
+     */
+    void forEachMorsel(size_t rows, const function<void(size_t morsel, size_t begin, size_t end)>& body) const {
+        forEachIndex(getMorselCount(rows), [&](size_t morsel) {
+            size_t begin = morsel * morselRows;
+            body(morsel, begin, min(begin + morselRows, rows));
+        });
+    }
+
+    /**
+     * @brief Run a function on each index of a range, each index being a job of its own.
+     *
+     * @param count The number of indexes.
+     * @param body Called with each index in [0, count).
+     */
+    void forEachIndex(size_t count, const function<void(size_t index)>& body) const {
+        if (count == 0) return;
+        if (count == 1 || !executor || workers == 0) {
+            for (size_t index = 0; index < count; index++) body(index);
+            return;
+        }
+
+        auto state = make_shared<LoopState>(count, body);
+        int helpers = static_cast<int>(min<size_t>(count - 1, workers));
+        for (int i = 0; i < helpers; i++) {
+            // A helper that starts once the morsels are gone finds none and returns
+            executor([state] { state->work(); });
+        }
+        state->work();
+        state->wait();
+
+        if (state->error) rethrow_exception(state->error);
+    }
+
+private:
+    /**
+     * @brief The state of a loop, shared with the helpers, which may start after the loop returns.
+     */
+    struct LoopState {
+        size_t count; /**< The number of indexes. */
+        function<void(size_t)> body; /**< The function run on each index. */
+        atomic<size_t> next{0}; /**< The next index to hand out. */
+        atomic<uint32_t> remaining; /**< The indexes not done yet, which is also the futex word of the caller. */
+        atomic<int> waiters{0}; /**< Set while the caller sleeps on the remaining indexes. */
+        mutex errorMutex; /**< The mutex for the first exception. */
+        exception_ptr error; /**< The first exception thrown by the body. */
+
+        LoopState(size_t count, const function<void(size_t)>& body)
+            : count(count), body(body), remaining(static_cast<uint32_t>(count)) {}
+
+        /**
+         * @brief Take indexes and run them until none is left.
+         */
+        void work() {
+            size_t index;
+            while ((index = next.fetch_add(1, memory_order_relaxed)) < count) {
+                try {
+                    body(index);
+                } catch (...) {
+                    lock_guard<mutex> lock(errorMutex);
+                    if (!error) error = current_exception();
+                }
+
+                // The last index done wakes the caller, if it sleeps
+                if (remaining.fetch_sub(1, memory_order_seq_cst) == 1 && waiters.load(memory_order_seq_cst) > 0) {
+                    Futex::wakeAll(remaining);
+                }
+            }
+        }
+
+        /**
+         * @brief Wait until the indexes taken by the helpers are done.
+         */
+        void wait() {
+            while (true) {
+                waiters.fetch_add(1, memory_order_seq_cst);
+                uint32_t left = remaining.load(memory_order_seq_cst);
+                if (left != 0) Futex::wait(remaining, left);
+                waiters.fetch_sub(1, memory_order_relaxed);
+                // The load synchronizes with the last decrement, so the results and the exception are seen
+                if (left == 0) break;
+            }
+        }
+    };
+
+    Executor executor; /**< Runs the helpers. */
+    int workers; /**< The largest number of helpers of a loop. */
+    size_t morselRows; /**< The number of rows of a morsel. */
+};
+
+#endif // MORSEL_EXECUTOR_HPP
@@ -2,83 +2,874 @@
 #define QUEUE_HPP
 
 #include <iostream>
-#include <queue>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <mutex>
+#include <deque>
+#include <functional>
+#include <coroutine>
 
-#include "Semaphore.hpp"
+#include "Futex.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /**
  * @brief Class for handling a queue of data.
+ *
+ * The queue is a bounded lock-free ring buffer for multiple producers and consumers. Each cell carries
+ * a sequence number that tells whether it is free for the push of a given position or holds the element
+ * for the pop of that position, so producers and consumers only contend on the position counters, which
+ * live on cache lines of their own. The sequence is twice the position, plus one once the element is in
+ * the cell, so it never repeats between laps whatever the capacity.
+ *
+ * A push on a full queue or a pop on an empty one spins for a short while, then yields, and then parks
+ * the thread until the other side makes progress. Batches reserve all their positions with a single
+ * update of the position counter and wake the other side once.
+ *
+ * When the wiring registers exactly one producer and one consumer and seals the queue, it switches to a
+ * single producer single consumer mode: each side owns its position and keeps a cached copy of the other
+ * one, so a push or pop is a plain store of the position, with no compare-and-swap and no cell sequence.
+ * The caller must then guarantee that a single thread pushes and a single thread pops at any time.
+ *
+ * Coroutines wait on the queue with the awaitables of pushAsync, popAsync, pushBatchAsync and
+ * popBatchAsync: instead of parking their thread, they are suspended and registered on the queue, and the
+ * other side resumes them on their executor once it makes progress.
+ *
+ * Closing the queue ends its stream: the elements already queued can still be popped, then the blocking
+ * pops return false instead of waiting, and pushes throw. Producers registered with addProducer close
+ * the queue together, when the last one calls closeProducer.
  */
 template <typename T>
 class Queue {
 private:
-    std::queue<T> queue;
-    Semaphore emptyQueue;
-    Semaphore fullQueue;
-    std::mutex mutex;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr int SPIN_LIMIT = 64; /**< Attempts with a pause before a waiting thread yields. */
+    static constexpr int YIELD_LIMIT = 8; /**< Attempts with a yield before a waiting thread parks. */
+
+    /**
+     * @brief A coroutine suspended on the queue.
+     */
+    struct AsyncWaiter {
+        virtual void wake() = 0; /**< Schedules the retry of the operation of the coroutine. */
+        virtual ~AsyncWaiter() = default;
+    };
+
+    /**
+     * @brief The coroutines suspended on one side of the queue.
+     */
+    struct AsyncWaiters {
+        std::mutex waitersMutex;
+        std::deque<AsyncWaiter*> waiting;
+        std::atomic<int> count{0}; /**< The number of waiting coroutines, read without the mutex. */
+    };
+
+    /**
+     * @brief A slot of the ring buffer.
+     */
+    struct Cell {
+        std::atomic<size_t> sequence; /**< 2 * pos when free for the push of pos, 2 * pos + 1 when full. */
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    int maxSize;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos{0};
+    size_t cachedDequeuePos = 0; /**< Last position of the consumer seen by the single producer. */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos{0};
+    size_t cachedEnqueuePos = 0; /**< Last position of the producer seen by the single consumer. */
+
+    // Registration of the producers and consumers, to pick the mode of the queue
+    std::atomic<int> producers{0};
+    std::atomic<int> consumers{0};
+    bool singleProducerConsumer = false;
+    std::atomic<bool> closed{false}; /**< Whether the stream of the queue ended. */
+
+    // Parking of the threads that wait on a full or empty queue
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> pushEpoch{0};
+    std::atomic<int> pushWaiters{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> popEpoch{0};
+    std::atomic<int> popWaiters{0};
+
+    // Coroutines suspended on a full or empty queue
+    AsyncWaiters pushAsyncWaiters;
+    AsyncWaiters popAsyncWaiters;
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * @brief Wake the threads parked and the coroutines suspended on the other side, if there are any.
+     *
+     * Must be called after claiming positions with a sequentially consistent operation: either the waiter
+     * registered before and is seen here, or it sees the claimed positions and does not park.
+     *
+     * @param all Whether to wake all the waiters, when there is work for more than one.
+     */
+    static void wake(std::atomic<uint32_t>& epoch, std::atomic<int>& waiters, AsyncWaiters& asyncWaiters, bool all = false) {
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            if (all) Futex::wakeAll(epoch);
+            else Futex::wakeOne(epoch);
+        }
+
+        if (asyncWaiters.count.load(std::memory_order_seq_cst) > 0) {
+            std::deque<AsyncWaiter*> woken;
+            {
+                std::lock_guard<std::mutex> lock(asyncWaiters.waitersMutex);
+                if (all) woken.swap(asyncWaiters.waiting);
+                else if (!asyncWaiters.waiting.empty()) {
+                    woken.push_back(asyncWaiters.waiting.front());
+                    asyncWaiters.waiting.pop_front();
+                }
+                asyncWaiters.count.fetch_sub(static_cast<int>(woken.size()), std::memory_order_relaxed);
+            }
+            for (AsyncWaiter* waiter : woken) waiter->wake();
+        }
+    }
+
+    /**
+     * @brief Wait for the other side to publish a position it claimed.
+     */
+    static void waitForSequence(const Cell& cell, size_t sequence) {
+        for (int spin = 0; cell.sequence.load(std::memory_order_acquire) != sequence; spin++) {
+            if (spin < SPIN_LIMIT) cpuRelax();
+            else std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Push in single producer single consumer mode.
+     */
+    bool tryPushSingle(T& element) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        if (pos - cachedDequeuePos >= static_cast<size_t>(maxSize)) {
+            // Looks full, check where the consumer is
+            cachedDequeuePos = dequeuePos.load(std::memory_order_acquire);
+            if (pos - cachedDequeuePos >= static_cast<size_t>(maxSize)) return false;
+        }
+
+        cells[pos % maxSize].data = std::move(element);
+        enqueuePos.store(pos + 1, std::memory_order_seq_cst);
+        wake(popEpoch, popWaiters, popAsyncWaiters);
+        return true;
+    }
+
+    /**
+     * @brief Pop in single producer single consumer mode.
+     */
+    bool tryPopSingle(T& element) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        if (pos == cachedEnqueuePos) {
+            // Looks empty, check where the producer is
+            cachedEnqueuePos = enqueuePos.load(std::memory_order_acquire);
+            if (pos == cachedEnqueuePos) return false;
+        }
+
+        element = std::move(cells[pos % maxSize].data);
+        dequeuePos.store(pos + 1, std::memory_order_seq_cst);
+        wake(pushEpoch, pushWaiters, pushAsyncWaiters);
+        return true;
+    }
+
+    /**
+     * @brief Spin, then yield, then park, until an attempt succeeds or the deadline passes.
+     *
+     * The thread parks only while blocked, that is, while the other side claimed no position that would
+     * let the attempt succeed. A claimed position that is not published yet is waited for by yielding.
+     *
+     * @return true If the attempt succeeded, false if the deadline passed first.
+     */
+    template <typename Attempt, typename Blocked>
+    static bool waitUntil(Attempt attempt, Blocked blocked, std::atomic<uint32_t>& epoch, std::atomic<int>& waiters,
+                          const Futex::Deadline* deadline = nullptr) {
+        // Spinning only helps when the other side runs on another core
+        static const int spinLimit = std::thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0;
+        for (int spin = 0; spin < spinLimit; spin++) {
+            if (attempt()) return true;
+            cpuRelax();
+        }
+
+        // Let the other side run, which matters when threads outnumber the cores
+        for (int yield = 0; yield < YIELD_LIMIT; yield++) {
+            if (attempt()) return true;
+            std::this_thread::yield();
+        }
+
+        while (true) {
+            uint32_t seen = epoch.load(std::memory_order_acquire);
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+
+            // Check again once registered, as the other side may have moved before it could see us
+            bool park = blocked();
+            bool inTime = true;
+            if (park) {
+                if (deadline == nullptr) Futex::wait(epoch, seen);
+                else inTime = Futex::waitUntil(epoch, seen, *deadline);
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (attempt()) return true;
+            if (!inTime || (deadline != nullptr && std::chrono::steady_clock::now() >= *deadline)) return false;
+            if (!park) std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Awaitable of an operation on the queue, which suspends the coroutine instead of its thread.
+     *
+     * The operation tells whether its attempt is done, whether the queue blocks it, and its result. The
+     * coroutine is registered on its side of the queue only while the queue blocks it, and is resumed on
+     * the executor of its promise, or inline on the waking thread if the promise has none.
+     */
+    template <typename Operation>
+    class Awaiter : public AsyncWaiter {
+    public:
+        Awaiter(Queue& queue, AsyncWaiters& waiters, Operation operation)
+            : queue(queue), waiters(waiters), operation(std::move(operation)) {}
+
+        bool await_ready() {
+            return operation.attempt(queue);
+        }
+
+        template <typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> coroutine) {
+            handle = coroutine;
+            executor = &coroutine.promise().getExecutor();
+            return park();
+        }
+
+        auto await_resume() {
+            return operation.result(queue);
+        }
+
+        void wake() override {
+            auto retry = [this] {
+                if (!park()) handle.resume();
+            };
+            if (*executor) (*executor)(retry);
+            else retry();
+        }
+
+    private:
+        Queue& queue;
+        AsyncWaiters& waiters;
+        Operation operation;
+        std::coroutine_handle<> handle;
+        const std::function<void(std::function<void()>)>* executor = nullptr;
+
+        /**
+         * @brief Register the coroutine while the queue blocks the operation.
+         *
+         * The coroutine may be resumed by another thread as soon as it is registered, so nothing of the
+         * awaiter is touched after that.
+         *
+         * @return true If the coroutine stays suspended, false if the operation is done.
+         */
+        bool park() {
+            while (true) {
+                if (operation.attempt(queue)) return false;
+                {
+                    std::lock_guard<std::mutex> lock(waiters.waitersMutex);
+                    waiters.count.fetch_add(1, std::memory_order_seq_cst);
+
+                    // Check again once counted, as the other side may have moved before it could see us
+                    if (operation.blocked(queue)) {
+                        waiters.waiting.push_back(this);
+                        return true;
+                    }
+                    waiters.count.fetch_sub(1, std::memory_order_relaxed);
+                }
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    struct PushOperation {
+        T element;
+        bool pushed = false;
+
+        bool attempt(Queue& queue) {
+            pushed = queue.tryPush(element);
+            return pushed || queue.isClosed();
+        }
+        bool blocked(Queue& queue) {
+            return queue.size() >= queue.maxSize && !queue.isClosed();
+        }
+        void result(Queue& queue) {
+            if (!pushed) queue.checkOpen();
+        }
+    };
+
+    struct PopOperation {
+        T& element;
+        bool popped = false;
+
+        bool attempt(Queue& queue) {
+            popped = queue.tryPop(element);
+            return popped || queue.drained();
+        }
+        bool blocked(Queue& queue) {
+            return queue.size() == 0 && !queue.isClosed();
+        }
+        bool result(Queue&) {
+            return popped;
+        }
+    };
+
+    struct PushBatchOperation {
+        const std::vector<T>& elements;
+        size_t pushed = 0;
+
+        bool attempt(Queue& queue) {
+            pushed += queue.tryPushBatch(elements.data() + pushed, elements.size() - pushed);
+            return pushed == elements.size() || queue.isClosed();
+        }
+        bool blocked(Queue& queue) {
+            return queue.size() >= queue.maxSize && !queue.isClosed();
+        }
+        void result(Queue& queue) {
+            if (pushed < elements.size()) queue.checkOpen();
+        }
+    };
+
+    struct PopBatchOperation {
+        std::vector<T>& elements;
+        size_t maxItems;
+        bool popped = false;
+
+        bool attempt(Queue& queue) {
+            popped = queue.tryPopBatch(elements, maxItems) > 0;
+            return popped || queue.drained();
+        }
+        bool blocked(Queue& queue) {
+            return queue.size() == 0 && !queue.isClosed();
+        }
+        bool result(Queue&) {
+            return popped;
+        }
+    };
+
+    /**
+     * @brief Checks if the queue is closed and has no element left to pop.
+     */
+    bool drained() {
+        // Read the flag first: the pushes that came before the close are then counted by size
+        return isClosed() && size() == 0;
+    }
+
+    /**
+     * @brief Throws if the queue is closed, for the pushes.
+     */
+    void checkOpen() {
+        if (isClosed()) throw std::runtime_error("Push to a closed queue");
+    }
 
 public:
-    Queue(int size) : emptyQueue(size, size), fullQueue(0, size) {}
+    Queue(int size) : cells(new Cell[size > 0 ? size : 1]), maxSize(size > 0 ? size : 1) {
+        for (int i = 0; i < maxSize; i++) {
+            cells[i].sequence.store(2 * static_cast<size_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    // The cells are shared with the threads that wait on the queue
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+    /**
+     * @brief Registers a producer of the queue.
+     */
+    void addProducer() {
+        producers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Registers a consumer of the queue.
+     */
+    void addConsumer() {
+        consumers.fetch_add(1, std::memory_order_relaxed);
+    }
 
     /**
-     * @brief Pushes an element to the queue.
-     * 
+     * @brief Picks the mode of the queue once its producers and consumers are registered.
+     *
+     * Must be called before the first push, by the thread that then starts the producer and the consumer.
+     * Producers or consumers that are not registered, such as the server threads, keep the queue in the
+     * multiple producer multiple consumer mode.
+     *
+     * @return true If the queue switched to the single producer single consumer mode.
+     * @throws std::runtime_error If the queue was already used.
+     */
+    bool seal() {
+        if (enqueuePos.load() != 0) throw std::runtime_error("Seal of a queue already in use");
+        singleProducerConsumer = producers.load() == 1 && consumers.load() == 1;
+        return singleProducerConsumer;
+    }
+
+    /**
+     * @brief Closes the queue, ending its stream.
+     *
+     * Must be called after the last push. The threads waiting to pop get the elements left and then
+     * return false, and the threads waiting to push throw.
+     */
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        wake(popEpoch, popWaiters, popAsyncWaiters, true);
+        wake(pushEpoch, pushWaiters, pushAsyncWaiters, true);
+    }
+
+    /**
+     * @brief Ends the stream of a registered producer, closing the queue after the last one.
+     */
+    void closeProducer() {
+        if (producers.fetch_sub(1, std::memory_order_acq_rel) <= 1) close();
+    }
+
+    /**
+     * @brief Checks if the queue is closed.
+     *
+     * @return true If the stream of the queue ended.
+     */
+    bool isClosed() const {
+        return closed.load(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Checks if the queue runs in single producer single consumer mode.
+     *
+     * @return true If the queue has a single producer and a single consumer.
+     */
+    bool isSingleProducerConsumer() const {
+        return singleProducerConsumer;
+    }
+
+    /**
+     * @brief Tries to push an element without waiting.
+     *
+     * @param element Element to be pushed. It is moved from only if the push succeeds.
+     * @return true If the element was pushed.
+     * @return false If the queue is full.
+     */
+    bool tryPush(T& element) {
+        if (singleProducerConsumer) return tryPushSingle(element);
+
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos % maxSize];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(2 * pos);
+
+            if (diff == 0) {
+                // The cell is free for this position, claim it
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    cell.data = std::move(element);
+                    cell.sequence.store(2 * pos + 1, std::memory_order_release);
+                    wake(popEpoch, popWaiters, popAsyncWaiters);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The cell still holds the element of the previous lap
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Tries to pop an element without waiting.
+     *
+     * @param element Receives the popped element.
+     * @return true If an element was popped.
+     * @return false If the queue is empty.
+     */
+    bool tryPop(T& element) {
+        if (singleProducerConsumer) return tryPopSingle(element);
+
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos % maxSize];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(2 * pos + 1);
+
+            if (diff == 0) {
+                // The cell holds the element of this position, take it
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    element = std::move(cell.data);
+                    cell.sequence.store(2 * (pos + maxSize), std::memory_order_release);
+                    wake(pushEpoch, pushWaiters, pushAsyncWaiters);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The element of this position was not pushed yet
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Tries to push elements without waiting, reserving their positions at once.
+     *
+     * @param elements The elements to be pushed, in order.
+     * @param count The number of elements.
+     * @return size_t The number of elements pushed, from the first one, which is less than count when
+     * the queue fills up.
+     */
+    size_t tryPushBatch(const T* elements, size_t count) {
+        if (count == 0) return 0;
+
+        size_t pos;
+        size_t reserved;
+        if (singleProducerConsumer) {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+            if (pos - cachedDequeuePos + count > static_cast<size_t>(maxSize)) {
+                cachedDequeuePos = dequeuePos.load(std::memory_order_acquire);
+            }
+            reserved = std::min(count, maxSize - (pos - cachedDequeuePos));
+            if (reserved == 0) return 0;
+
+            for (size_t i = 0; i < reserved; i++) cells[(pos + i) % maxSize].data = elements[i];
+            enqueuePos.store(pos + reserved, std::memory_order_seq_cst);
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                size_t head = dequeuePos.load(std::memory_order_acquire);
+                if (head > pos) {
+                    // Our view of the producers is older than the one of the consumers
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                // Positions popped by the consumers are free, or about to be once their element is read
+                size_t queued = std::min(pos - head, static_cast<size_t>(maxSize));
+                reserved = std::min(count, maxSize - queued);
+                if (reserved == 0) return 0;
+                if (enqueuePos.compare_exchange_weak(pos, pos + reserved, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+            }
+
+            for (size_t i = 0; i < reserved; i++) {
+                Cell& cell = cells[(pos + i) % maxSize];
+                waitForSequence(cell, 2 * (pos + i));
+                cell.data = elements[i];
+                cell.sequence.store(2 * (pos + i) + 1, std::memory_order_release);
+            }
+        }
+
+        wake(popEpoch, popWaiters, popAsyncWaiters, reserved > 1);
+        return reserved;
+    }
+
+    /**
+     * @brief Tries to pop elements without waiting, reserving their positions at once.
+     *
+     * @param elements Receives the popped elements, appended in order.
+     * @param maxItems The maximum number of elements to pop.
+     * @return size_t The number of elements popped.
+     */
+    size_t tryPopBatch(std::vector<T>& elements, size_t maxItems) {
+        if (maxItems == 0) return 0;
+
+        size_t pos;
+        size_t reserved;
+        if (singleProducerConsumer) {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+            if (cachedEnqueuePos - pos < maxItems) cachedEnqueuePos = enqueuePos.load(std::memory_order_acquire);
+            reserved = std::min(maxItems, cachedEnqueuePos - pos);
+            if (reserved == 0) return 0;
+
+            for (size_t i = 0; i < reserved; i++) elements.push_back(std::move(cells[(pos + i) % maxSize].data));
+            dequeuePos.store(pos + reserved, std::memory_order_seq_cst);
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+            while (true) {
+                // Read the producers after the consumers, so they are never behind
+                size_t tail = enqueuePos.load(std::memory_order_acquire);
+                reserved = std::min(maxItems, tail - pos);
+                if (reserved == 0) return 0;
+                if (dequeuePos.compare_exchange_weak(pos, pos + reserved, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+            }
+
+            elements.reserve(elements.size() + reserved);
+            for (size_t i = 0; i < reserved; i++) {
+                // Positions pushed by the producers are full, or about to be once their element is written
+                Cell& cell = cells[(pos + i) % maxSize];
+                waitForSequence(cell, 2 * (pos + i) + 1);
+                elements.push_back(std::move(cell.data));
+                cell.sequence.store(2 * (pos + i + maxSize), std::memory_order_release);
+            }
+        }
+
+        wake(pushEpoch, pushWaiters, pushAsyncWaiters, reserved > 1);
+        return reserved;
+    }
+
+    /**
+     * @brief Pushes elements to the queue, waiting while it is full.
+     *
+     * The elements are pushed in order, in as few reservations as the free space allows.
+     *
+     * @param elements Elements to be pushed.
+     */
+    void pushBatch(const std::vector<T>& elements) {
+        checkOpen();
+        size_t pushed = tryPushBatch(elements.data(), elements.size());
+        if (pushed == elements.size()) return;
+
+        waitUntil([this, &elements, &pushed] {
+                      pushed += tryPushBatch(elements.data() + pushed, elements.size() - pushed);
+                      return pushed == elements.size() || isClosed();
+                  },
+                  [this] { return size() >= maxSize && !isClosed(); }, pushEpoch, pushWaiters);
+        if (pushed < elements.size()) checkOpen();
+    }
+
+    /**
+     * @brief Pops the elements waiting in the queue, waiting while it is empty and open.
+     *
+     * @param elements Receives the popped elements, appended in order.
+     * @param maxItems The maximum number of elements to pop.
+     * @return true If elements were popped.
+     * @return false If the queue is closed and drained.
+     */
+    bool popBatch(std::vector<T>& elements, size_t maxItems) {
+        if (tryPopBatch(elements, maxItems) > 0) return true;
+
+        bool popped = false;
+        waitUntil([this, &elements, maxItems, &popped] {
+                      popped = tryPopBatch(elements, maxItems) > 0;
+                      return popped || drained();
+                  },
+                  [this] { return size() == 0 && !isClosed(); }, popEpoch, popWaiters);
+        return popped;
+    }
+
+    /**
+     * @brief Pops the elements waiting in the queue, waiting up to a timeout for the first one.
+     *
+     * @param maxItems The maximum number of elements to pop.
+     * @param timeout The longest time to wait while the queue is empty.
+     * @return std::vector<T> The popped elements, empty if the timeout passed first or the queue is
+     * closed and drained.
+     */
+    std::vector<T> popBatch(size_t maxItems, std::chrono::milliseconds timeout) {
+        std::vector<T> elements;
+        if (tryPopBatch(elements, maxItems) > 0) return elements;
+
+        Futex::Deadline deadline = std::chrono::steady_clock::now() + timeout;
+        waitUntil([this, &elements, maxItems] { return tryPopBatch(elements, maxItems) > 0 || drained(); },
+                  [this] { return size() == 0 && !isClosed(); }, popEpoch, popWaiters, &deadline);
+        return elements;
+    }
+
+    /**
+     * @brief Pops all the elements waiting in the queue, without waiting.
+     *
+     * @param elements Receives the popped elements, appended in order.
+     * @return size_t The number of elements popped.
+     */
+    size_t drainTo(std::vector<T>& elements) {
+        return tryPopBatch(elements, maxSize);
+    }
+
+    /**
+     * @brief Pushes an element to the queue, waiting while it is full.
+     *
      * @param element Element to be pushed.
+     * @throws std::runtime_error If the queue is closed.
      */
     void push(T element) {
-        emptyQueue.wait();
-        mutex.lock();
-        queue.push(element);
-        mutex.unlock();
-        fullQueue.notify();
+        checkOpen();
+        bool pushed = false;
+        waitUntil([this, &element, &pushed] {
+                      pushed = tryPush(element);
+                      return pushed || isClosed();
+                  },
+                  [this] { return size() >= maxSize && !isClosed(); }, pushEpoch, pushWaiters);
+        if (!pushed) checkOpen();
     }
 
     /**
-     * @brief Pops an element from the queue.
-     * 
+     * @brief Pops an element from the queue, waiting while it is empty and open.
+     *
+     * @param element Receives the popped element.
+     * @return true If an element was popped.
+     * @return false If the queue is closed and drained.
+     */
+    bool pop(T& element) {
+        bool popped = false;
+        waitUntil([this, &element, &popped] {
+                      popped = tryPop(element);
+                      return popped || drained();
+                  },
+                  [this] { return size() == 0 && !isClosed(); }, popEpoch, popWaiters);
+        return popped;
+    }
+
+    /**
+     * @brief Pushes an element to the queue, waiting up to a timeout while it is full.
+     *
+     * @param element Element to be pushed. It is moved from only if the push succeeds.
+     * @param timeout The longest time to wait while the queue is full.
+     * @return true If the element was pushed.
+     * @return false If the timeout passed first.
+     * @throws std::runtime_error If the queue is closed.
+     */
+    bool tryPushFor(T& element, std::chrono::milliseconds timeout) {
+        checkOpen();
+        if (tryPush(element)) return true;
+
+        bool pushed = false;
+        Futex::Deadline deadline = std::chrono::steady_clock::now() + timeout;
+        waitUntil([this, &element, &pushed] {
+                      pushed = tryPush(element);
+                      return pushed || isClosed();
+                  },
+                  [this] { return size() >= maxSize && !isClosed(); }, pushEpoch, pushWaiters, &deadline);
+        if (!pushed) checkOpen();
+        return pushed;
+    }
+
+    /**
+     * @brief Pops an element from the queue, waiting up to a timeout while it is empty and open.
+     *
+     * @param element Receives the popped element.
+     * @param timeout The longest time to wait while the queue is empty.
+     * @return true If an element was popped.
+     * @return false If the timeout passed first, or the queue is closed and drained.
+     */
+    bool tryPopFor(T& element, std::chrono::milliseconds timeout) {
+        if (tryPop(element)) return true;
+
+        bool popped = false;
+        Futex::Deadline deadline = std::chrono::steady_clock::now() + timeout;
+        waitUntil([this, &element, &popped] {
+                      popped = tryPop(element);
+                      return popped || drained();
+                  },
+                  [this] { return size() == 0 && !isClosed(); }, popEpoch, popWaiters, &deadline);
+        return popped;
+    }
+
+    /**
+     * @brief Pops an element from the queue, waiting while it is empty.
+     *
      * @return T Popped element.
+     * @throws std::runtime_error If the queue is closed and drained.
      */
     T pop() {
-        fullQueue.wait();
-        std::lock_guard<std::mutex> guard(mutex);
-        if (queue.empty()) {
-            throw std::runtime_error("Pop from empty queue");
-        }
-        T element = queue.front();
-        queue.pop();
-        emptyQueue.notify();
+        T element{};
+        if (!pop(element)) throw std::runtime_error("Pop from a closed queue");
         return element;
+    }
+
+    /**
+     * @brief Pushes an element from a coroutine, suspending it while the queue is full.
+     *
+     * The awaiting coroutine must have a promise with an executor, such as Coroutine.
+     *
+     * @param element Element to be pushed.
+     * @return The awaitable of the push, which throws std::runtime_error if the queue is closed.
+     */
+    Awaiter<PushOperation> pushAsync(T element) {
+        return Awaiter<PushOperation>(*this, pushAsyncWaiters, PushOperation{std::move(element)});
+    }
+
+    /**
+     * @brief Pops an element from a coroutine, suspending it while the queue is empty and open.
+     *
+     * @param element Receives the popped element.
+     * @return The awaitable of the pop, which gives true if an element was popped and false if the queue
+     * is closed and drained.
+     */
+    Awaiter<PopOperation> popAsync(T& element) {
+        return Awaiter<PopOperation>(*this, popAsyncWaiters, PopOperation{element});
+    }
 
+    /**
+     * @brief Pushes elements from a coroutine, suspending it while the queue is full.
+     *
+     * @param elements Elements to be pushed, which must live until the push is done.
+     * @return The awaitable of the push, which throws std::runtime_error if the queue is closed.
+     */
+    Awaiter<PushBatchOperation> pushBatchAsync(const std::vector<T>& elements) {
+        return Awaiter<PushBatchOperation>(*this, pushAsyncWaiters, PushBatchOperation{elements});
+    }
+
+    /**
+     * @brief Pops the elements waiting in the queue from a coroutine, suspending it while the queue is
+     * empty and open.
+     *
+     * @param elements Receives the popped elements, appended in order.
+     * @param maxItems The maximum number of elements to pop.
+     * @return The awaitable of the pop, which gives true if elements were popped and false if the queue
+     * is closed and drained.
+     */
+    Awaiter<PopBatchOperation> popBatchAsync(std::vector<T>& elements, size_t maxItems) {
+        return Awaiter<PopBatchOperation>(*this, popAsyncWaiters, PopBatchOperation{elements, maxItems});
     }
 
     /**
      * @brief Checks if the queue is empty.
-     * 
+     *
      * @return true If the queue is empty.
      * @return false If the queue is not empty.
      */
     bool isEmpty() {
-        return queue.empty();
+        return size() == 0;
     }
 
     /**
      * @brief Returns the size of the queue.
-     * 
+     *
+     * The size is a snapshot: elements being pushed count as queued, elements being popped do not.
+     *
      * @return int Size of the queue.
      */
     int size() {
-        return queue.size();
+        // Read the consumers first, as the producers are always ahead of them
+        size_t head = dequeuePos.load(std::memory_order_seq_cst);
+        size_t tail = enqueuePos.load(std::memory_order_seq_cst);
+        size_t queued = tail - head;
+        return queued > static_cast<size_t>(maxSize) ? maxSize : static_cast<int>(queued);
+    }
+
+    /**
+     * @brief Returns the maximum number of elements of the queue.
+     *
+     * @return int Capacity of the queue.
+     */
+    int capacity() const {
+        return maxSize;
     }
 
     /**
      * @brief Prints the queue.
+     *
+     * Meant for debugging: the elements are read without synchronizing with concurrent pops.
      */
     void print() {
-        std::queue<T> temp = queue;
-        while (!temp.empty()) {
-            std::cout << temp.front() << " ";
-            temp.pop();
+        size_t head = dequeuePos.load(std::memory_order_acquire);
+        size_t tail = enqueuePos.load(std::memory_order_acquire);
+        for (size_t pos = head; pos != tail; pos++) {
+            std::cout << cells[pos % maxSize].data << " ";
         }
         std::cout << std::endl;
     }
@@ -3,7 +3,6 @@
 
 #include <iostream>
 #include <chrono>
-#include <thread>
 #include <random>
 #include "AbstractTrigger.hpp"
 using namespace std;
@@ -18,7 +17,19 @@ class RequestTrigger : public Trigger {
 private:
     std::chrono::milliseconds minInterval;
     std::chrono::milliseconds maxInterval;
-    bool active;
+
+protected:
+    std::chrono::milliseconds getFirstDelay() override {
+        return getRandomInterval();
+    }
+
+    std::chrono::milliseconds getNextInterval() override {
+        return getRandomInterval();
+    }
+
+    void notify(Observer& observer) override {
+        observer.updateOnRequestTrigger();
+    }
 
 public:
     /**
@@ -26,35 +37,19 @@ public:
      * 
      * @param minInterval The minimum interval between activations.
      * @param maxInterval The maximum interval between activations.
+     * @param wheel The wheel that schedules the activations.
      */
-    RequestTrigger(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval)
-        : minInterval(minInterval), maxInterval(maxInterval), active(false) {}
-
-    // Overriding activate method
-    void activate() override {
-        active = true;
-        std::thread([this]() {
-            while (active) {
-                std::chrono::milliseconds interval = getRandomInterval();
-                std::this_thread::sleep_for(interval);
-                // Notify all observers
-                for (auto observer : observers) {
-                    observer->updateOnRequestTrigger();
-                }
-            }
-        }).detach();
-    }
+    RequestTrigger(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval, TimerWheel& wheel = TimerWheel::shared())
+        : Trigger(wheel), minInterval(minInterval), maxInterval(maxInterval) {}
 
-    // Overriding deactivate method
-    void deactivate() override {
-        active = false;
+    ~RequestTrigger() {
+        deactivate();
     }
 
 private:
     // Method to generate random interval
     std::chrono::milliseconds getRandomInterval() {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
+        static thread_local std::mt19937 gen(std::random_device{}());
         std::uniform_int_distribution<> distrib(minInterval.count(), maxInterval.count());
         return std::chrono::milliseconds(distrib(gen));
     }
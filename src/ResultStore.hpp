@@ -0,0 +1,320 @@
+#ifndef RESULT_STORE_HPP
+#define RESULT_STORE_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "DataFrame.hpp"
+
+using namespace std;
+
+/**
+ * @brief A query on a result of the ResultStore.
+ */
+struct ResultQuery {
+    size_t topK = 0; /**< The number of values to return, ranked by count (0 for all). */
+    long long fromMs = 0; /**< The start of the time range, in ms since the epoch (0 for no start). */
+    long long toMs = 0; /**< The end of the time range, in ms since the epoch (0 for no end). */
+};
+
+/**
+ * @brief Summary of the latencies of a result, in ms.
+ */
+struct LatencySummary {
+    size_t samples = 0; /**< The number of latencies. */
+    double mean = 0.0; /**< The mean latency. */
+    long long p50 = 0; /**< The median latency. */
+    long long p90 = 0; /**< The 90th percentile. */
+    long long p99 = 0; /**< The 99th percentile. */
+    long long max = 0; /**< The highest latency. */
+};
+
+/**
+ * @brief The aggregates of a result over the windows that match a query.
+ */
+struct ResultSnapshot {
+    vector<string> values; /**< The values, by descending count. */
+    vector<long long> counts; /**< The count of each value. */
+    long long total = 0; /**< The sum of the counts of all the values, not only of the top K. */
+    LatencySummary latency; /**< The summary of the "time" column, for the latency results. */
+    size_t windows = 0; /**< The number of windows aggregated, including the live one. */
+};
+
+/**
+ * @brief Class for answering queries on the results of the pipeline from memory.
+ *
+ * The ResultStore reads the live result DataFrames of the pipeline under their own mutexes, so a query
+ * sees a consistent state of each result without waiting for the files to be written. When a trigger
+ * closes a window, the DataRepo archives the aggregates of the window, and the store keeps the last
+ * windows of each result to answer queries over a time range.
+ *
+ * A result is aggregated according to its columns: "Value" and "Count" are counts by value, a single
+ * "Count" is a total and "time" holds latencies.
+ */
+class ResultStore {
+private:
+    /**
+     * @brief The aggregates of one window of a result.
+     */
+    struct Aggregate {
+        long long openedAt = 0; /**< The start of the window, in ms since the epoch. */
+        long long closedAt = 0; /**< The end of the window, in ms since the epoch. */
+        map<string, long long> counts; /**< The counts by value. */
+        long long total = 0; /**< The sum of the counts. */
+        vector<long long> latencies; /**< The latencies, in ms. */
+
+        void merge(const Aggregate& other) {
+            for (const auto& [value, count] : other.counts) counts[value] += count;
+            total += other.total;
+            latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        }
+    };
+
+    /**
+     * @brief A result registered in the store.
+     */
+    struct Result {
+        DataFrame** live = nullptr; /**< The live DataFrame of the pipeline. */
+        mutex* liveMutex = nullptr; /**< The mutex of the live DataFrame. */
+        long long liveSince = 0; /**< The start of the live window. */
+        deque<Aggregate> history; /**< The last windows, oldest first. */
+    };
+
+    size_t maxWindows; /**< The number of windows kept for each result. */
+    map<string, Result> results; /**< The results by name. */
+    mutable shared_mutex storeMutex; /**< The mutex for the results and their history. */
+
+    static long long nowMs() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Read a numeric value of a column as a long long.
+     */
+    static long long numberAt(const ISeries& column, size_t index) {
+        any value = column.getDataAtIndex(index);
+        if (auto* i = any_cast<int>(&value)) return *i;
+        if (auto* l = any_cast<long long>(&value)) return *l;
+        if (auto* f = any_cast<float>(&value)) return static_cast<long long>(*f);
+        if (auto* d = any_cast<double>(&value)) return static_cast<long long>(*d);
+        throw runtime_error("Result column is not numeric");
+    }
+
+    /**
+     * @brief Aggregate the rows of a result DataFrame.
+     */
+    static Aggregate aggregate(const DataFrame& df) {
+        Aggregate result;
+        size_t rows = df.getRowCount();
+
+        if (df.hasColumn("Count")) {
+            auto counts = df.getColumnPtr("Count");
+            auto values = df.hasColumn("Value") ? df.getColumnPtr("Value") : nullptr;
+            for (size_t i = 0; i < rows; i++) {
+                long long count = numberAt(*counts, i);
+                if (values) result.counts[values->getStringAtIndex(i)] += count;
+                result.total += count;
+            }
+        }
+
+        if (df.hasColumn("time")) {
+            auto times = df.getColumnPtr("time");
+            result.latencies.reserve(rows);
+            for (size_t i = 0; i < rows; i++) result.latencies.push_back(numberAt(*times, i));
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Summarize latencies. The latencies are reordered.
+     */
+    static LatencySummary summarize(vector<long long>& latencies) {
+        LatencySummary summary;
+        summary.samples = latencies.size();
+        if (latencies.empty()) return summary;
+
+        long long sum = 0;
+        for (long long latency : latencies) sum += latency;
+        summary.mean = static_cast<double>(sum) / latencies.size();
+
+        // Nearest rank percentiles, each found in linear time
+        auto percentile = [&latencies](double p) {
+            size_t rank = min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+            nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            return latencies[rank];
+        };
+        summary.p50 = percentile(0.50);
+        summary.p90 = percentile(0.90);
+        summary.p99 = percentile(0.99);
+        summary.max = *max_element(latencies.begin(), latencies.end());
+        return summary;
+    }
+
+    /**
+     * @brief Add a closed window to the history of a result. Must be called with the store lock held.
+     */
+    void addWindow(Result& result, Aggregate closed, long long closedAt) {
+        closed.openedAt = result.liveSince;
+        closed.closedAt = closedAt;
+        result.liveSince = closedAt;
+
+        result.history.push_back(std::move(closed));
+        if (result.history.size() > maxWindows) result.history.pop_front();
+    }
+
+    static bool overlaps(long long openedAt, long long closedAt, const ResultQuery& query) {
+        return (query.fromMs == 0 || closedAt >= query.fromMs) && (query.toMs == 0 || openedAt <= query.toMs);
+    }
+
+public:
+    /**
+     * @brief Construct a new ResultStore object.
+     *
+     * @param maxWindows The number of closed windows kept for each result.
+     */
+    ResultStore(size_t maxWindows = 120) : maxWindows(maxWindows) {}
+
+    /**
+     * @brief Register a live result of the pipeline.
+     *
+     * @param name The name of the result.
+     * @param live The pointer to the live DataFrame, which the pipeline replaces while merging.
+     * @param liveMutex The mutex that guards the live DataFrame.
+     */
+    void addResult(const string& name, DataFrame** live, mutex* liveMutex) {
+        unique_lock<shared_mutex> lock(storeMutex);
+        Result& result = results[name];
+        result.live = live;
+        result.liveMutex = liveMutex;
+        result.liveSince = nowMs();
+    }
+
+    /**
+     * @brief Stop reading the live DataFrame of a result, before the pipeline that owns it returns.
+     *
+     * The closed windows of the result can still be queried.
+     *
+     * @param name The name of the result.
+     */
+    void detachLive(const string& name) {
+        unique_lock<shared_mutex> lock(storeMutex);
+        auto it = results.find(name);
+        if (it == results.end()) return;
+        it->second.live = nullptr;
+        it->second.liveMutex = nullptr;
+    }
+
+    /**
+     * @brief Archive the window that a trigger just closed.
+     *
+     * @param name The name of the result.
+     * @param window The DataFrame taken from the pipeline at the end of the window.
+     */
+    void archive(const string& name, const DataFrame& window) {
+        Aggregate closed = aggregate(window);
+
+        unique_lock<shared_mutex> lock(storeMutex);
+        addWindow(results[name], std::move(closed), nowMs());
+    }
+
+    /**
+     * @brief Take the live DataFrame of a window that a trigger closes, and archive it in the same step.
+     *
+     * The store lock is taken before the live mutex, as in query, so a query sees the window either live
+     * or archived, and the window closes at the time it is taken.
+     *
+     * @param name The name of the result.
+     * @param live The pointer to the live DataFrame, reset so the merges start a new window.
+     * @param liveMutex The mutex that guards the live DataFrame.
+     * @return The DataFrame of the window, owned by the caller, or nullptr if the window is empty.
+     */
+    DataFrame* closeWindow(const string& name, DataFrame** live, mutex* liveMutex) {
+        unique_lock<shared_mutex> lock(storeMutex);
+        DataFrame* window;
+        long long closedAt;
+        {
+            lock_guard<mutex> liveLock(*liveMutex);
+            window = *live;
+            *live = nullptr;
+            closedAt = nowMs();
+        }
+        if (window == nullptr) return nullptr;
+
+        // The merges go on meanwhile, while the queries wait for the window
+        addWindow(results[name], aggregate(*window), closedAt);
+        return window;
+    }
+
+    /**
+     * @brief Aggregate a result over the windows that overlap the time range of a query.
+     *
+     * @param name The name of the result.
+     * @param query The top K and time range of the query.
+     * @return The aggregates of the result.
+     * @throws runtime_error If the result is not registered.
+     */
+    ResultSnapshot query(const string& name, const ResultQuery& query) const {
+        Aggregate total;
+        size_t windows = 0;
+        {
+            shared_lock<shared_mutex> lock(storeMutex);
+            auto it = results.find(name);
+            if (it == results.end()) throw runtime_error("Unknown result: " + name);
+            const Result& result = it->second;
+
+            for (const Aggregate& window : result.history) {
+                if (!overlaps(window.openedAt, window.closedAt, query)) continue;
+                total.merge(window);
+                windows++;
+            }
+
+            // The live window is read under the mutex of the pipeline, so it is never seen mid-merge
+            if (result.live != nullptr && overlaps(result.liveSince, nowMs(), query)) {
+                lock_guard<mutex> liveLock(*result.liveMutex);
+                if (*result.live != nullptr) total.merge(aggregate(**result.live));
+                windows++;
+            }
+        }
+
+        ResultSnapshot snapshot;
+        snapshot.windows = windows;
+        snapshot.total = total.total;
+        snapshot.latency = summarize(total.latencies);
+
+        // Rank the values by count, keeping only the top K
+        vector<pair<string, long long>> ranking(total.counts.begin(), total.counts.end());
+        size_t keep = query.topK == 0 ? ranking.size() : min(query.topK, ranking.size());
+        auto byCount = [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); };
+        partial_sort(ranking.begin(), ranking.begin() + keep, ranking.end(), byCount);
+
+        snapshot.values.reserve(keep);
+        snapshot.counts.reserve(keep);
+        for (size_t i = 0; i < keep; i++) {
+            snapshot.values.push_back(std::move(ranking[i].first));
+            snapshot.counts.push_back(ranking[i].second);
+        }
+        return snapshot;
+    }
+
+    /**
+     * @brief Get the names of the registered results.
+     *
+     * @return The names of the results.
+     */
+    vector<string> getResultNames() const {
+        shared_lock<shared_mutex> lock(storeMutex);
+        vector<string> names;
+        for (const auto& [name, result] : results) names.push_back(name);
+        return names;
+    }
+};
+
+#endif // RESULT_STORE_HPP
@@ -1,53 +1,130 @@
 # ifndef SEMAPHORE_HPP
 # define SEMAPHORE_HPP
 
-#include <iostream>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+#include "Futex.hpp"
 
 /**
  * @brief Class for handling a semaphore.
+ *
+ * The count lives in an atomic word: acquiring a free permit is a single compare-and-swap and releasing
+ * is a single addition, and the futex system call is only made when a thread has to sleep on an empty
+ * semaphore, or when one sleeps while permits are released. Releasing never blocks.
  */
-
 class Semaphore {
 private:
-    int count;
-    int max_count;
-    std::mutex mutex;
-    std::condition_variable condition;
+    std::atomic<uint32_t> count; /**< The free permits, which is also the futex word of the sleeping threads. */
+    std::atomic<int> waiters{0}; /**< The number of threads sleeping on the semaphore. */
+    uint32_t max_count;
 
 public:
     /**
      * @brief Construct a new Semaphore object.
-     * 
+     *
      * @param count The initial count of the semaphore.
+     * @param max_count The maximum count of the semaphore, raised to the initial count if it is lower.
      */
-    Semaphore(int count = 0, int max_count = 1) : count(count), max_count(max_count) {}
+    Semaphore(int count = 0, int max_count = 1)
+        : count(static_cast<uint32_t>(std::max(count, 0))), max_count(static_cast<uint32_t>(std::max({count, max_count, 1}))) {}
+
+    // The count is shared with the threads that sleep on it
+    Semaphore(const Semaphore&) = delete;
+    Semaphore& operator=(const Semaphore&) = delete;
 
     virtual ~Semaphore() = default;
 
+    /**
+     * @brief Try to take a permit without waiting.
+     *
+     * @return true If a permit was taken.
+     * @return false If the semaphore has no free permit.
+     */
+    bool tryAcquire() {
+        uint32_t current = count.load(std::memory_order_relaxed);
+        while (current > 0) {
+            if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Take a permit, waiting while the semaphore has none.
+     */
+    void acquire() {
+        while (!tryAcquire()) {
+            // The kernel checks the count again before the thread sleeps, so a release cannot be missed
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            Futex::wait(count, 0);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Take a permit, waiting up to a timeout while the semaphore has none.
+     *
+     * @param timeout The longest time to wait.
+     * @return true If a permit was taken.
+     * @return false If the timeout passed first.
+     */
+    bool tryAcquireFor(std::chrono::milliseconds timeout) {
+        if (tryAcquire()) return true;
+
+        Futex::Deadline deadline = std::chrono::steady_clock::now() + timeout;
+        while (true) {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool inTime = Futex::waitUntil(count, 0, deadline);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (tryAcquire()) return true;
+            if (!inTime || std::chrono::steady_clock::now() >= deadline) return false;
+        }
+    }
+
+    /**
+     * @brief Give back permits, waking as many sleeping threads.
+     *
+     * @param permits The number of permits to give back.
+     * @throws std::runtime_error If the count would go above its maximum.
+     */
+    void release(int permits = 1) {
+        if (permits <= 0) return;
+
+        uint32_t current = count.load(std::memory_order_relaxed);
+        do {
+            if (current + permits > max_count) throw std::runtime_error("Semaphore released above its maximum count");
+        } while (!count.compare_exchange_weak(current, current + permits, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+        // Either a sleeping thread registered before the release and is seen here, or it sees the permits
+        if (waiters.load(std::memory_order_seq_cst) > 0) Futex::wake(count, permits);
+    }
+
+    /**
+     * @brief Get the number of free permits, which may be stale by the time it is used.
+     *
+     * @return The count of the semaphore.
+     */
+    int getCount() const {
+        return static_cast<int>(count.load(std::memory_order_relaxed));
+    }
+
     /**
      * @brief Wait for the semaphore.
      */
     void wait() {
-        std::unique_lock<std::mutex> lock(mutex);
-        while (count == 0) {
-            condition.wait(lock);
-        }
-        count--;
+        acquire();
     }
 
     /**
      * @brief Notify the semaphore.
      */
     void notify() {
-        std::unique_lock<std::mutex> lock(mutex);
-        while (count == max_count) {
-            condition.wait(lock);
-        }
-        count++;
-        condition.notify_one();
+        release();
     }
 };
 
-# endif // SEMAPHORE_HPP
\ No newline at end of file
+# endif // SEMAPHORE_HPP
@@ -11,6 +11,8 @@
 #include <typeinfo>
 #include <vector>
 #include <numeric>
+#include <limits>
+#include <cmath>
 #include <unordered_set>
 
 using namespace std;
@@ -44,6 +46,145 @@ string convertToString(const T& value) {
 }
 
 
+/**
+ * @brief Adds up a range of values.
+ * 
+ * The values are added into several independent accumulators, which the compiler can keep in vector
+ * registers. When the accumulator is a floating-point type, the range is split in halves down to small
+ * blocks and the halves are added pairwise, so the rounding error grows with the logarithm of the number
+ * of values instead of with the number itself.
+ * 
+ * @tparam Accumulator The type the values are added in.
+ * @tparam Iterator The iterator of the values.
+ * @param first The first value.
+ * @param count The number of values.
+ * @return The sum of the values.
+ */
+template<typename Accumulator, typename Iterator>
+Accumulator sumValues(Iterator first, size_t count) {
+    constexpr size_t LANES = 8; // Independent accumulators, one vector register of floats on AVX
+    constexpr size_t BLOCK = 256; // Values added one lane after the other before the pairwise split
+
+    if constexpr (is_floating_point_v<Accumulator>) {
+        if (count > BLOCK) {
+            size_t half = (count / 2) / LANES * LANES;
+            return sumValues<Accumulator>(first, half) + sumValues<Accumulator>(first + half, count - half);
+        }
+    }
+
+    Accumulator lanes[LANES] = {};
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        for (size_t lane = 0; lane < LANES; lane++) lanes[lane] += static_cast<Accumulator>(first[i + lane]);
+    }
+
+    Accumulator total = Accumulator(0);
+    for (size_t lane = 0; lane < LANES; lane++) total += lanes[lane];
+    for (; i < count; i++) total += static_cast<Accumulator>(first[i]);
+    return total;
+}
+
+/**
+ * @brief Summary statistics of numeric values, computed in a single pass.
+ * 
+ * The sum is compensated (Kahan-Babuska), and the variance is updated with the method of Welford, so
+ * neither loses precision over many values. Statistics of separate ranges can be merged, which lets each
+ * range be computed by a thread of its own.
+ */
+struct SeriesStats {
+    size_t count = 0; /**< The number of values. */
+    double sum = 0.0; /**< The sum of the values. */
+    double compensation = 0.0; /**< The low-order bits lost by the sum. */
+    double mean = 0.0; /**< The mean of the values. */
+    double m2 = 0.0; /**< The sum of the squared deviations from the mean. */
+    double min = numeric_limits<double>::infinity(); /**< The smallest value. */
+    double max = -numeric_limits<double>::infinity(); /**< The largest value. */
+
+    /**
+     * @brief Add a value to the statistics.
+     * 
+     * @param value The value to be added.
+     */
+    void add(double value) {
+        count++;
+
+        double total = sum + value;
+        if (fabs(sum) >= fabs(value)) compensation += (sum - total) + value;
+        else compensation += (value - total) + sum;
+        sum = total;
+
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+
+    /**
+     * @brief Merge the statistics of another range of values.
+     * 
+     * @param other The statistics of the other range.
+     */
+    void merge(const SeriesStats& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+
+        size_t total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count / total * other.count;
+        count = total;
+
+        double merged = sum + other.sum;
+        if (fabs(sum) >= fabs(other.sum)) compensation += (sum - merged) + other.sum;
+        else compensation += (other.sum - merged) + sum;
+        sum = merged;
+        compensation += other.compensation;
+
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    /**
+     * @brief Get the compensated sum of the values.
+     */
+    double getSum() const {
+        return sum + compensation;
+    }
+
+    /**
+     * @brief Get the mean of the values, NaN if there is none.
+     */
+    double getMean() const {
+        return count > 0 ? mean : numeric_limits<double>::quiet_NaN();
+    }
+
+    /**
+     * @brief Get the smallest value, NaN if there is none.
+     */
+    double getMin() const {
+        return count > 0 ? min : numeric_limits<double>::quiet_NaN();
+    }
+
+    /**
+     * @brief Get the largest value, NaN if there is none.
+     */
+    double getMax() const {
+        return count > 0 ? max : numeric_limits<double>::quiet_NaN();
+    }
+
+    /**
+     * @brief Get the sample variance of the values, NaN if there are fewer than two.
+     */
+    double getVariance() const {
+        return count > 1 ? m2 / (count - 1) : numeric_limits<double>::quiet_NaN();
+    }
+};
+
 // Interface for Series
 /**
  * @brief Interface for a series data structure.
@@ -131,6 +272,48 @@ public:
      */
     virtual double mean() const = 0;
 
+    /**
+     * @brief Computes the sum of the elements in a range of the series.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The sum of the elements in the range, of the type of the series.
+     */
+    virtual any sum(size_t begin, size_t end) const = 0;
+
+    /**
+     * @brief Computes the mean of the elements in a range of the series.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The mean of the elements in the range.
+     */
+    virtual double mean(size_t begin, size_t end) const = 0;
+
+    /**
+     * @brief Checks whether the elements of the series are numbers.
+     * 
+     * @return True if the series supports sum, mean and describe, false otherwise.
+     */
+    virtual bool isNumeric() const = 0;
+
+    /**
+     * @brief Computes the count, sum, mean, min, max and variance of a range of the series in one pass.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The statistics of the elements in the range.
+     */
+    virtual SeriesStats describe(size_t begin, size_t end) const = 0;
+
+    /**
+     * @brief Creates a series with the values at some indexes of this one.
+     * 
+     * @param indices The indexes of the values, in the order of the new series.
+     * @return A shared pointer to the new series, with the name and the type of this one.
+     */
+    virtual shared_ptr<ISeries> take(const vector<size_t>& indices) const = 0;
+
     /**
      * @brief Prints the series.
      */
@@ -144,6 +327,13 @@ public:
      */
     virtual void addFromSeries(const ISeries* other, size_t index) = 0;
 
+    /**
+     * @brief Appends all the values of another series.
+     * 
+     * @param other The series whose values are to be appended.
+     */
+    virtual void append(const ISeries* other) = 0;
+
     /**
      * @brief Clones the series.
      * 
@@ -166,6 +356,15 @@ private:
     vector<T> data; /**< The vector storing the data of type T. */
     string name; /**< The name of the series. */
 
+    /**
+     * @brief Checks that a range of indexes lies in the series.
+     */
+    void checkRange(size_t begin, size_t end) const {
+        if (begin > end || end > data.size()) {
+            throw out_of_range("Range out of the series");
+        }
+    }
+
 public:
     /**
      * @brief Constructs a new Series object with the given name.
@@ -174,6 +373,14 @@ public:
      */
     Series(const string& name) : name(name) {}
 
+    /**
+     * @brief Constructs a new Series object with the given name and data.
+     * 
+     * @param name The name of the series.
+     * @param data The data of the series, moved into the series.
+     */
+    Series(const string& name, vector<T>&& data) : data(std::move(data)), name(name) {}
+
     /**
      * @brief Destructor for the Series class.
      */
@@ -342,7 +549,7 @@ public:
      */
     any sum() const override {
         if constexpr (is_arithmetic<T>::value) {
-            return accumulate(data.begin(), data.end(), T(0));
+            return sumValues<T>(data.begin(), data.size());
         } else {
             throw runtime_error("Sum operation not supported for non-arithmetic types.");
         }
@@ -357,12 +564,91 @@ public:
      */
     double mean() const override {
         if constexpr (is_arithmetic<T>::value) {
-            return accumulate(data.begin(), data.end(), 0.0) / data.size();
+            return sumValues<double>(data.begin(), data.size()) / data.size();
+        } else {
+            throw runtime_error("Mean operation not supported for non-arithmetic types.");
+        }
+    }
+
+    /**
+     * @brief Computes the sum of the elements in a range of the series.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The sum of the elements in the range.
+     * @throws out_of_range if the range is out of the series.
+     */
+    any sum(size_t begin, size_t end) const override {
+        if constexpr (is_arithmetic<T>::value) {
+            checkRange(begin, end);
+            return sumValues<T>(data.begin() + begin, end - begin);
+        } else {
+            throw runtime_error("Sum operation not supported for non-arithmetic types.");
+        }
+    }
+
+    /**
+     * @brief Computes the mean of the elements in a range of the series.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The mean of the elements in the range.
+     * @throws out_of_range if the range is out of the series.
+     */
+    double mean(size_t begin, size_t end) const override {
+        if constexpr (is_arithmetic<T>::value) {
+            checkRange(begin, end);
+            return sumValues<double>(data.begin() + begin, end - begin) / (end - begin);
         } else {
             throw runtime_error("Mean operation not supported for non-arithmetic types.");
         }
     }
 
+    /**
+     * @brief Checks whether the elements of the series are numbers.
+     * 
+     * @return True if the type of the series is arithmetic.
+     */
+    bool isNumeric() const override {
+        return is_arithmetic<T>::value;
+    }
+
+    /**
+     * @brief Computes the count, sum, mean, min, max and variance of a range of the series in one pass.
+     * 
+     * @param begin The index of the first element.
+     * @param end The index past the last element.
+     * @return The statistics of the elements in the range.
+     * @throws out_of_range if the range is out of the series.
+     */
+    SeriesStats describe(size_t begin, size_t end) const override {
+        if constexpr (is_arithmetic<T>::value) {
+            checkRange(begin, end);
+            SeriesStats stats;
+            for (size_t i = begin; i < end; i++) stats.add(static_cast<double>(data[i]));
+            return stats;
+        } else {
+            throw runtime_error("Describe operation not supported for non-arithmetic types.");
+        }
+    }
+
+    /**
+     * @brief Creates a series with the values at some indexes of this one.
+     * 
+     * @param indices The indexes of the values, in the order of the new series.
+     * @return A shared pointer to the new series.
+     * @throws out_of_range if an index is out of range.
+     */
+    shared_ptr<ISeries> take(const vector<size_t>& indices) const override {
+        vector<T> values;
+        values.reserve(indices.size());
+        for (size_t index : indices) {
+            if (index >= data.size()) throw out_of_range("Index out of range");
+            values.push_back(data[index]);
+        }
+        return make_shared<Series<T>>(name, std::move(values));
+    }
+
     /**
      * @brief Generates a new series with unique values.
      * 
@@ -423,6 +709,24 @@ public:
         }
     }
 
+    /**
+     * @brief Appends all the values of another series.
+     * 
+     * The values are copied in a single insertion. If the type of the other series does
+     * not match the type of the series, a runtime_error is thrown.
+     * 
+     * @param other The series whose values are to be appended.
+     * @throws runtime_error if the type of the other series does not match the type of the series.
+     */
+    void append(const ISeries* other) override {
+        const Series<T>* casted = dynamic_cast<const Series<T>*>(other);
+        if (casted) {
+            data.insert(data.end(), casted->data.begin(), casted->data.end());
+        } else {
+            throw runtime_error("Type mismatch between series");
+        }
+    }
+
     /**
      * @brief Clones the series.
      * 
@@ -0,0 +1,145 @@
+#ifndef STAGE_SUPERVISOR_HPP
+#define STAGE_SUPERVISOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "DataHandler.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for giving spare threads to the stages of the pipeline that fall behind.
+ *
+ * The supervisor checks the queues of the stages at a fixed interval and ranks the stages by pressure:
+ * how full the input queue is, times the room left in the fullest output queue. The stages above the
+ * high water mark get a replica on the pool, the most pressed first, while the budget of spare threads
+ * lasts. A stage whose output is full gets no replica, as it could only add to the backlog downstream.
+ *
+ * The replicas leave on their own once the input stays empty or an output fills up, which returns their
+ * threads to the budget.
+ */
+class StageSupervisor {
+private:
+    static constexpr double HIGH_WATER = 0.5; /**< Input fill from which a stage gets a replica. */
+
+    /**
+     * @brief A stage registered in the supervisor.
+     */
+    struct Stage {
+        DataHandler* handler; /**< The handler of the stage. */
+        function<void()> run; /**< Runs the handler, as a replica when the main thread already runs it. */
+        int node; /**< The NUMA node of the stage, or -1 for any node. */
+    };
+
+    ThreadPool& pool; /**< The pool that runs the replicas. */
+    int budget; /**< The number of replicas that may run at once, over all the stages. */
+    chrono::milliseconds interval; /**< The time between two checks of the queues. */
+    vector<Stage> stages; /**< The registered stages. */
+    atomic<int> replicasStarted{0}; /**< The replicas started since the start. */
+
+    thread monitor; /**< The thread that checks the queues. */
+    mutex stopMutex; /**< The mutex for the stop flag. */
+    condition_variable stopCondition; /**< Wakes the monitor when it must stop. */
+    bool stopping = false; /**< Whether the monitor must stop. */
+
+    /**
+     * @brief Start replicas for the stages that fall behind, the most pressed first.
+     */
+    void rebalance() {
+        int running = 0;
+        vector<pair<double, Stage*>> pressed;
+        for (Stage& stage : stages) {
+            running += stage.handler->getReplicas();
+            if (stage.handler->isFinished() || stage.handler->getReplicas() >= stage.handler->getMaxReplicas()) continue;
+
+            double fill = stage.handler->getInputFill();
+            double slack = stage.handler->getOutputSlack();
+            if (fill >= HIGH_WATER && slack > 0.0) pressed.push_back({fill * slack, &stage});
+        }
+
+        sort(pressed.begin(), pressed.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (auto& [pressure, stage] : pressed) {
+            if (running >= budget) break;
+            pool.execute(stage->run, stage->node);
+            replicasStarted.fetch_add(1, memory_order_relaxed);
+            running++;
+        }
+    }
+
+public:
+    /**
+     * @brief Construct a new StageSupervisor object.
+     *
+     * @param pool The pool that runs the replicas, which needs a spare thread for each one.
+     * @param budget The number of replicas that may run at once, over all the stages.
+     * @param interval The time between two checks of the queues.
+     */
+    StageSupervisor(ThreadPool& pool, int budget, chrono::milliseconds interval = chrono::milliseconds(20))
+        : pool(pool), budget(budget), interval(interval) {}
+
+    StageSupervisor(const StageSupervisor&) = delete;
+    StageSupervisor& operator=(const StageSupervisor&) = delete;
+
+    /**
+     * @brief Register a stage. Must be called before start.
+     *
+     * @param handler The handler of the stage, with its maximum number of replicas set.
+     * @param run Runs the handler, the same function as the one of its main thread.
+     * @param node The NUMA node that runs the replicas, the one of the main thread, or -1 for any node.
+     */
+    void addStage(DataHandler* handler, function<void()> run, int node = -1) {
+        stages.push_back({handler, std::move(run), node});
+    }
+
+    /**
+     * @brief Start checking the queues.
+     */
+    void start() {
+        monitor = thread([this] {
+            unique_lock<mutex> lock(stopMutex);
+            while (!stopCondition.wait_for(lock, interval, [this] { return stopping; })) {
+                lock.unlock();
+                rebalance();
+                lock.lock();
+            }
+        });
+    }
+
+    /**
+     * @brief Stop checking the queues. The replicas running finish on their own.
+     */
+    void stop() {
+        {
+            lock_guard<mutex> lock(stopMutex);
+            stopping = true;
+        }
+        stopCondition.notify_all();
+        if (monitor.joinable()) monitor.join();
+    }
+
+    /**
+     * @brief Get the number of replicas started.
+     *
+     * @return The replicas started since the start.
+     */
+    int getReplicasStarted() const {
+        return replicasStarted.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Destructor for the StageSupervisor object.
+     */
+    ~StageSupervisor() {
+        stop();
+    }
+};
+
+#endif // STAGE_SUPERVISOR_HPP
@@ -0,0 +1,185 @@
+#ifndef TASK_GRAPH_HPP
+#define TASK_GRAPH_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+#include "Future.hpp"
+#include "ThreadPool.hpp"
+
+using namespace std;
+
+/**
+ * @brief Class for running jobs on a ThreadPool in the order of their dependencies.
+ *
+ * The graph is a set of nodes and of edges between them: a node becomes runnable once all the nodes it
+ * depends on are finished, and it is then submitted to the pool, so no thread waits or polls for its
+ * inputs. A run gives a Future that is set once every node is finished.
+ *
+ * If a node throws, the nodes that depend on it, directly or not, are skipped, the others still run,
+ * and the Future of the run gets the first exception.
+ */
+class TaskGraph {
+public:
+    using NodeId = size_t;
+
+    /**
+     * @brief Add a node to the graph.
+     *
+     * @param job The job of the node.
+     * @param name The name of the node, for the errors.
+     * @return The id of the node.
+     */
+    NodeId addNode(function<void()> job, const string& name = "") {
+        nodes.push_back({std::move(job), name.empty() ? "node " + to_string(nodes.size()) : name, {}, 0});
+        return nodes.size() - 1;
+    }
+
+    /**
+     * @brief Make a node depend on another one.
+     *
+     * @param from The node that must finish first.
+     * @param to The node that runs after it.
+     * @throws runtime_error If a node does not exist.
+     */
+    void addEdge(NodeId from, NodeId to) {
+        if (from >= nodes.size() || to >= nodes.size()) throw runtime_error("Unknown node in edge");
+        nodes[from].successors.push_back(to);
+        nodes[to].dependencies++;
+    }
+
+    /**
+     * @brief Run the graph on a pool.
+     *
+     * The run works on a copy of the nodes, so the graph can be changed or run again meanwhile.
+     *
+     * @param pool The pool that runs the jobs.
+     * @return The Future of the run.
+     * @throws runtime_error If the graph has a cycle.
+     */
+    Future<void> run(ThreadPool& pool) const {
+        checkAcyclic();
+
+        auto state = make_shared<RunState>(nodes, pool);
+        Future<void> finished = state->promise.getFuture();
+        if (nodes.empty()) {
+            state->promise.setValue();
+            return finished;
+        }
+
+        for (NodeId id = 0; id < nodes.size(); id++) {
+            if (nodes[id].dependencies == 0) schedule(state, id);
+        }
+        return finished;
+    }
+
+    /**
+     * @brief Get the number of nodes.
+     *
+     * @return The number of nodes of the graph.
+     */
+    size_t size() const {
+        return nodes.size();
+    }
+
+private:
+    /**
+     * @brief A node of the graph.
+     */
+    struct Node {
+        function<void()> job; /**< The job of the node. */
+        string name; /**< The name of the node. */
+        vector<NodeId> successors; /**< The nodes that depend on this one. */
+        int dependencies; /**< The number of nodes this one depends on. */
+    };
+
+    /**
+     * @brief The state of a run of the graph.
+     */
+    struct RunState {
+        vector<Node> nodes; /**< The nodes, copied at the start of the run. */
+        ThreadPool& pool; /**< The pool that runs the jobs. */
+        unique_ptr<atomic<int>[]> remaining; /**< The dependencies of each node that are not finished. */
+        unique_ptr<atomic<bool>[]> skipped; /**< Whether each node follows a failed node. */
+        atomic<size_t> finished{0}; /**< The number of finished nodes, run or skipped. */
+        mutex errorMutex; /**< The mutex for the first exception. */
+        exception_ptr error; /**< The first exception thrown by a node. */
+        Promise<void> promise; /**< Set once all the nodes are finished. */
+
+        RunState(const vector<Node>& nodes, ThreadPool& pool)
+            : nodes(nodes), pool(pool), remaining(new atomic<int>[nodes.size()]), skipped(new atomic<bool>[nodes.size()]),
+              promise(pool.getExecutor()) {
+            for (size_t i = 0; i < nodes.size(); i++) {
+                remaining[i].store(nodes[i].dependencies, memory_order_relaxed);
+                skipped[i].store(false, memory_order_relaxed);
+            }
+        }
+    };
+
+    vector<Node> nodes;
+
+    /**
+     * @brief Run a node on the pool, then release the nodes that depend on it.
+     */
+    static void schedule(const shared_ptr<RunState>& state, NodeId id) {
+        state->pool.execute([state, id] {
+            const Node& node = state->nodes[id];
+            bool failed = state->skipped[id].load(memory_order_acquire);
+
+            if (!failed) {
+                try {
+                    node.job();
+                } catch (...) {
+                    failed = true;
+                    lock_guard<mutex> lock(state->errorMutex);
+                    if (!state->error) state->error = current_exception();
+                }
+            }
+
+            for (NodeId successor : node.successors) {
+                if (failed) state->skipped[successor].store(true, memory_order_release);
+                if (state->remaining[successor].fetch_sub(1, memory_order_acq_rel) == 1) schedule(state, successor);
+            }
+
+            if (state->finished.fetch_add(1, memory_order_acq_rel) + 1 == state->nodes.size()) {
+                if (state->error) state->promise.setException(state->error);
+                else state->promise.setValue();
+            }
+        });
+    }
+
+    /**
+     * @brief Check that the graph has no cycle, which would never finish.
+     */
+    void checkAcyclic() const {
+        vector<int> remaining(nodes.size());
+        vector<NodeId> ready;
+        for (NodeId id = 0; id < nodes.size(); id++) {
+            remaining[id] = nodes[id].dependencies;
+            if (remaining[id] == 0) ready.push_back(id);
+        }
+
+        size_t visited = 0;
+        while (!ready.empty()) {
+            NodeId id = ready.back();
+            ready.pop_back();
+            visited++;
+            for (NodeId successor : nodes[id].successors) {
+                if (--remaining[successor] == 0) ready.push_back(successor);
+            }
+        }
+
+        if (visited < nodes.size()) {
+            for (NodeId id = 0; id < nodes.size(); id++) {
+                if (remaining[id] > 0) throw runtime_error("Task graph has a cycle through " + nodes[id].name);
+            }
+        }
+    }
+};
+
+#endif // TASK_GRAPH_HPP
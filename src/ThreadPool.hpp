@@ -5,49 +5,86 @@
 #include <vector>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
 #include <deque>
+#include <memory>
+#include <atomic>
 #include <functional>
 
+#include "Futex.hpp"
+#include "Future.hpp"
+#include "Coroutine.hpp"
+#include "CpuTopology.hpp"
+#include "WorkStealingDeque.hpp"
+
 using namespace std;
 
+/**
+ * @brief Where the threads of a ThreadPool may run
+ */
+enum class AffinityPolicy {
+    None, // The threads run anywhere
+    Core, // Each thread is pinned to one CPU, filling a NUMA node before the next one
+    Node  // Each thread is pinned to the CPUs of one NUMA node, the threads spread over the nodes
+};
 
 /**
- * @brief A thread pool class  
- * 
- * The ThreadPool class creates a number of threads and allows tasks to be added to a queue. 
- * The threads will execute the tasks in the queue until the ThreadPool object is destroyed.
+ * @brief A thread pool class
+ *
+ * The ThreadPool class creates a number of threads that execute the tasks added to it, each task once.
+ * Every thread owns a work-stealing deque: tasks added by a thread of the pool go to its own deque, and
+ * tasks added from outside go to a shared injection queue. A thread runs the tasks of its own deque
+ * first, newest first, then takes from the injection queue, then steals the oldest tasks of the other
+ * threads. Threads with nothing to do sleep on a futex until a task is added.
+ * With an affinity policy, the threads are pinned to the CPUs of the NUMA nodes, and a task may be added
+ * for a node: it waits in the queue of that node, and the threads of the node take it and steal from each
+ * other before they look at the other nodes, so the data of a task stays in the memory of its node.
+ * Tasks added with submit give a Future, whose continuations run on the pool as well.
+ * Coroutines added with spawn run on the pool too, and give back their thread whenever they wait.
+ * The threads execute the tasks left when the ThreadPool object is destroyed, then stop.
  */
 class ThreadPool {
 public:
+    using Task = function<void()>;
 
     /**
      * @brief Construct a new ThreadPool object
-     * 
+     *
      * @param numThreads The number of threads to be created
+     * @param affinity Where the threads may run
+     * @param topology The NUMA nodes of the machine and their CPUs
      */
-    ThreadPool(int numThreads) : numThreads(numThreads) {
+    ThreadPool(int numThreads, AffinityPolicy affinity = AffinityPolicy::None,
+               const CpuTopology& topology = CpuTopology::system())
+        : numThreads(numThreads > 0 ? numThreads : 1), affinity(affinity) {
         // Create a number of threads and start them
         printf("Number of threads: %d\n", numThreads);
-        for (int i = 0; i < numThreads; i++) {
-            threads.push_back(thread([this] { this->run(); }));
+        placeWorkers(topology);
+        for (int i = 0; i < this->numThreads; i++) {
+            deques.push_back(make_unique<WorkStealingDeque<Task*>>());
+        }
+        for (int node = 0; node <= numNodes; node++) {
+            // One queue per node, then the queue of the tasks for any node
+            injection.push_back(make_unique<InjectionQueue>());
+        }
+        for (int node = 0; node < numNodes; node++) {
+            sleepers.push_back(make_unique<Sleepers>());
+        }
+        for (int i = 0; i < this->numThreads; i++) {
+            threads.push_back(thread([this, i] { this->run(i); }));
         }
     }
 
     /**
      * @brief Destroy the ThreadPool object
-     * 
-     * Safely stop the threads and wait for them to finish
+     *
+     * Safely stop the threads once the tasks left are executed, and wait for them to finish
      */
     ~ThreadPool() {
-        {
-            // Safely stop the threads
-            unique_lock<mutex> lock(queueMutex);
-            stop = true;
+        stop.store(true, memory_order_seq_cst);
+        for (int node = 0; node < numNodes; node++) {
+            wakeWorkers(node, true);
         }
 
-        condition.notify_all();
-
         // Wait for the threads to finish
         for (auto& thread : threads) {
             thread.join();
@@ -56,84 +93,314 @@ public:
 
     /**
      * @brief Add a task with certain arguments to the thread pool
-     * 
+     *
      * @param task The task to be added
      * @param args The arguments to be passed to the task
      */
     template<class F, class... Args>
     void addTask(F&& task, Args&&... args) {
-        {
-            // Add the task to the queue
-            unique_lock<mutex> lock(queueMutex);
-            tasks.push_back([=] { task(args...); });
-            numTasks++;
-        }
+        execute([=] { task(args...); });
+    }
 
-        // Notify a thread that there is a task to be executed
-        condition.notify_one();
+    /**
+     * @brief Submit a job to be executed once by one of the threads, and get its result
+     *
+     * @param job The job to be executed
+     * @param node The NUMA node that runs the job, or -1 for any node
+     * @return The Future of the value returned by the job, or of the exception it throws
+     */
+    template<class F>
+    auto submit(F job, int node = -1) {
+        Promise<invoke_result_t<F>> promise(getExecutor());
+        auto future = promise.getFuture();
+        execute([promise, job]() mutable { promise.setFrom(job); }, node);
+        return future;
     }
 
-private:
     /**
-     * @brief The function that the threads will execute
+     * @brief Start a coroutine on the threads, which runs it and resumes it after each wait
+     *
+     * @param coroutine The coroutine to be started
+     * @param node The NUMA node that runs the coroutine, or -1 for any node
+     * @return The Future of the value returned by the coroutine, or of the exception it throws
+     */
+    template<class T>
+    Future<T> spawn(Coroutine<T> coroutine, int node = -1) {
+        return std::move(coroutine).start(getExecutor(node));
+    }
+
+    /**
+     * @brief Get an executor that runs jobs on the pool, for the continuations of Futures
+     *
+     * @param node The NUMA node that runs the jobs, or -1 for any node
+     * @return The executor
      */
-    void run() { 
-        // Wait for a task to be added to the queue
-        while (numTasks == 0) 
-        {
-            this_thread::sleep_for(chrono::milliseconds(100));
+    Executor getExecutor(int node = -1) {
+        return [this, node](Task job) { execute(std::move(job), node); };
+    }
+
+    /**
+     * @brief Execute a job once on one of the threads, without a Future
+     *
+     * @param job The job to be executed
+     * @param node The NUMA node that runs the job, or -1 for any node
+     */
+    void execute(Task job, int node = -1) {
+        Task* task = new Task(std::move(job));
+        pending.fetch_add(1, memory_order_relaxed);
+        if (node < 0 || node >= numNodes) node = -1;
+
+        if (currentPool == this && (node == -1 || node == workerNodes[currentWorker])) {
+            // A thread of the pool keeps its tasks, the others steal them if they are idle
+            deques[currentWorker]->push(task);
+        } else {
+            InjectionQueue& queue = *injection[node == -1 ? numNodes : node];
+            lock_guard<mutex> lock(queue.queueMutex);
+            queue.tasks.push_back(task);
+            queue.size.store(queue.tasks.size(), memory_order_seq_cst);
         }
 
-        // Execute the tasks in the queue
+        // Wake a sleeping thread, of the node of the task if there is one
+        int home = node != -1 ? node : max(getCurrentNode(), 0);
+        if (!wakeWorkers(home, false)) {
+            for (int other = 0; other < numNodes; other++) {
+                if (other != home && wakeWorkers(other, false)) break;
+            }
+        }
+    }
+
+    /**
+     * @brief Wait until all the tasks added are executed, including the tasks they add
+     */
+    void wait() {
         while (true) {
-            function<void()> task;
+            uint32_t seen = idleEpoch.load(memory_order_acquire);
+            idleWaiters.fetch_add(1, memory_order_seq_cst);
+            bool idle = pending.load(memory_order_seq_cst) == 0;
+            if (!idle) Futex::wait(idleEpoch, seen);
+            idleWaiters.fetch_sub(1, memory_order_relaxed);
+            if (idle) return;
+        }
+    }
+
+    /**
+     * @brief Get the number of tasks added and not executed yet
+     *
+     * @return The number of pending tasks
+     */
+    int getPending() const {
+        return pending.load();
+    }
 
-            {
-                unique_lock<mutex> lock(queueMutex);
-                
-                // Block the thread until there is a task in the queue or the thread is stopped
-                condition.wait(lock, [this] { return !tasks.empty() || stop; });
+    /**
+     * @brief Get the number of threads of the pool
+     *
+     * @return The number of threads
+     */
+    int getThreadCount() const {
+        return numThreads;
+    }
 
-                // If the thread is stopped and the queue is empty, return
-                if (stop && tasks.empty()) {
-                    return;
-                }
+    /**
+     * @brief Get the number of NUMA nodes the threads are placed on
+     *
+     * @return The number of nodes, 1 without an affinity policy
+     */
+    int getNodeCount() const {
+        return numNodes;
+    }
 
-                // Get the task according to the taskIndex
-                task = get_next_task();
+    /**
+     * @brief Get the NUMA node of the current thread
+     *
+     * @return The node of the thread, or -1 if it is not a thread of the pool
+     */
+    int getCurrentNode() const {
+        return currentPool == this ? workerNodes[currentWorker] : -1;
+    }
 
-                // Increment the taskIndex
-                taskIndex++;
-            }
+private:
+    static constexpr int STEAL_ROUNDS = 4; // Rounds over the other threads before a thread sleeps
 
-            // Execute the task
-            task();
+    /**
+     * @brief A queue of the tasks added from outside the pool, or for another node
+     */
+    struct InjectionQueue {
+        deque<Task*> tasks; // Tasks waiting for a thread
+        mutex queueMutex; // Mutex for the tasks
+        atomic<size_t> size{0}; // Number of tasks, read without the mutex
+    };
+
+    /**
+     * @brief The sleeping threads of a node
+     */
+    struct Sleepers {
+        atomic<uint32_t> epoch{0}; // Futex word of the sleeping threads
+        atomic<int> count{0}; // Number of sleeping threads
+    };
+
+    /**
+     * @brief Choose the node and the CPUs of each thread
+     */
+    void placeWorkers(const CpuTopology& topology) {
+        vector<int> cpus = topology.getCpusByNode();
+        if (cpus.empty()) affinity = AffinityPolicy::None;
+        numNodes = affinity == AffinityPolicy::Node ? topology.getNodeCount() : 1;
 
-            // Notify the condition variable that the task is finished
-            condition.notify_one();
+        for (int i = 0; i < numThreads; i++) {
+            if (affinity == AffinityPolicy::Node) {
+                // Round robin over the nodes, each thread free to move within its node
+                workerNodes.push_back(i % numNodes);
+                workerCpus.push_back(topology.getCpus(i % numNodes));
+            } else if (affinity == AffinityPolicy::Core) {
+                // One CPU per thread, the CPUs of a node next to each other
+                workerNodes.push_back(0);
+                workerCpus.push_back({cpus[i % cpus.size()]});
+            } else {
+                workerNodes.push_back(0);
+                workerCpus.push_back({});
+            }
         }
     }
 
     /**
-     * @brief Get the next task from the queue using the taskIndex
-     * 
-     * @return The task to be executed
+     * @brief Take a task from an injection queue
      */
-    function<void()> get_next_task() {
-        // Get the task from the taskIndex
-        function<void()> task = tasks[taskIndex %= numTasks];
-        
+    Task* takeInjected(InjectionQueue& queue) {
+        if (queue.size.load(memory_order_relaxed) == 0) return nullptr;
+
+        lock_guard<mutex> lock(queue.queueMutex);
+        if (queue.tasks.empty()) return nullptr;
+        Task* task = queue.tasks.front();
+        queue.tasks.pop_front();
+        queue.size.store(queue.tasks.size(), memory_order_relaxed);
         return task;
     }
 
+    /**
+     * @brief Steal a task from the threads of a node, or of all the other nodes
+     */
+    Task* stealTask(int index, uint32_t& seed, bool sameNode) {
+        Task* task = nullptr;
+        int node = workerNodes[index];
+        for (int round = 0; round < STEAL_ROUNDS; round++) {
+            // Start at a random victim, so the thieves spread over the threads
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            int start = seed % numThreads;
+            for (int i = 0; i < numThreads; i++) {
+                int victim = (start + i) % numThreads;
+                if (victim == index || (workerNodes[victim] == node) != sameNode) continue;
+                if (deques[victim]->steal(task)) return task;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Find a task: from the own deque, then the queue of the own node, then the shared queue, then
+     * the other deques of the node, and only then the other nodes
+     */
+    Task* findTask(int index, uint32_t& seed) {
+        Task* task = nullptr;
+        int node = workerNodes[index];
+        if (deques[index]->pop(task)) return task;
+        if ((task = takeInjected(*injection[node])) != nullptr) return task;
+        if ((task = takeInjected(*injection[numNodes])) != nullptr) return task;
+        if ((task = stealTask(index, seed, true)) != nullptr) return task;
+        if (numNodes == 1) return nullptr;
+
+        // Remote work is better than none, when the own node is idle
+        if ((task = stealTask(index, seed, false)) != nullptr) return task;
+        for (int i = 1; i < numNodes; i++) {
+            if ((task = takeInjected(*injection[(node + i) % numNodes])) != nullptr) return task;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Check if a task is waiting anywhere in the pool
+     */
+    bool hasWork() const {
+        for (const auto& queue : injection) {
+            if (queue->size.load(memory_order_seq_cst) > 0) return true;
+        }
+        for (const auto& workerDeque : deques) {
+            if (!workerDeque->isEmpty()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Wake one sleeping thread of a node, or all of them, and tell if one was sleeping
+     */
+    bool wakeWorkers(int node, bool all) {
+        // Order the push before the check: either a sleeping thread is seen here, or it sees the task
+        atomic_thread_fence(memory_order_seq_cst);
+        Sleepers& sleeping = *sleepers[node];
+        if (sleeping.count.load(memory_order_seq_cst) == 0) return false;
+        sleeping.epoch.fetch_add(1, memory_order_release);
+        if (all) Futex::wakeAll(sleeping.epoch);
+        else Futex::wakeOne(sleeping.epoch);
+        return true;
+    }
+
+    /**
+     * @brief The function that the threads will execute
+     */
+    void run(int index) {
+        currentPool = this;
+        currentWorker = index;
+        if (!workerCpus[index].empty()) CpuTopology::pinCurrentThread(workerCpus[index]);
+        uint32_t seed = 2654435761u * (index + 1);
+
+        // Execute the tasks until the pool is stopped and no task is left
+        while (true) {
+            Task* task = findTask(index, seed);
+
+            if (task == nullptr) {
+                Sleepers& sleeping = *sleepers[workerNodes[index]];
+                uint32_t seen = sleeping.epoch.load(memory_order_acquire);
+                sleeping.count.fetch_add(1, memory_order_seq_cst);
+
+                // Check again once registered, as a task may have been added before it could see us
+                bool sleep = !hasWork() && !stop.load(memory_order_seq_cst);
+                if (sleep) Futex::wait(sleeping.epoch, seen);
+                sleeping.count.fetch_sub(1, memory_order_relaxed);
+
+                if (!sleep && stop.load(memory_order_seq_cst) && !hasWork()) return;
+                continue;
+            }
+
+            // Execute the task
+            (*task)();
+            delete task;
+
+            // Notify the threads waiting for the pool to be idle
+            if (pending.fetch_sub(1, memory_order_seq_cst) == 1 && idleWaiters.load(memory_order_seq_cst) > 0) {
+                idleEpoch.fetch_add(1, memory_order_release);
+                Futex::wakeAll(idleEpoch);
+            }
+        }
+    }
+
+    static inline thread_local ThreadPool* currentPool = nullptr; // Pool of the current thread
+    static inline thread_local int currentWorker = -1; // Index of the current thread in its pool
+
     int numThreads; // Number of threads
-    int numTasks = 0; // Number of tasks
-    int taskIndex = 0; // Index of the task
+    AffinityPolicy affinity; // Where the threads may run
+    int numNodes = 1; // Number of NUMA nodes the threads are placed on
+    vector<int> workerNodes; // Node of each thread
+    vector<vector<int>> workerCpus; // CPUs of each thread, empty if it is not pinned
     vector<thread> threads; // Vector of threads
-    deque<function<void()>> tasks; // Queue of tasks
-    mutex queueMutex; // Mutex for the queue
-    condition_variable condition; // Condition variable for the queue
-    bool stop = false; // Flag to stop the threads
+    vector<unique_ptr<WorkStealingDeque<Task*>>> deques; // Deque of each thread
+    vector<unique_ptr<InjectionQueue>> injection; // Queue of each node, then the shared queue
+    atomic<int> pending{0}; // Tasks added and not executed yet
+    vector<unique_ptr<Sleepers>> sleepers; // Sleeping threads of each node
+    atomic<uint32_t> idleEpoch{0}; // Futex word of the threads waiting for the pool to be idle
+    atomic<int> idleWaiters{0}; // Number of threads waiting for the pool to be idle
+    atomic<bool> stop{false}; // Flag to stop the threads
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,7 +3,7 @@
 
 #include <iostream>
 #include <chrono>
-#include <thread>
+#include <atomic>
 #include "AbstractTrigger.hpp"
 using namespace std;
 
@@ -12,46 +12,48 @@ using namespace std;
  * @brief Trigger activated at regular intervals.
  * 
  * This class represents a trigger that activates at regular intervals.
+ * The activations are at fixed times from the first one, whatever the time the observers take.
  */
 class TimerTrigger : public Trigger {
 private:
-    std::chrono::milliseconds interval;
-    bool active;
+    std::atomic<std::chrono::milliseconds> interval;
+
+protected:
+    // The observers are notified as soon as the trigger is activated
+    std::chrono::milliseconds getFirstDelay() override {
+        return std::chrono::milliseconds(0);
+    }
+
+    std::chrono::milliseconds getNextInterval() override {
+        return interval.load();
+    }
+
+    void notify(Observer& observer) override {
+        observer.updateOnTimeTrigger();
+    }
 
 public:
     /**
      * @brief Constructs a new TimerTrigger object with a given interval.
      * 
      * @param interval The interval between activations.
+     * @param wheel The wheel that schedules the activations.
      */
-    TimerTrigger(std::chrono::milliseconds interval) : interval(interval), active(false) {}
+    TimerTrigger(std::chrono::milliseconds interval, TimerWheel& wheel = TimerWheel::shared())
+        : Trigger(wheel), interval(interval) {}
+
+    ~TimerTrigger() {
+        deactivate();
+    }
 
     /**
-     * @brief Sets the interval between activations.
+     * @brief Sets the interval between activations, from the next one on.
      * 
      * @param newInterval The new interval.
      */
     void setInterval(std::chrono::milliseconds newInterval) {
         interval = newInterval;
     }
-
-    // Overriding activate method
-    void activate() override {
-        active = true;
-        std::thread([this]() {
-            while (active) {
-                for (auto observer : observers) {
-                    observer->updateOnTimeTrigger(); // Notify all observers
-                }
-                std::this_thread::sleep_for(interval);
-            }
-        }).detach();
-    }
-
-
-    void deactivate() override {
-        active = false;
-    }
 };
 
 #endif // TIMERTRIGGER_HPP
@@ -0,0 +1,276 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <exception>
+
+using namespace std;
+
+/**
+ * @brief Class for running callbacks at absolute deadlines, all from a single thread.
+ *
+ * The timers are kept in a hierarchical timing wheel: four levels of 64 slots, each slot of a level
+ * spanning a whole turn of the level below. Scheduling and cancelling a timer take constant time, and
+ * as the time goes by the timers of a slot of an upper level are moved down, until they reach the first
+ * level, whose slots are one tick each, and are fired. Deadlines further than the four levels wait in
+ * the last slot of the top level and are moved down again until they are in reach.
+ *
+ * The thread sleeps until the next slot with timers on the first level, or until the first level turns
+ * if the timers are all further, and does not wake at all while there is no timer. The callbacks run
+ * on the thread of the wheel, so they should be short, such as handing the real work to a ThreadPool.
+ */
+class TimerWheel {
+public:
+    using Clock = chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Callback = function<void()>;
+
+    /**
+     * @brief Construct a new TimerWheel object and start its thread.
+     *
+     * @param tick The resolution of the deadlines.
+     */
+    TimerWheel(chrono::milliseconds tick = chrono::milliseconds(1))
+        : tick(max(tick, chrono::milliseconds(1))), start(Clock::now()) {
+        worker = thread([this] { run(); });
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Stop the thread. The timers not fired yet are dropped.
+     */
+    ~TimerWheel() {
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        worker.join();
+    }
+
+    /**
+     * @brief Get the wheel shared by the triggers of the process.
+     *
+     * @return The wheel, started on first use.
+     */
+    static TimerWheel& shared() {
+        static TimerWheel wheel;
+        return wheel;
+    }
+
+    /**
+     * @brief Run a callback at a deadline, or at the next tick if the deadline has passed.
+     *
+     * @param deadline The time of the callback.
+     * @param callback The callback, run on the thread of the wheel.
+     * @return The id of the timer, to cancel it.
+     */
+    TimerId schedule(Clock::time_point deadline, Callback callback) {
+        lock_guard<mutex> lock(wheelMutex);
+        // An empty wheel has nothing to fire until now, so it can skip the ticks it slept through
+        if (timers.empty()) currentTick = max(currentTick, ticksAt(Clock::now()));
+
+        TimerId id = nextId++;
+        uint64_t expiry = max(ticksUntil(deadline), currentTick + 1);
+        timers.emplace(id, Timer{expiry, std::move(callback)});
+        insert(id, expiry);
+        wakeCondition.notify_one();
+        return id;
+    }
+
+    /**
+     * @brief Run a callback after a delay.
+     *
+     * @param delay The time to wait.
+     * @param callback The callback, run on the thread of the wheel.
+     * @return The id of the timer, to cancel it.
+     */
+    TimerId scheduleAfter(chrono::milliseconds delay, Callback callback) {
+        return schedule(Clock::now() + delay, std::move(callback));
+    }
+
+    /**
+     * @brief Cancel a timer. If its callback is running, wait until it returns, unless called from it.
+     *
+     * @param id The id of the timer.
+     * @return true If the timer was cancelled before it fired.
+     */
+    bool cancel(TimerId id) {
+        unique_lock<mutex> lock(wheelMutex);
+        // The id is left in its slot and skipped when the slot is reached
+        if (timers.erase(id) > 0) return true;
+        if (this_thread::get_id() != worker.get_id()) {
+            firedCondition.wait(lock, [this, id] { return runningId != id; });
+        }
+        return false;
+    }
+
+    /**
+     * @brief Get the number of timers waiting to fire.
+     *
+     * @return The number of timers.
+     */
+    size_t size() {
+        lock_guard<mutex> lock(wheelMutex);
+        return timers.size();
+    }
+
+private:
+    static constexpr int LEVELS = 4; /**< Levels of the wheel. */
+    static constexpr int SLOT_BITS = 6; /**< Bits of the tick number per level. */
+    static constexpr uint64_t SLOTS = 1 << SLOT_BITS; /**< Slots of a level. */
+    static constexpr uint64_t SPAN = uint64_t(1) << (SLOT_BITS * LEVELS); /**< Ticks the wheel covers. */
+
+    /**
+     * @brief A timer waiting to fire.
+     */
+    struct Timer {
+        uint64_t expiry; /**< The tick of the deadline. */
+        Callback callback; /**< The callback to run. */
+    };
+
+    chrono::milliseconds tick; /**< The length of a tick. */
+    Clock::time_point start; /**< The time of tick 0. */
+    uint64_t currentTick = 0; /**< The last tick processed. */
+    TimerId nextId = 1; /**< The id of the next timer. */
+    TimerId runningId = 0; /**< The timer whose callback runs, 0 if none. */
+
+    array<array<vector<TimerId>, SLOTS>, LEVELS> slots; /**< The ids of the timers in each slot of each level. */
+    unordered_map<TimerId, Timer> timers; /**< The timers not fired nor cancelled. */
+
+    mutex wheelMutex; /**< The mutex for the wheel. */
+    condition_variable wakeCondition; /**< Wakes the thread when a timer is scheduled or it must stop. */
+    condition_variable firedCondition; /**< Wakes the threads cancelling the timer that was running. */
+    bool stopping = false; /**< Whether the thread must stop. */
+    thread worker; /**< The thread of the wheel. */
+
+    /**
+     * @brief Get the number of whole ticks from the start to a time.
+     */
+    uint64_t ticksAt(Clock::time_point time) const {
+        return time <= start ? 0 : static_cast<uint64_t>((time - start) / tick);
+    }
+
+    /**
+     * @brief Get the first tick at or after a deadline.
+     */
+    uint64_t ticksUntil(Clock::time_point deadline) const {
+        if (deadline <= start) return 0;
+        auto elapsed = deadline - start;
+        uint64_t ticks = static_cast<uint64_t>(elapsed / tick);
+        return elapsed % tick == Clock::duration::zero() ? ticks : ticks + 1;
+    }
+
+    /**
+     * @brief Put a timer in the slot of its expiry, on the lowest level that reaches it.
+     */
+    void insert(TimerId id, uint64_t expiry) {
+        // Deadlines out of reach wait in the furthest slot and are placed again once it is reached
+        uint64_t target = min(expiry, currentTick + SPAN - 1);
+        uint64_t delta = target - currentTick;
+
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) level++;
+        slots[level][(target >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(id);
+    }
+
+    /**
+     * @brief Process the next tick: move the timers of the upper levels down and take the timers due.
+     *
+     * @param due Receives the ids of the timers due at the tick.
+     */
+    void advance(vector<TimerId>& due) {
+        currentTick++;
+
+        // Each level whose lower levels just completed a turn hands its current slot down
+        for (int level = 1; level < LEVELS; level++) {
+            if ((currentTick & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+            vector<TimerId> moved;
+            moved.swap(slots[level][(currentTick >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+            for (TimerId id : moved) {
+                auto it = timers.find(id);
+                if (it != timers.end()) insert(id, it->second.expiry);
+            }
+        }
+
+        vector<TimerId>& slot = slots[0][currentTick & (SLOTS - 1)];
+        for (TimerId id : slot) {
+            auto it = timers.find(id);
+            if (it == timers.end()) continue;
+            if (it->second.expiry <= currentTick) due.push_back(id);
+            else insert(id, it->second.expiry); // Only a deadline that was out of reach lands here early
+        }
+        slot.clear();
+    }
+
+    /**
+     * @brief Get the time of the next tick with work: a slot with timers on the first level, or the next
+     *        turn of the first level, when the upper levels move their timers down.
+     */
+    Clock::time_point nextWakeUp() const {
+        uint64_t wake = (currentTick | (SLOTS - 1)) + 1;
+        for (uint64_t next = currentTick + 1; next < wake; next++) {
+            if (!slots[0][next & (SLOTS - 1)].empty()) {
+                wake = next;
+                break;
+            }
+        }
+        return start + tick * wake;
+    }
+
+    /**
+     * @brief Fire the timers as their deadlines pass.
+     */
+    void run() {
+        unique_lock<mutex> lock(wheelMutex);
+        vector<TimerId> due;
+        while (!stopping) {
+            if (timers.empty()) {
+                wakeCondition.wait(lock, [this] { return stopping || !timers.empty(); });
+                continue;
+            }
+
+            uint64_t now = ticksAt(Clock::now());
+            if (currentTick >= now) {
+                wakeCondition.wait_until(lock, nextWakeUp());
+                continue;
+            }
+
+            while (currentTick < now && due.empty()) advance(due);
+
+            for (TimerId id : due) {
+                auto it = timers.find(id);
+                if (it == timers.end()) continue; // Cancelled by an earlier callback of the same tick
+                Callback callback = std::move(it->second.callback);
+                timers.erase(it);
+
+                runningId = id;
+                lock.unlock();
+                try {
+                    callback();
+                } catch (const exception& e) {
+                    cerr << "Timer callback failed: " << e.what() << endl;
+                }
+                lock.lock();
+                runningId = 0;
+                firedCondition.notify_all();
+            }
+            due.clear();
+        }
+    }
+};
+
+#endif // TIMER_WHEEL_HPP
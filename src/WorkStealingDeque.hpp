@@ -0,0 +1,166 @@
+#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Class for a Chase-Lev work-stealing deque.
+ *
+ * The owner thread pushes and pops at the bottom of the deque, in last in first out order, without any
+ * compare-and-swap unless it races for the last element. The other threads steal from the top, in first
+ * in first out order, with a compare-and-swap on the top index. The ring buffer grows when it is full;
+ * the old buffers are kept until the deque is destroyed, as a thief may still be reading them.
+ *
+ * Only trivially copyable elements fit, such as pointers, since they are read and written atomically.
+ */
+template <typename T>
+class WorkStealingDeque {
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /**
+     * @brief A ring buffer with a power of two capacity.
+     */
+    struct Buffer {
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> cells;
+
+        explicit Buffer(int64_t capacity) : capacity(capacity), mask(capacity - 1), cells(new std::atomic<T>[capacity]) {}
+
+        T get(int64_t index) const {
+            return cells[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T element) {
+            cells[index & mask].store(element, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Copy the elements between top and bottom into a buffer twice as large.
+         */
+        Buffer* grow(int64_t bottom, int64_t top) const {
+            Buffer* grown = new Buffer(2 * capacity);
+            for (int64_t i = top; i < bottom; i++) grown->put(i, get(i));
+            return grown;
+        }
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom{0};
+    std::atomic<Buffer*> buffer;
+    std::vector<std::unique_ptr<Buffer>> buffers; /**< All the buffers, owned by the deque. */
+
+public:
+    /**
+     * @brief Construct a new WorkStealingDeque object.
+     *
+     * @param capacity The initial capacity, rounded up to a power of two.
+     */
+    explicit WorkStealingDeque(int64_t capacity = 256) {
+        int64_t rounded = 1;
+        while (rounded < capacity) rounded <<= 1;
+        buffers.emplace_back(new Buffer(rounded));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Push an element at the bottom. Only the owner thread may call it.
+     *
+     * @param element The element to push.
+     */
+    void push(T element) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+
+        if (b - t > current->capacity - 1) {
+            buffers.emplace_back(current->grow(b, t));
+            current = buffers.back().get();
+            buffer.store(current, std::memory_order_release);
+        }
+
+        current->put(b, element);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Pop the element at the bottom. Only the owner thread may call it.
+     *
+     * @param element Receives the popped element.
+     * @return true If an element was popped.
+     * @return false If the deque is empty, or a thief took its last element.
+     */
+    bool pop(T& element) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty, restore the bottom
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        element = current->get(b);
+        if (t == b) {
+            // Last element, race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Steal the element at the top. Any thread may call it.
+     *
+     * @param element Receives the stolen element.
+     * @return true If an element was stolen.
+     * @return false If the deque is empty, or another thread took the element first.
+     */
+    bool steal(T& element) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+
+        Buffer* current = buffer.load(std::memory_order_acquire);
+        T stolen = current->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return false;
+
+        element = stolen;
+        return true;
+    }
+
+    /**
+     * @brief Get the number of elements, which may be stale by the time it is used.
+     *
+     * @return The number of elements in the deque.
+     */
+    int64_t size() const {
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        return b > t ? b - t : 0;
+    }
+
+    /**
+     * @brief Check if the deque is empty, which may be stale by the time it is used.
+     *
+     * @return true If the deque has no element.
+     */
+    bool isEmpty() const {
+        return size() == 0;
+    }
+};
+
+#endif // WORK_STEALING_DEQUE_HPP
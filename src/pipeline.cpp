@@ -7,16 +7,71 @@
 #include "DataRepo.hpp"
 #include "DataHandler.hpp"
 #include "ThreadPool.hpp"
+#include "StageSupervisor.hpp"
+#include "ResultStore.hpp"
 #include <chrono>
 #include <thread>
 #include <memory>
+#include <tuple>
 
 
 using namespace std;
 
-int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
-    // Create a thread pool with 8 threads
-    ThreadPool pool(numThreads);
+/**
+ * @brief Merge the dataframes of an output queue of the pipeline into its result, until the queue is closed.
+ */
+Coroutine<void> mergeResults(Queue<DataFrame*>* outputQueue, DataFrame** result_dataframe, DataFrame** dataframe_time, mutex* result_mutex) {
+    DataFrame* df;
+    while (co_await outputQueue->popAsync(df)) {
+        {
+            lock_guard<mutex> lock(*result_mutex);
+
+            // If the result dataframe is empty, set it to the first dataframe in the queue
+            if (*result_dataframe == nullptr) 
+            {
+                *result_dataframe = df;
+                
+                // Create a new dataframe with the time difference of the first dataframe, unless the latencies
+                // of the previous window were not taken yet
+                if (*dataframe_time == nullptr) *dataframe_time = new DataFrame({"time"});
+
+                long long timestamp = (*result_dataframe)->getTimestamp();
+                long long current_timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+                
+                // Add the time difference to the dataframe beetwen current timestamp and its timestamp
+                (*dataframe_time)->addRow(current_timestamp - timestamp);
+            }
+            else 
+            {
+                // If the dataframe has only one column, sum the values else merge the dataframes
+                if (df->getColumnCount() == 1) **result_dataframe = DataFrame::mergeAndSum(**result_dataframe, *df, "", "Count");
+                else **result_dataframe = DataFrame::mergeAndSum(**result_dataframe, *df, "Value", "Count");
+                
+                // The latencies may have been taken by their own trigger while the result was not
+                if (*dataframe_time == nullptr) *dataframe_time = new DataFrame({"time"});
+
+                // Add the time difference to the dataframe beetwen current timestamp and its timestamp
+                long long timestamp = df->getTimestamp();
+                long long current_timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+                (*dataframe_time)->addRow(current_timestamp - timestamp);
+
+                // Delete the old DataFrame
+                delete df;
+            }
+        }
+    }
+}
+
+int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads, ResultStore* resultStore = nullptr){
+    // The handlers are started once the queues are wired, so each queue knows its producers and consumers.
+    // Each one is a long-lived coroutine that is suspended on its input queue until the queue is closed.
+    // The tasks keep the NUMA node of their branch, or -1 for any node.
+    vector<tuple<DataHandler*, int, function<Coroutine<void>()>>> handlerTasks;
+
+    // The view branch and the buy branch each stay on one NUMA node, so the frames passed between the
+    // stages of a branch are allocated and read on the same node
+    int viewNode = 0;
+    int buyNode = CpuTopology::system().getNodeCount() > 1 ? 1 : 0;
 
     //========= USING ONLY DATA FROM "CADE ANALYTICS"
 
@@ -25,42 +80,42 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     Queue<DataFrame*> queueCA2(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesCA = {&queueCA1, &queueCA2};
     CopyHandler copyCA(queueCA, outputQueuesCA);
-    pool.addTask([&copyCA]() {
-        copyCA.copy();
-    });
+    handlerTasks.push_back({&copyCA, -1, [&copyCA]() {
+        return copyCA.copyAsync();
+    }});
 
 
     // Número de produtos visualizados por minuto:
     Queue<DataFrame*> queueUser(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesUser = {&queueUser};
     FilterHandler filterUser(&queueCA1, outputQueuesUser);
-    pool.addTask([&filterUser]() {
-        filterUser.filterByColumn("type", string("User"), CompareOperation::EQUAL);
-    });
+    handlerTasks.push_back({&filterUser, viewNode, [&filterUser]() {
+        return filterUser.filterByColumnAsync("type", string("User"), CompareOperation::EQUAL);
+    }});
 
     Queue<DataFrame*> queueView(maxQueueSize);
     Queue<DataFrame*> queueView1(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesView = {&queueView, &queueView1};
     FilterHandler filterView(&queueUser, outputQueuesView);
-    pool.addTask([&filterView]() {
-        filterView.filterByColumn("extra_1", string("ZOOM"), CompareOperation::EQUAL);
-    });
+    handlerTasks.push_back({&filterView, viewNode, [&filterView]() {
+        return filterView.filterByColumnAsync("extra_1", string("ZOOM"), CompareOperation::EQUAL);
+    }});
 
     Queue<DataFrame*> queueCountView(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesCountView = {&queueCountView};
     CountLinesHandler CountView(&queueView, outputQueuesCountView);
-    pool.addTask([&CountView]() {
-        CountView.countLines();
-    });
+    handlerTasks.push_back({&CountView, viewNode, [&CountView]() {
+        return CountView.countLinesAsync();
+    }});
     
 
     // Número de produtos comprados por minuto:
     Queue<DataFrame*> queueAuditoria(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesAuditoria = {&queueAuditoria};
     FilterHandler FilterAuditoria(&queueCA2, outputQueuesAuditoria);
-    pool.addTask([&FilterAuditoria]() {
-        FilterAuditoria.filterByColumn("type", string("Audit"), CompareOperation::EQUAL);
-    });
+    handlerTasks.push_back({&FilterAuditoria, buyNode, [&FilterAuditoria]() {
+        return FilterAuditoria.filterByColumnAsync("type", string("Audit"), CompareOperation::EQUAL);
+    }});
 
 
     Queue<DataFrame*> queueBuy(maxQueueSize);
@@ -68,16 +123,16 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     Queue<DataFrame*> queueBuy2(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesBuy = {&queueBuy, &queueBuy1};
     FilterHandler filterBuy(&queueAuditoria, outputQueuesBuy);
-    pool.addTask([&filterBuy]() {
-        filterBuy.filterByColumn("extra_1", string("BUY"), CompareOperation::EQUAL);
-    });
+    handlerTasks.push_back({&filterBuy, buyNode, [&filterBuy]() {
+        return filterBuy.filterByColumnAsync("extra_1", string("BUY"), CompareOperation::EQUAL);
+    }});
 
     Queue<DataFrame*> queueCountBuy(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesCountBuy = {&queueCountBuy};
     CountLinesHandler CountBuy(&queueBuy, outputQueuesCountBuy);
-    pool.addTask([&CountBuy]() {
-        CountBuy.countLines();
-    });
+    handlerTasks.push_back({&CountBuy, buyNode, [&CountBuy]() {
+        return CountBuy.countLinesAsync();
+    }});
 
 
     // Número de usuários únicos visualizando cada produto por minuto
@@ -85,9 +140,9 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     Queue<DataFrame*> queueProdView1(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesProdView = {&queueProdView, &queueProdView1};
     ValueCountHandler ProdView(&queueView1, outputQueuesProdView);
-    pool.addTask([&ProdView]() {
-        ProdView.countByColumn("extra_2");
-    });
+    handlerTasks.push_back({&ProdView, viewNode, [&ProdView]() {
+        return ProdView.countByColumnAsync("extra_2");
+    }});
 
 
 
@@ -95,25 +150,25 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     Queue<DataFrame*> queueProdBuy(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesProdBuy = {&queueProdBuy};
     ValueCountHandler ProdBuy(&queueBuy1, outputQueuesProdBuy);
-    pool.addTask([&ProdBuy]() {
-        ProdBuy.countByColumn("extra_2");
-    });
+    handlerTasks.push_back({&ProdBuy, buyNode, [&ProdBuy]() {
+        return ProdBuy.countByColumnAsync("extra_2");
+    }});
 
     Queue<DataFrame*> queueBuyRanking(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesBuyRanking = {&queueBuyRanking};
     SortHandler SortBuy(&queueProdBuy, outputQueuesBuyRanking);
-    pool.addTask([&SortBuy]() {
-        SortBuy.sortByColumn("Count");
-    });
+    handlerTasks.push_back({&SortBuy, buyNode, [&SortBuy]() {
+        return SortBuy.sortByColumnAsync("Count");
+    }});
 
 
     // Ranking de produtos mais visualizados na última hora
     Queue<DataFrame*> queueViewRanking(maxQueueSize);
     vector<Queue<DataFrame*>*> outputQueuesViewRanking = {&queueViewRanking};
     SortHandler SortView(&queueProdView1, outputQueuesViewRanking);
-    pool.addTask([&SortView]() {
-        SortView.sortByColumn("Count");
-    });
+    handlerTasks.push_back({&SortView, viewNode, [&SortView]() {
+        return SortView.sortByColumnAsync("Count");
+    }});
 
     // Quantidade média de visualizações de um produto antes de efetuar uma compra
     // Queue<DataFrame*> queueViewBuy(maxQueueSize);
@@ -139,6 +194,7 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     DataFrame* result_dataframes[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
     mutex result_mutexes[5];
     DataFrame* dataframe_times[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
+    int outputNodes[5] = {viewNode, buyNode, viewNode, buyNode, viewNode};
 
     // Tasks to merge the dataframes in the output queues into the result dataframes
     for (int i = 0; i < 5; i++) {
@@ -146,87 +202,116 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
         DataFrame** dataframe_time = &dataframe_times[i];
         Queue<DataFrame*>* outputQueue = outputQueuesPipeline[i];
         mutex* result_mutex = &result_mutexes[i];
+        outputQueue->addConsumer();
 
-        pool.addTask([outputQueue, result_dataframe, dataframe_time, result_mutex]() {
-            // Wait for the output queue to have data
-            if (outputQueue->isEmpty()) return;
-
-            
-            // Merge the dataframes in the output queue with the result dataframe
-            while (!outputQueue->isEmpty()) {
-                DataFrame* df = outputQueue->pop();
-
-                {
-                    lock_guard<mutex> lock(*result_mutex);
-
-                    // If the result dataframe is empty, set it to the first dataframe in the queue
-                    if (*result_dataframe == nullptr) 
-                    {
-                        *result_dataframe = df;
-                        
-                        // Create a new dataframe with the time difference of the first dataframe
-                        *dataframe_time = new DataFrame({"time"});
-
-                        long long timestamp = (*result_dataframe)->getTimestamp();
-                        long long current_timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
-                        
-                        // Add the time difference to the dataframe beetwen current timestamp and its timestamp
-                        (*dataframe_time)->addRow(current_timestamp - timestamp);
-                    }
-                    else 
-                    {
-                        // If the dataframe has only one column, sum the values else merge the dataframes
-                        if (df->getColumnCount() == 1) **result_dataframe = DataFrame::mergeAndSum(**result_dataframe, *df, "", "Count");
-                        else **result_dataframe = DataFrame::mergeAndSum(**result_dataframe, *df, "Value", "Count");
-                        
-                        // Add the time difference to the dataframe beetwen current timestamp and its timestamp
-                        long long timestamp = df->getTimestamp();
-                        long long current_timestamp = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
-                        (*dataframe_time)->addRow(current_timestamp - timestamp);
-
-                        // Delete the old DataFrame
-                        delete df;
+        handlerTasks.push_back({nullptr, outputNodes[i], [outputQueue, result_dataframe, dataframe_time, result_mutex]() {
+            return mergeResults(outputQueue, result_dataframe, dataframe_time, result_mutex);
+        }});
+    }
+
+    // The heavier stages may run more coroutines while their input backs up. Their queues keep the mode
+    // for several producers and consumers, so the light stages are left on a single thread.
+    const int MAX_REPLICAS = 2;
+    for (DataHandler* handler : vector<DataHandler*>{&filterUser, &FilterAuditoria, &ProdView, &ProdBuy, &SortBuy, &SortView}) {
+        handler->setMaxReplicas(MAX_REPLICAS);
+    }
+
+    // Queues with a single producer and a single consumer switch to the cheaper single producer mode
+    vector<Queue<DataFrame*>*> pipelineQueues = {&queueCA1, &queueCA2, &queueUser, &queueView, &queueView1, &queueCountView,
+                                                 &queueAuditoria, &queueBuy, &queueBuy1, &queueCountBuy, &queueProdView,
+                                                 &queueProdView1, &queueProdBuy, &queueBuyRanking, &queueViewRanking};
+    int singleProducerQueues = 0;
+    for (auto* queue : pipelineQueues) {
+        if (queue->seal()) singleProducerQueues++;
+    }
+    cout << "Single producer queues: " << singleProducerQueues << " of " << pipelineQueues.size() << endl;
+
+    // The stages hold no thread while they wait on their queues, so they all share the threads of the pool
+    ThreadPool pool(numThreads, AffinityPolicy::Node);
+    StageSupervisor supervisor(pool, numThreads);
+    vector<Future<void>> stages;
+    for (auto& [handler, node, task] : handlerTasks) {
+        // A large batch is split into morsels of rows that run on the threads of the node of the stage
+        if (handler != nullptr) handler->setMorselExecutor(MorselExecutor(pool.getExecutor(node), pool.getThreadCount()));
+        stages.push_back(pool.spawn(task(), node));
+        if (handler != nullptr && handler->getMaxReplicas() > 0) {
+            // A replica that fails stops the stage, whose main run throws its exception. A replica that fails
+            // after the main run ended is reported here
+            supervisor.addStage(handler, [&pool, task = task, node = node]() {
+                Future<void> replica = pool.spawn(task(), node);
+                replica.onReady([replica]() {
+                    try {
+                        replica.get();
+                    } catch (const exception& e) {
+                        cerr << "Pipeline stage replica failed: " << e.what() << endl;
                     }
-                }
-            }
-        });
+                });
+            }, node);
+        }
     }
+    supervisor.start();
+
+    // The pipeline is drained once every stage saw the end of its input stream
+    Future<void> drained = whenAll(stages);
 
     // Vector of file names and which trigger activates them
     vector<string> fileNames = {"CountView.csv", "CountBuy.csv", "ProdView.csv", "BuyRanking.csv", "ViewRanking.csv"};
     vector<string> triggeredBy = {"Min", "Min", "Min", "Hour", "Hour"};
 
+    // Results served from memory, under the names of their files
+    vector<string> resultNames = {"CountView", "CountBuy", "ProdView", "BuyRanking", "ViewRanking"};
+    if (resultStore != nullptr) {
+        for (int i = 0; i < 5; i++) {
+            resultStore->addResult(resultNames[i], &result_dataframes[i], &result_mutexes[i]);
+            resultStore->addResult("times_" + resultNames[i], &dataframe_times[i], &result_mutexes[i]);
+        }
+    }
+
     // Triggers to activate the DataRepos
     int MIN = 5;
     int HOUR = 10;
 
-    Trigger* triggerMin = new TimerTrigger(std::chrono::seconds(MIN));
-    Trigger* triggerHour = new TimerTrigger(std::chrono::seconds(HOUR));
+    // Both triggers share one timer thread, and write their results from the threads of the pool
+    auto triggerMin = std::make_unique<TimerTrigger>(std::chrono::seconds(MIN));
+    auto triggerHour = std::make_unique<TimerTrigger>(std::chrono::seconds(HOUR));
+    triggerMin->setExecutor(pool.getExecutor());
+    triggerHour->setExecutor(pool.getExecutor());
 
+    // Single writer thread for all the results, so the triggers never wait on disk
+    auto resultWriter = std::make_shared<AsyncResultWriter>();
 
     // ------------------THE ERROR IS HERE------------------
-    // Create a DataRepo for each pipeline
+    // Create a DataRepo for each pipeline. The triggers notify the same repositories, which take the last
+    // window once the pipeline is drained
+    vector<shared_ptr<DataRepo>> dataRepos;
     for (int i = 0; i < 5; i++) {
         // Create a DataRepo for each result dataframe
-        DataRepo* dataRepo = new DataRepo();
+        auto dataRepo = std::make_shared<DataRepo>();
         dataRepo->setExtractDf(&result_dataframes[i], &result_mutexes[i]);
         dataRepo->setLoadStrategy("csv");
         dataRepo->setLoadFileName("../processed/" + fileNames[i]);
+        dataRepo->setAsyncWriter(resultWriter);
+        if (resultStore != nullptr) dataRepo->setResultStore(resultStore, resultNames[i]);
 
         // Create a DataRepo for each time dataframe
-        DataRepo* dataRepoTime = new DataRepo();
+        auto dataRepoTime = std::make_shared<DataRepo>();
         dataRepoTime->setExtractDf(&dataframe_times[i], &result_mutexes[i]);
         dataRepoTime->setLoadStrategy("csv");
         dataRepoTime->setLoadFileName("../processed/times_" + fileNames[i]);
+        dataRepoTime->setAsyncWriter(resultWriter);
+        if (resultStore != nullptr) dataRepoTime->setResultStore(resultStore, "times_" + resultNames[i]);
 
-        // Set the trigger for each pipeline
+        // Set the trigger for each pipeline. Each DataRepo writes on its own, and is reported when its
+        // write takes longer than the period of its trigger
         if (triggeredBy[i] == "Min") {
-            triggerMin->addObserver(std::make_shared<DataRepo>(*dataRepo));
-            triggerMin->addObserver(std::make_shared<DataRepo>(*dataRepoTime));
+            triggerMin->addObserver(dataRepo, std::chrono::seconds(MIN));
+            triggerMin->addObserver(dataRepoTime, std::chrono::seconds(MIN));
         } else if (triggeredBy[i] == "Hour") {
-            triggerHour->addObserver(std::make_shared<DataRepo>(*dataRepo));
-            triggerHour->addObserver(std::make_shared<DataRepo>(*dataRepoTime));
+            triggerHour->addObserver(dataRepo, std::chrono::seconds(HOUR));
+            triggerHour->addObserver(dataRepoTime, std::chrono::seconds(HOUR));
         }
+        dataRepos.push_back(dataRepo);
+        dataRepos.push_back(dataRepoTime);
     }
 
     
@@ -234,13 +319,38 @@ int process(Queue<DataFrame*>* queueCA, int maxQueueSize, int numThreads){
     triggerHour->activate();
     triggerMin->activate();
 
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::hours(1));
+    try {
+        drained.get();
+    } catch (const exception& e) {
+        cerr << "Pipeline stage failed: " << e.what() << endl;
     }
 
+    supervisor.stop();
     triggerHour->deactivate();
     triggerMin->deactivate();
 
+    // Time spent by the DataRepos on the ticks of the triggers
+    for (Trigger* trigger : {triggerMin.get(), triggerHour.get()}) {
+        for (const auto& metrics : trigger->getObserverMetrics()) {
+            cout << "Observer: " << metrics.notifications << " writes, " << metrics.skipped << " skipped, "
+                 << metrics.timeouts << " timeouts, longest " << metrics.maxDuration.count() << " us" << endl;
+        }
+    }
+
+    // The window still open when the input ended is written too, before the writer is left
+    for (auto& dataRepo : dataRepos) {
+        dataRepo->updateOnTimeTrigger();
+    }
+    resultWriter->flush();
+
+    // The live results are on the stack of this function, so the store keeps only their closed windows
+    if (resultStore != nullptr) {
+        for (int i = 0; i < 5; i++) {
+            resultStore->detachLive(resultNames[i]);
+            resultStore->detachLive("times_" + resultNames[i]);
+        }
+    }
+
     return 0;
 }
 
@@ -1,7 +1,14 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
 #include "pipeline.cpp"
+#include "BatchCoalescer.hpp"
+#include "AdmissionController.hpp"
+#include "ResultStore.hpp"
 
 #include <grpcpp/grpcpp.h>
 #include "data_analytics.grpc.pb.h"
@@ -12,71 +19,484 @@ using grpc::ServerContext;
 using grpc::Status;
 using data_analytics_package::Empty;
 using data_analytics_package::logdataanalyticsWithTime;
+using data_analytics_package::ColumnarReport;
+using data_analytics_package::ReportChunk;
+using data_analytics_package::ReportAck;
 using data_analytics_package::SimulationServiceStream;
+using data_analytics_package::QueryRequest;
+using data_analytics_package::QueryResponse;
+using data_analytics_package::QueryService;
 
-class SimulationServiceStreamImpl final : public SimulationServiceStream::Service {
-public:
-  SimulationServiceStreamImpl(Queue<DataFrame*>* queue) : queue(queue) {
-    // Create a data repo object
-    std::unique_ptr<DataRepo> data_repo = std::make_unique<DataRepo>();
+// Text of the enum values as they appear in the log lines, indexed by value
+const std::vector<std::string> EVENT_TYPE_NAMES = {"", "User", "Audit", "Error"};
+const std::vector<std::string> ACTION_NAMES = {"", "ZOOM", "CLICK", "SCROLLING", "LOGIN", "BUY", "EXIT"};
 
-    // Set extract strategy to "list"
-    data_repo->setExtractionStrategy("list");
+// Convert an enum column of a columnar report into its text values
+std::vector<std::string> decodeEnumColumn(const google::protobuf::RepeatedField<int>& values,
+                                          const std::vector<std::string>& names, int rows, const std::string& column) {
+  if (values.size() != rows) throw std::runtime_error("Column " + column + " does not match the row count");
 
-    this->data_repo = *data_repo;
+  std::vector<std::string> decoded;
+  decoded.reserve(rows);
+  for (int value : values) {
+    if (value < 0 || value >= static_cast<int>(names.size())) {
+      throw std::runtime_error("Unknown value " + std::to_string(value) + " in column " + column);
+    }
+    decoded.push_back(names[value]);
   }
+  return decoded;
+}
 
-  Status ReportCycle(ServerContext* context, const logdataanalyticsWithTime* request, Empty* reply) override {
-    std::cout << "Received report at timestamp: " << request->timestamp() << std::endl;
-    
-    // Create a vector of strings from the request
-    std::vector<std::string> data;
-    for (const auto& log_entry : request->log()) {
-      // Store the log entry in the vector (removing the '\n' character at the end of the string)
-      data.push_back(log_entry.substr(0, log_entry.size() - 1));
-    } 
+// Convert a string column of a columnar report, sent plain or as dictionary indexes, into its values
+std::vector<std::string> decodeStringColumn(const google::protobuf::RepeatedPtrField<std::string>& values,
+                                            const google::protobuf::RepeatedField<uint32_t>& indexes,
+                                            const google::protobuf::RepeatedPtrField<std::string>& dictionary,
+                                            int rows, const std::string& column) {
+  if (dictionary.empty()) {
+    if (values.size() != rows) throw std::runtime_error("Column " + column + " does not match the row count");
+    return std::vector<std::string>(values.begin(), values.end());
+  }
 
-    // Convert vector of strings to a dataframe
-    DataFrame* df = data_repo.extractData("", ';', 0, data);
+  if (indexes.size() != rows) throw std::runtime_error("Column " + column + " does not match the row count");
 
-    // Set the timestamp of the dataframe
-    df->setTimestamp(request->timestamp());
+  std::vector<std::string> decoded;
+  decoded.reserve(rows);
+  for (uint32_t index : indexes) {
+    if (index >= static_cast<uint32_t>(dictionary.size())) {
+      throw std::runtime_error("Dictionary index out of range in column " + column);
+    }
+    decoded.push_back(dictionary[index]);
+  }
+  return decoded;
+}
 
-    // Add dataframe to the queue
-    queue->push(df);
+// Map a columnar report straight into the columns of a dataframe, with the same columns as the log lines
+DataFrame* columnarReportToDataFrame(const ColumnarReport& report) {
+  if (report.version() != ColumnarReport::VERSION_1) {
+    throw std::runtime_error("Unsupported report version " + std::to_string(report.version()));
+  }
 
-    return Status::OK;
+  int rows = report.event_timestamp_size();
+  std::vector<long long> timestamps(report.event_timestamp().begin(), report.event_timestamp().end());
+  std::vector<std::string> types = decodeEnumColumn(report.type(), EVENT_TYPE_NAMES, rows, "type");
+  std::vector<std::string> actions = decodeEnumColumn(report.action(), ACTION_NAMES, rows, "action");
+  std::vector<std::string> contents = decodeStringColumn(report.content(), report.content_index(), report.content_dictionary(), rows, "content");
+  std::vector<std::string> products = decodeStringColumn(report.product(), report.product_index(), report.product_dictionary(), rows, "product");
+
+  DataFrame* df = new DataFrame({"timestamp", "type", "content", "extra_1", "extra_2"});
+  if (rows > 0) {
+    df->setColumnData(0, std::move(timestamps));
+    df->setColumnData(1, std::move(types));
+    df->setColumnData(2, std::move(contents));
+    df->setColumnData(3, std::move(actions));
+    df->setColumnData(4, std::move(products));
   }
 
-private:
+  // Set the timestamp of the dataframe
+  df->setTimestamp(report.timestamp());
+  return df;
+}
+
+// Convert the log entries of a report to a dataframe, parsing them in place (the '\n' at the end of each entry is ignored)
+DataFrame* logReportToDataFrame(const logdataanalyticsWithTime& report) {
   DataRepo data_repo;
+  data_repo.setExtractionStrategy("list");
+
+  DataFrame* df = data_repo.extractLines(report.log(), ';');
+  if (df == nullptr) throw std::runtime_error("Empty report");
+
+  // Set the timestamp of the dataframe
+  df->setTimestamp(report.timestamp());
+  return df;
+}
+
+// Convert a report of a stream, in either format, to a dataframe
+DataFrame* reportChunkToDataFrame(const ReportChunk& chunk) {
+  if (chunk.has_columnar_report()) return columnarReportToDataFrame(chunk.columnar_report());
+  if (chunk.has_log_report()) return logReportToDataFrame(chunk.log_report());
+  throw std::runtime_error("Empty report chunk");
+}
+
+// Shared state of the calls: where the reports are parsed and where the dataframes go
+struct IngestContext {
+  SimulationServiceStream::AsyncService* service;
+  ThreadPool* workers;
   Queue<DataFrame*>* queue;
+  BatchCoalescer* coalescer;
+  AdmissionController* admission;
+  std::chrono::milliseconds pushTimeout; // Longest wait of a worker on the full queue before the report is rejected
+};
+
+// Reject a report because the pipeline is behind, telling the client when to retry
+Status RejectReport(ServerContext* context, const AdmissionDecision& decision) {
+  context->AddTrailingMetadata("retry-after-ms", std::to_string(decision.retryAfterMs));
+  return Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Pipeline is behind, retry after " + std::to_string(decision.retryAfterMs) + " ms");
+}
+
+// State machine of a call, driven by the events of its completion queue
+class CallData {
+public:
+  virtual ~CallData() = default;
+
+  // Advance the call after one of its operations completed
+  virtual void proceed(bool ok) = 0;
 };
 
-void RunServer(int num_threads, int max_queue_size) {
+// Unary report call: the request is parsed by a worker, which then queues the dataframe and finishes the call,
+// so the completion queue threads never parse or wait on the queue
+template <typename Request>
+class ReportCallData final : public CallData {
+public:
+  using RequestFunction = std::function<void(ServerContext*, Request*, grpc::ServerAsyncResponseWriter<ReportAck>*,
+                                             grpc::ServerCompletionQueue*, void*)>;
+  using ConvertFunction = DataFrame* (*)(const Request&);
+
+  ReportCallData(IngestContext* ingest, grpc::ServerCompletionQueue* cq, RequestFunction requestCall, ConvertFunction convert)
+      : ingest(ingest), cq(cq), requestCall(requestCall), convert(convert), responder(&context) {
+    // Wait for the next call of this method
+    requestCall(&context, &request, &responder, cq, this);
+  }
+
+  void proceed(bool ok) override {
+    // The call was finished, or the server is shutting down
+    if (finished || !ok) {
+      delete this;
+      return;
+    }
+
+    // Be ready for the next call before handling this one
+    new ReportCallData(ingest, cq, requestCall, convert);
+
+    // Reject the report at once when the pipeline is behind, instead of blocking on the full queue
+    AdmissionDecision decision = ingest->admission->admit(request.ByteSizeLong());
+    if (!decision.admitted) {
+      finished = true;
+      responder.Finish(reply, RejectReport(&context, decision), this);
+      return;
+    }
+    reply.set_credits(decision.credits);
+    reply.set_retry_after_ms(decision.retryAfterMs);
+
+    ingest->workers->execute([this] {
+      std::cout << "Received report at timestamp: " << request.timestamp() << std::endl;
+
+      Status status = Status::OK;
+      DataFrame* df = nullptr;
+      try {
+        df = convert(request);
+
+        // The queue may fill up after the admission, so the worker waits a bounded time and then rejects the report
+        if (ingest->queue->tryPushFor(df, ingest->pushTimeout)) {
+          ingest->admission->release();
+        } else {
+          delete df;
+          status = RejectReport(&context, ingest->admission->reject());
+        }
+      } catch (const std::exception& e) {
+        delete df;
+        ingest->admission->release();
+        status = Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+      }
+
+      // The completion of Finish deletes the call, so it is the last use of this
+      finished = true;
+      responder.Finish(reply, status, this);
+    });
+  }
+
+private:
+  IngestContext* ingest;
+  grpc::ServerCompletionQueue* cq;
+  RequestFunction requestCall;
+  ConvertFunction convert;
+  ServerContext context;
+  Request request;
+  ReportAck reply;
+  grpc::ServerAsyncResponseWriter<ReportAck> responder;
+  bool finished = false;
+};
+
+// Streaming report call: each report read is parsed by a worker and added to the batches, while the next one is read.
+// The call is finished once the client closed the stream and all its reports were parsed.
+class StreamCallData final : public CallData {
+public:
+  StreamCallData(IngestContext* ingest, grpc::ServerCompletionQueue* cq) : ingest(ingest), cq(cq), reader(&context) {
+    // Wait for the next stream
+    ingest->service->RequestStreamReportCycle(&context, &reader, cq, cq, this);
+  }
+
+  void proceed(bool ok) override {
+    switch (state) {
+      case State::WAITING:
+        if (!ok) {
+          delete this;
+          return;
+        }
+
+        // Be ready for the next stream before reading this one
+        new StreamCallData(ingest, cq);
+        std::cout << "Report stream opened by " << context.peer() << std::endl;
+
+        state = State::READING;
+        reader.Read(&chunk, this);
+        break;
+
+      case State::READING: {
+        if (!ok) {
+          // The client closed the stream
+          bool finish;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            readDone = true;
+            finish = pendingReports == 0;
+          }
+          if (finish) this->finish();
+          return;
+        }
+
+        // Stop reading when the pipeline is behind, and end the stream with the retry hint and the number of
+        // reports taken, so the client sends the others again
+        AdmissionDecision decision = ingest->admission->admit(chunk.ByteSizeLong());
+        if (!decision.admitted) {
+          bool finish;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (status.ok()) {
+              context.AddTrailingMetadata("accepted-reports", std::to_string(acceptedReports));
+              status = RejectReport(&context, decision);
+            }
+            readDone = true;
+            finish = pendingReports == 0;
+          }
+          if (finish) this->finish();
+          return;
+        }
+
+        // Hand the report to a worker and read the next one into a fresh message
+        auto received = std::make_shared<ReportChunk>(std::move(chunk));
+        chunk.Clear();
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          pendingReports++;
+          acceptedReports++;
+          reply.set_credits(decision.credits);
+          reply.set_retry_after_ms(decision.retryAfterMs);
+        }
+        ingest->workers->execute([this, received] { parse(*received); });
+
+        reader.Read(&chunk, this);
+        break;
+      }
+
+      case State::FINISHING:
+        std::cout << "Report stream closed by " << context.peer() << std::endl;
+        delete this;
+        break;
+    }
+  }
+
+private:
+  enum class State { WAITING, READING, FINISHING };
+
+  IngestContext* ingest;
+  grpc::ServerCompletionQueue* cq;
+  ServerContext context;
+  ReportChunk chunk;
+  ReportAck reply;
+  grpc::ServerAsyncReader<ReportAck, ReportChunk> reader;
+  State state = State::WAITING;
+
+  std::mutex mutex;
+  int pendingReports = 0; // Reports handed to the workers and not parsed yet
+  int acceptedReports = 0; // Reports admitted since the stream opened
+  bool readDone = false;
+  Status status = Status::OK; // Failure of the first report that could not be parsed
+
+  // Parse a report in a worker and add it to the batches
+  void parse(const ReportChunk& report) {
+    bool failed;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      failed = !status.ok();
+    }
+
+    // The reports after a failure are discarded, as the stream ends with the error
+    if (!failed) {
+      try {
+        ingest->coalescer->add(reportChunkToDataFrame(report));
+      } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status.ok()) status = Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+      }
+    }
+    ingest->admission->release();
+
+    bool finish;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pendingReports--;
+      finish = readDone && pendingReports == 0;
+    }
+    if (finish) this->finish();
+  }
+
+  // Finish the call. The completion of Finish deletes the call, so it is the last use of this
+  void finish() {
+    state = State::FINISHING;
+    reader.Finish(reply, status, this);
+  }
+};
+
+// Query call: answered on the completion queue thread, as the aggregates are read from memory in microseconds
+class QueryCallData final : public CallData {
+public:
+  QueryCallData(QueryService::AsyncService* service, ResultStore* store, grpc::ServerCompletionQueue* cq)
+      : service(service), store(store), cq(cq), responder(&context) {
+    // Wait for the next query
+    service->RequestQuery(&context, &request, &responder, cq, cq, this);
+  }
+
+  void proceed(bool ok) override {
+    // The call was finished, or the server is shutting down
+    if (finished || !ok) {
+      delete this;
+      return;
+    }
+
+    // Be ready for the next query before answering this one
+    new QueryCallData(service, store, cq);
+
+    Status status = Status::OK;
+    try {
+      ResultQuery query;
+      query.topK = std::max(0, request.top_k());
+      query.fromMs = request.from_timestamp();
+      query.toMs = request.to_timestamp();
+      ResultSnapshot snapshot = store->query(request.result(), query);
+
+      for (size_t i = 0; i < snapshot.values.size(); i++) {
+        reply.add_value(snapshot.values[i]);
+        reply.add_count(snapshot.counts[i]);
+      }
+      reply.set_total(snapshot.total);
+      reply.set_windows(snapshot.windows);
+
+      auto* latency = reply.mutable_latency();
+      latency->set_samples(snapshot.latency.samples);
+      latency->set_mean(snapshot.latency.mean);
+      latency->set_p50(snapshot.latency.p50);
+      latency->set_p90(snapshot.latency.p90);
+      latency->set_p99(snapshot.latency.p99);
+      latency->set_max(snapshot.latency.max);
+    } catch (const std::exception& e) {
+      status = Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+    }
+
+    // The completion of Finish deletes the call
+    finished = true;
+    responder.Finish(reply, status, this);
+  }
+
+private:
+  QueryService::AsyncService* service;
+  ResultStore* store;
+  grpc::ServerCompletionQueue* cq;
+  ServerContext context;
+  QueryRequest request;
+  QueryResponse reply;
+  grpc::ServerAsyncResponseWriter<QueryResponse> responder;
+  bool finished = false;
+};
+
+// Loop of a completion queue thread: drive the calls of the queue until it is shut down
+void HandleCalls(grpc::ServerCompletionQueue* cq) {
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+    static_cast<CallData*>(tag)->proceed(ok);
+  }
+}
+
+void RunServer(int num_threads, int max_queue_size, int num_cq_threads, int num_ingest_workers,
+               size_t batch_rows, std::chrono::milliseconds batch_delay,
+               size_t memory_budget, std::chrono::milliseconds retry_after) {
   // Create a queue of dataframes
   Queue<DataFrame*> queue(max_queue_size);
-  
+
+  // Reports received through streams are coalesced into batches of up to batch_rows rows. A worker waits for
+  // room in the queue as long as a unary report does, and then leaves the batch to the flusher thread
+  BatchCoalescer coalescer(&queue, batch_rows, batch_delay, retry_after);
+
+  // Reports are only accepted while the queue and the memory budget have room. The pending batch of the
+  // coalescer counts as one queued DataFrame
+  AdmissionController admission(&queue, memory_budget, retry_after);
+  admission.setCoalescer(&coalescer);
+
+  // Workers that parse the reports and wait on the queue, instead of the completion queue threads
+  ThreadPool workers(num_ingest_workers);
+
   std::string server_address("0.0.0.0:50051");
-  SimulationServiceStreamImpl service(&queue);
+  SimulationServiceStream::AsyncService service;
+  // A report admitted while the queue had room waits for it at most as long as a rejected client would
+  IngestContext ingest = {&service, &workers, &queue, &coalescer, &admission, retry_after};
+
+  // Results of the pipeline, queried from memory by the dashboard
+  ResultStore results;
+  QueryService::AsyncService query_service;
 
   ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
   builder.RegisterService(&service);
+  builder.RegisterService(&query_service);
+
+  // One completion queue per thread
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs;
+  for (int i = 0; i < num_cq_threads; i++) {
+    cqs.push_back(builder.AddCompletionQueue());
+  }
+
   std::unique_ptr<Server> server(builder.BuildAndStart());
-  std::cout << "Server listening on " << server_address << std::endl;
+  std::cout << "Server listening on " << server_address << " with " << num_cq_threads << " completion queue threads" << std::endl;
+
+  // Wait for the first call of each method on every completion queue
+  std::vector<std::thread> cq_threads;
+  for (auto& cq : cqs) {
+    new ReportCallData<logdataanalyticsWithTime>(&ingest, cq.get(),
+        [&service](ServerContext* context, logdataanalyticsWithTime* request, grpc::ServerAsyncResponseWriter<ReportAck>* responder,
+                   grpc::ServerCompletionQueue* cq, void* tag) {
+          service.RequestReportCycle(context, request, responder, cq, cq, tag);
+        }, logReportToDataFrame);
+    new ReportCallData<ColumnarReport>(&ingest, cq.get(),
+        [&service](ServerContext* context, ColumnarReport* request, grpc::ServerAsyncResponseWriter<ReportAck>* responder,
+                   grpc::ServerCompletionQueue* cq, void* tag) {
+          service.RequestReportCycleColumnar(context, request, responder, cq, cq, tag);
+        }, columnarReportToDataFrame);
+    new StreamCallData(&ingest, cq.get());
+    new QueryCallData(&query_service, &results, cq.get());
+
+    cq_threads.emplace_back(HandleCalls, cq.get());
+  }
 
   // Process the pipeline
-  process(&queue, max_queue_size, num_threads);
+  process(&queue, max_queue_size, num_threads, &results);
 
-  server->Wait();
+  server->Shutdown();
+  for (auto& cq : cqs) cq->Shutdown();
+  for (auto& thread : cq_threads) thread.join();
 }
 
 int main(int argc, char** argv) {
   int NUM_THREADS = 8;
   int MAX_QUEUE_SIZE = 20;
+  int NUM_CQ_THREADS = 2;
+  int NUM_INGEST_WORKERS = 4;
+  size_t BATCH_ROWS = 5000;
+  std::chrono::milliseconds BATCH_DELAY(200);
+  size_t MEMORY_BUDGET = 256 * 1024 * 1024;
+  std::chrono::milliseconds RETRY_AFTER(100);
 
-  RunServer(NUM_THREADS, MAX_QUEUE_SIZE);
+  RunServer(NUM_THREADS, MAX_QUEUE_SIZE, NUM_CQ_THREADS, NUM_INGEST_WORKERS, BATCH_ROWS, BATCH_DELAY,
+            MEMORY_BUDGET, RETRY_AFTER);
   return 0;
 }
 
@@ -10,12 +10,31 @@ class SimulationServiceStreamServicer(data_analytics_pb2_grpc.SimulationServiceS
     def ReportCycle(self, request, context):
         print("Received log data:")
         print("Timestamp:", request.timestamp)
-        return data_analytics_pb2.Empty()
+        return data_analytics_pb2.ReportAck()
+
+    def ReportCycleColumnar(self, request, context):
+        print("Received columnar log data:")
+        print("Timestamp:", request.timestamp)
+        print("Events:", len(request.event_timestamp))
+        return data_analytics_pb2.ReportAck()
+
+    def StreamReportCycle(self, request_iterator, context):
+        for chunk in request_iterator:
+            report = chunk.log_report if chunk.HasField("log_report") else chunk.columnar_report
+            print("Received streamed report at timestamp:", report.timestamp)
+        return data_analytics_pb2.ReportAck()
+
+class QueryServiceServicer(data_analytics_pb2_grpc.QueryServiceServicer):
+    def Query(self, request, context):
+        print("Received query for result:", request.result)
+        return data_analytics_pb2.QueryResponse()
 
 def serve():
     server = grpc.server(futures.ThreadPoolExecutor(max_workers=10))
     data_analytics_pb2_grpc.add_SimulationServiceStreamServicer_to_server(
         SimulationServiceStreamServicer(), server)
+    data_analytics_pb2_grpc.add_QueryServiceServicer_to_server(
+        QueryServiceServicer(), server)
     server.add_insecure_port('[::]:123456')
     server.start()
     print("Server started. Listening on port 123456...")
@@ -0,0 +1,80 @@
+#include "../src/AdmissionController.hpp"
+#include <iostream>
+#include <chrono>
+
+int main() {
+    try {
+        Queue<DataFrame*> queue(4);
+
+        // 1 MB of queued reports at most, and a base retry delay of 100 ms
+        AdmissionController admission(&queue, 1 << 20, chrono::milliseconds(100));
+
+        // Admit and queue reports of 10 KB until the queue is full
+        for (int report = 0; report < 4; report++) {
+            AdmissionDecision decision = admission.admit(10 * 1024);
+            cout << "Admitted: " << decision.admitted << ", credits: " << decision.credits
+                 << ", retry after: " << decision.retryAfterMs << " ms" << endl;
+            queue.push(new DataFrame({"timestamp", "type"}));
+            admission.release();
+        }
+        // Output:
+        // Admitted: 1, credits: 3, retry after: 0 ms
+        // Admitted: 1, credits: 2, retry after: 0 ms
+        // Admitted: 1, credits: 1, retry after: 75 ms
+        // Admitted: 1, credits: 0, retry after: 100 ms
+
+        // The queue is full, so the reports are rejected with a growing delay
+        for (int attempt = 0; attempt < 3; attempt++) {
+            AdmissionDecision decision = admission.admit(10 * 1024);
+            cout << "Admitted: " << decision.admitted << ", retry after: " << decision.retryAfterMs << " ms" << endl;
+        }
+        // Output:
+        // Admitted: 0, retry after: 100 ms
+        // Admitted: 0, retry after: 200 ms
+        // Admitted: 0, retry after: 400 ms
+
+        // Once the pipeline drains the queue, reports are admitted again
+        while (queue.size() > 0) delete queue.pop();
+        AdmissionDecision decision = admission.admit(10 * 1024);
+        cout << "Admitted: " << decision.admitted << ", credits: " << decision.credits << endl; // Output: Admitted: 1, credits: 3
+        admission.release();
+
+        // A report larger than the memory budget still enters an empty queue, but not a busy one
+        queue.push(new DataFrame({"timestamp", "type"}));
+        decision = admission.admit(1 << 20);
+        cout << "Large report admitted: " << decision.admitted << endl; // Output: Large report admitted: 0
+        delete queue.pop();
+        decision = admission.admit(1 << 20);
+        cout << "Large report admitted: " << decision.admitted << endl; // Output: Large report admitted: 1
+        admission.release();
+
+        // A report admitted but not queued in time gives its slot back with the retry hint
+        admission.admit(10 * 1024);
+        decision = admission.reject();
+        cout << "Admitted: " << decision.admitted << ", retry after: " << decision.retryAfterMs << " ms, in flight: "
+             << admission.getInFlight() << endl; // Output: Admitted: 0, retry after: 100 ms, in flight: 0
+
+        // The reports waiting in the pending batch of a coalescer take a single slot of the queue
+        BatchCoalescer coalescer(&queue, 1000, chrono::milliseconds(1000));
+        AdmissionController batchAdmission(&queue, 1 << 20, chrono::milliseconds(100));
+        batchAdmission.setCoalescer(&coalescer);
+        int batched = 0;
+        for (int report = 0; report < 10; report++) {
+            decision = batchAdmission.admit(1024);
+            if (!decision.admitted) break;
+            DataFrame* df = new DataFrame({"timestamp", "type"});
+            df->addRow(1715000000000LL + report, string("User"));
+            coalescer.add(df);
+            batchAdmission.release();
+            batched++;
+        }
+        cout << "Reports batched: " << batched << ", credits: " << decision.credits << endl; // Output: Reports batched: 10, credits: 2
+        coalescer.flush();
+        delete queue.pop();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "../src/DataRepo.hpp"
+#include "../src/AsyncWriter.hpp"
+#include <iostream>
+#include <mutex>
+
+int main() {
+    try {
+        // Results shared with the merge tasks, as in the pipeline
+        DataFrame* result = new DataFrame({"Product", "Views"});
+        result->addRow(string("Phone"), 12);
+        result->addRow(string("Laptop"), 7);
+        mutex resultMutex;
+
+        // The DataRepo only takes the DataFrame and hands it to the writer thread
+        auto writer = make_shared<AsyncResultWriter>();
+        DataRepo repo;
+        repo.setLoadStrategy("csv");
+        repo.setLoadFileName("test_async.csv");
+        repo.setExtractDf(&result, &resultMutex);
+        repo.setAsyncWriter(writer);
+
+        repo.updateOnTimeTrigger();
+        cout << "Result reset: " << (result == nullptr ? "yes" : "no") << endl; // Output: Result reset: yes
+
+        // Wait for the file to be published under its final name
+        writer->flush();
+        cout << "Pending snapshots: " << writer->pending() << endl; // Output: Pending snapshots: 0
+
+        DataRepo reader;
+        reader.setExtractionStrategy("csv");
+        DataFrame* loaded = reader.extractData("test_async.csv");
+        loaded->print();
+        delete loaded;
+
+        // A write that fails keeps the last good file and leaves no temporary file behind
+        DataFrame broken({"Product", "Views"});
+        broken.addRow(string("Tablet"), 3);
+        broken.addColumnValue(0, string("Watch"));
+        DataRepo csvRepo;
+        csvRepo.setLoadStrategy("csv");
+        try {
+            csvRepo.loadData(&broken, "test_async.csv");
+        } catch (const std::exception& e) {
+            cout << "Write failed: " << e.what() << endl; // Output: Write failed: Column Product does not match the row count.
+        }
+        ifstream temp("test_async.csv.tmp");
+        cout << "Temporary file left: " << (temp.is_open() ? "yes" : "no") << endl; // Output: Temporary file left: no
+        DataFrame* kept = reader.extractData("test_async.csv");
+        cout << "Rows kept: " << kept->getRowCount() << endl; // Output: Rows kept: 2
+        delete kept;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
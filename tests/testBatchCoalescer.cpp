@@ -0,0 +1,61 @@
+#include "../src/BatchCoalescer.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+int main() {
+    try {
+        Queue<DataFrame*> queue(10);
+
+        // Batches of up to 4 rows, or whatever arrived within 100 ms
+        BatchCoalescer coalescer(&queue, 4, chrono::milliseconds(100));
+
+        // Three small reports of 2 rows each: the first two fill a batch
+        for (int report = 0; report < 3; report++) {
+            DataFrame* df = new DataFrame({"timestamp", "type"});
+            df->addRow(1715000000000LL + report * 2, string("User"));
+            df->addRow(1715000000001LL + report * 2, string("User"));
+            coalescer.add(df);
+        }
+
+        DataFrame* full = queue.pop();
+        cout << "Full batch rows: " << full->getRowCount() << endl; // Output: Full batch rows: 4
+        cout << "Pending rows: " << coalescer.getPendingRows() << endl; // Output: Pending rows: 2
+        cout << "Pending reports: " << coalescer.getPendingReports() << endl; // Output: Pending reports: 1
+        delete full;
+
+        // The last report is pushed once its deadline passes
+        auto start = chrono::steady_clock::now();
+        DataFrame* late = queue.pop();
+        auto waited = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        cout << "Deadline batch rows: " << late->getRowCount() << endl; // Output: Deadline batch rows: 2
+        cout << "Waited less than 200 ms: " << (waited < 200 ? "yes" : "no") << endl; // Output: Waited less than 200 ms: yes
+        late->print();
+        delete late;
+
+        // A full queue holds the caller of add for the push timeout at most, then the batch is deferred
+        Queue<DataFrame*> small(1);
+        small.push(new DataFrame({"timestamp", "type"}));
+        {
+            BatchCoalescer blocked(&small, 1, chrono::milliseconds(100), chrono::milliseconds(20));
+            DataFrame* df = new DataFrame({"timestamp", "type"});
+            df->addRow(1715000000010LL, string("User"));
+            start = chrono::steady_clock::now();
+            blocked.add(df);
+            waited = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            cout << "Add returned within 100 ms: " << (waited < 100 ? "yes" : "no") << endl; // Output: Add returned within 100 ms: yes
+            cout << "Deferred batches: " << blocked.getDeferredBatches() << endl; // Output: Deferred batches: 1
+
+            // The flusher thread pushes the deferred batch once the queue has room
+            delete small.pop();
+            DataFrame* deferred = small.pop();
+            cout << "Deferred batch rows: " << deferred->getRowCount() << endl; // Output: Deferred batch rows: 1
+            delete deferred;
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
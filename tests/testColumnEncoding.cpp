@@ -0,0 +1,82 @@
+#include "../src/DataRepo.hpp"
+#include "../src/ColumnEncoding.hpp"
+#include "../src/ColumnarFile.hpp"
+#include <iostream>
+#include <sys/stat.h>
+
+// Size of a file in bytes
+long fileSize(const string& path) {
+    struct stat statbuf;
+    return stat(path.c_str(), &statbuf) == 0 ? statbuf.st_size : -1;
+}
+
+int main() {
+    try {
+        // Columns shaped like the pipeline outputs: small counts, monotonic timestamps and repeated product ids
+        DataFrame df({"Count", "Timestamp", "Product", "Latency"});
+        for (int i = 0; i < 10000; i++) {
+            df.addRow(i % 7, 1715000000000LL + i * 100, "VIEW_PRODUCT " + to_string(i % 50) + ".", 5);
+        }
+
+        // Encoding chosen for each column from its statistics
+        const char* encodingNames[] = {"PLAIN", "RLE", "DELTA", "BIT_PACKED", "DICTIONARY"};
+        auto count = dynamic_pointer_cast<Series<int>>(df.getColumnPtr("Count"));
+        auto timestamp = dynamic_pointer_cast<Series<long long>>(df.getColumnPtr("Timestamp"));
+        auto product = dynamic_pointer_cast<Series<string>>(df.getColumnPtr("Product"));
+        auto latency = dynamic_pointer_cast<Series<int>>(df.getColumnPtr("Latency"));
+        cout << "Count: " << encodingNames[(int)encoding::chooseEncoding(count->getData())] << endl; // Output: Count: BIT_PACKED
+        cout << "Timestamp: " << encodingNames[(int)encoding::chooseEncoding(timestamp->getData())] << endl; // Output: Timestamp: DELTA
+        cout << "Product: " << encodingNames[(int)encoding::chooseEncoding(product->getData())] << endl; // Output: Product: DICTIONARY
+        cout << "Latency: " << encodingNames[(int)encoding::chooseEncoding(latency->getData())] << endl; // Output: Latency: RLE
+
+        // Round trip of a single column through each integer codec
+        for (ColumnEncoding columnEncoding : {ColumnEncoding::RLE, ColumnEncoding::DELTA, ColumnEncoding::BIT_PACKED}) {
+            vector<uint8_t> block;
+            encoding::encode(timestamp->getData(), columnEncoding, block);
+            vector<long long> decoded = encoding::decode<long long>(block.data(), block.size(), timestamp->size(), columnEncoding);
+            cout << encodingNames[(int)columnEncoding] << ": " << block.size() << " bytes, "
+                 << (decoded == timestamp->getData() ? "round trip ok" : "round trip FAILED") << endl;
+        }
+
+        // Floating point runs keep the sign of zero
+        vector<double> zeros = {0.0, 0.0, -0.0, -0.0, 0.0};
+        vector<uint8_t> zeroBlock;
+        encoding::encode(zeros, ColumnEncoding::RLE, zeroBlock);
+        vector<double> decodedZeros = encoding::decode<double>(zeroBlock.data(), zeroBlock.size(), zeros.size(), ColumnEncoding::RLE);
+        cout << "Zero runs: " << encoding::computeStats(zeros).runs << ", signs:";
+        for (double value : decodedZeros) cout << " " << (signbit(value) ? "-" : "+");
+        cout << endl; // Output: Zero runs: 3, signs: + + - - +
+
+        // Save the DataFrame plain and encoded
+        DataRepo repo;
+        repo.setLoadStrategy("columnar");
+        repo.loadData(&df, "test.col");
+        repo.setLoadStrategy("archive");
+        repo.loadData(&df, "test_archive.col");
+        cout << "Plain file: " << fileSize("test.col") << " bytes" << endl;
+        cout << "Archive file: " << fileSize("test_archive.col") << " bytes" << endl;
+
+        // Read the archive back, decoding each column
+        repo.setExtractionStrategy("archive");
+        DataFrame* loaded = repo.extractData("test_archive.col");
+        loaded->print(0, 4);
+        delete loaded;
+
+        // A constant column encodes to far fewer bytes than it has rows, and still loads
+        DataFrame constant({"Status"});
+        for (int i = 0; i < 200000; i++) {
+            constant.addRow(200);
+        }
+        repo.setLoadStrategy("archive");
+        repo.loadData(&constant, "test_constant.col");
+        cout << "Constant file: " << fileSize("test_constant.col") << " bytes" << endl;
+        DataFrame* constantLoaded = repo.extractData("test_constant.col");
+        cout << "Constant rows: " << constantLoaded->getRowCount() << ", last: " << constantLoaded->getValueAt(199999, 0) << endl; // Output: Constant rows: 200000, last: 200
+        delete constantLoaded;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
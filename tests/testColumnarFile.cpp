@@ -0,0 +1,41 @@
+#include "../src/DataRepo.hpp"
+#include "../src/ColumnarFile.hpp"
+#include <iostream>
+
+int main() {
+    try {
+        // Create a DataFrame with one column of each supported type
+        DataFrame df({"ID", "Timestamp", "Score", "Grade", "Name"});
+        df.addRow(1, 1715000000000LL, 92.5f, 'A', string("Alice"));
+        df.addRow(2, 1715000000100LL, 88.0f, 'B', string("Bob"));
+        df.addRow(3, 1715000000200LL, 79.5f, 'C', string("Charlie"));
+        df.setTimestamp(1715000000000LL);
+        df.print();
+
+        // Save the DataFrame using the columnar loading strategy
+        DataRepo repo;
+        repo.setLoadStrategy("columnar");
+        repo.loadData(&df, "test.col");
+
+        // Read the columns straight from the mapped file, without copying them
+        ColumnarFile file("test.col");
+        cout << "Rows: " << file.getRowCount() << ", columns: " << file.getColumnCount() << endl; // Output: Rows: 3, columns: 5
+        for (long long value : file.getColumn<long long>(1)) {
+            cout << value << " ";
+        }
+        cout << endl; // Output: 1715000000000 1715000000100 1715000000200
+        cout << "Last name: " << file.getStringAt(4, 2) << endl; // Output: Last name: Charlie
+
+        // Read the file back into a DataFrame using the columnar extraction strategy
+        repo.setExtractionStrategy("columnar");
+        DataFrame* loaded = repo.extractData("test.col");
+        loaded->print();
+        loaded->printColumnTypes();
+        delete loaded;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "../src/DataHandler.hpp"
+#include "../src/ThreadPool.hpp"
+#include <iostream>
+#include <memory>
+
+// A stage that adds one to each number, suspended instead of its thread while it waits
+Coroutine<void> addOne(Queue<int>& input, Queue<int>& output) {
+    int value;
+    while (co_await input.popAsync(value)) {
+        co_await output.pushAsync(value + 1);
+    }
+    output.close();
+}
+
+// Sum the numbers until the stream ends
+Coroutine<long> sum(Queue<int>& input) {
+    long total = 0;
+    vector<int> batch;
+    while (co_await input.popBatchAsync(batch, 16)) {
+        for (int value : batch) total += value;
+        batch.clear();
+    }
+    co_return total;
+}
+
+// Await another coroutine and a job of the pool, without blocking the thread
+Coroutine<long> report(Queue<int>& input, ThreadPool& pool) {
+    long total = co_await sum(input);
+    long bonus = co_await pool.submit([] { return 1000L; });
+    co_return total + bonus;
+}
+
+int main() {
+    // 100 stages in a chain, multiplexed over 2 threads
+    const int STAGES = 100;
+    vector<unique_ptr<Queue<int>>> queues;
+    for (int i = 0; i <= STAGES; i++) queues.push_back(make_unique<Queue<int>>(4));
+
+    ThreadPool pool(2); // Output: Number of threads: 2
+    vector<Future<void>> stages;
+    for (int i = 0; i < STAGES; i++) stages.push_back(pool.spawn(addOne(*queues[i], *queues[i + 1])));
+    Future<long> total = pool.spawn(report(*queues[STAGES], pool));
+
+    for (int i = 0; i < 10; i++) queues[0]->push(i);
+    queues[0]->close();
+    whenAll(stages).get();
+    cout << "Total: " << total.get() << endl; // Output: Total: 2045
+
+    // The handlers run as coroutines with the Async version of their methods
+    Queue<DataFrame*> input(4);
+    Queue<DataFrame*> filtered(4);
+    Queue<DataFrame*> counts(32); // Holds all the counts, which are read once the input is pushed
+    vector<Queue<DataFrame*>*> filterOutputs = {&filtered};
+    vector<Queue<DataFrame*>*> countOutputs = {&counts};
+    FilterHandler filter(&input, filterOutputs);
+    CountLinesHandler counter(&filtered, countOutputs);
+
+    Future<void> filtering = pool.spawn(filter.filterByColumnAsync("type", string("User"), CompareOperation::EQUAL));
+    Future<void> counting = pool.spawn(counter.countLinesAsync());
+    for (int i = 0; i < 20; i++) {
+        DataFrame* df = new DataFrame({"type", "value"});
+        df->addRow(string("User"), i);
+        df->addRow(string("Audit"), i);
+        df->addRow(string("User"), i);
+        input.push(df);
+    }
+    input.close();
+
+    int lines = 0;
+    DataFrame* df;
+    while (counts.pop(df)) {
+        lines += any_cast<int>(df->sum("Count"));
+        delete df;
+    }
+    filtering.get();
+    counting.get();
+    cout << "User lines: " << lines << endl; // Output: User lines: 40
+    cout << "Output closed: " << boolalpha << counts.isClosed() << endl; // Output: Output closed: true
+
+    // A transform that throws fails its stage: the frames it held are deleted, its queues are closed and the
+    // exception reaches the Future of the stage
+    Queue<DataFrame*> badInput(4);
+    Queue<DataFrame*> badOutput(4);
+    vector<Queue<DataFrame*>*> badOutputs = {&badOutput};
+    FilterHandler badFilter(&badInput, badOutputs);
+    for (int i = 0; i < 3; i++) {
+        DataFrame* report = new DataFrame({"type"});
+        report->addRow(string("User"));
+        badInput.push(report);
+    }
+    Future<void> failing = pool.spawn(badFilter.filterByColumnAsync("missing", string("User"), CompareOperation::EQUAL));
+    try {
+        failing.get();
+    } catch (const exception& e) {
+        cout << "Stage failed: " << e.what() << endl;
+    }
+    cout << "Input closed: " << badInput.isClosed() << ", output closed: " << badOutput.isClosed()
+         << ", frames left: " << badInput.size() + badOutput.size() << endl; // Output: Input closed: true, output closed: true, frames left: 0
+
+    return 0;
+}
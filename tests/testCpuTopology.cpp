@@ -0,0 +1,41 @@
+#include "../src/ThreadPool.hpp"
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+
+int main() {
+    // Parse the CPU lists of the sysfs cpulist files
+    vector<int> cpus = CpuTopology::parseCpuList("0-3,8-9");
+    for (int cpu : cpus) cout << cpu << " ";
+    cout << endl; // Output: 0 1 2 3 8 9
+
+    // Read a fake sysfs tree with two nodes and a memory-only node
+    filesystem::path root = filesystem::temp_directory_path() / "testCpuTopology";
+    filesystem::remove_all(root);
+    vector<pair<string, string>> nodes = {{"node0", "0-3"}, {"node1", "4-7"}, {"node2", ""}};
+    for (auto& [name, list] : nodes) {
+        filesystem::create_directories(root / name);
+        ofstream(root / name / "cpulist") << list << "\n";
+    }
+
+    CpuTopology topology = CpuTopology::discover(root.string());
+    filesystem::remove_all(root);
+    cout << "Nodes: " << topology.getNodeCount() << endl; // Output: Nodes: 2
+    cout << "Node of CPU 5: " << topology.getNodeOfCpu(5) << endl; // Output: Node of CPU 5: 1
+    cout << "Restricted nodes: " << topology.restrictTo({0, 1}).getNodeCount() << endl; // Output: Restricted nodes: 1
+
+    // A pool with a thread on each of two nodes, both on the CPUs this process may use
+    vector<int> allowed = CpuTopology::system().getCpusByNode();
+    ThreadPool pool(2, AffinityPolicy::Node, CpuTopology({allowed, allowed})); // Output: Number of threads: 2
+    cout << "Pool nodes: " << pool.getNodeCount() << endl; // Output: Pool nodes: 2
+
+    // A task for a node runs on a thread of that node while the node has one free
+    for (int node = 0; node < 2; node++) {
+        int ranOn = pool.submit([&pool] { return pool.getCurrentNode(); }, node).get();
+        cout << "Task for node " << node << " ran on node " << ranOn << endl;
+    }
+    // Output: Task for node 0 ran on node 0
+    // Output: Task for node 1 ran on node 1
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "../src/DataRepo.hpp"
+#include "../src/CsvSerializer.hpp"
+#include <iostream>
+#include <chrono>
+
+int main() {
+    try {
+        // Cells with the delimiter, quotes or line breaks are quoted, the others are copied as is
+        DataFrame df({"Product", "Price", "Stock", "Grade"});
+        df.addRow(string("Phone"), 999.9f, 12, 'A');
+        df.addRow(string("Cable, USB-C"), 9.5f, 300, 'B');
+        df.addRow(string("The \"best\" laptop"), 1999.0f, 3, ',');
+
+        CsvSerializer serializer;
+        cout << serializer.toString(&df);
+        // Output:
+        // Product,Price,Stock,Grade
+        // Phone,999.900024,12,A
+        // "Cable, USB-C",9.500000,300,B
+        // "The ""best"" laptop",1999.000000,3,","
+
+        // Serialize a large ranking table
+        DataFrame ranking({"Product", "Purchases", "Timestamp"});
+        for (int i = 0; i < 200000; i++) {
+            ranking.addRow(string("Product ") + to_string(i), i % 1000, 1715000000000LL + i);
+        }
+
+        auto start = chrono::high_resolution_clock::now();
+        ofstream out("test_ranking.csv", ios::binary);
+        serializer.write(&ranking, out);
+        out.close();
+        auto end = chrono::high_resolution_clock::now();
+        cout << "Serialized " << ranking.getRowCount() << " rows in "
+             << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms" << endl;
+
+        // Read the file back using the csv extraction strategy
+        DataRepo repo;
+        repo.setExtractionStrategy("csv");
+        DataFrame* loaded = repo.extractData("test_ranking.csv");
+        loaded->print(0, 2);
+        delete loaded;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
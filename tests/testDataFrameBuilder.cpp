@@ -0,0 +1,60 @@
+#include "../src/DataRepo.hpp"
+#include "../src/DataFrameBuilder.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+
+int main() {
+    try {
+        // Log entries as received by the server, each one ending with a line break
+        vector<string> report = {
+            "timestamp;type;content;extra_1;extra_2\n",
+            "1715000000000000000;User;Alice;ZOOM;VIEW_PRODUCT 12.\n",
+            "1715000000000000100;User;Bob;CLICK;CART with 12.\n",
+            "1715000000000000200;User;Alice;SCROLLING;HOME.\n"
+        };
+
+        // The entries are parsed in place into typed columns
+        DataRepo repo;
+        repo.setExtractionStrategy("list");
+        DataFrame* df = repo.extractLines(report, ';');
+        df->print();
+        df->printColumnTypes();
+        delete df;
+
+        // A builder can also be used directly and reused between reports
+        DataFrameBuilder builder;
+        builder.start("product;views;score", ';');
+        builder.addLine("1;10;4.5");
+        builder.addLine("2;7;3.0");
+        DataFrame* first = builder.build();
+        cout << "First report rows: " << first->getRowCount() << endl; // Output: First report rows: 2
+
+        builder.start("product;views;score", ';');
+        builder.addLine("3;1;5.0");
+        DataFrame* second = builder.build();
+        cout << "Second report rows: " << second->getRowCount() << endl; // Output: Second report rows: 1
+        delete first;
+        delete second;
+
+        // Signed values and exponents are numbers, and empty or missing fields take the default value
+        builder.start("delta;rate;views;name", ';');
+        builder.addLine("-5;1e3;10;Alice");
+        builder.addLine("+7;-2.5;;Bob");
+        builder.addLine("3;4.5");
+        DataFrame* signedReport = builder.build();
+        signedReport->print();
+        signedReport->printColumnTypes(); // Output: delta: i, name: NSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE, rate: f, views: i
+        delete signedReport;
+
+        // A value that does not match the type of its column is rejected
+        builder.start("product;views", ';');
+        builder.addLine("1;10");
+        builder.addLine("2;many");
+
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl; // Output: Exception occurred: Failed to parse value: many
+    }
+
+    return 0;
+}
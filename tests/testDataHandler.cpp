@@ -27,8 +27,22 @@ int main() {
     vector<Queue<DataFrame*>*> outputQueuesJoin = {&queueProdBuy};
 
     // Create a JoinHandler object
-    JoinHandler joinHandler(&queueProdBuy, outputQueuesJoin);
-    joinHandler.join(*df, "extra_2");
+    JoinHandler joinHandler(&queueJoin2, outputQueuesJoin);
+
+    // Queue a copy of the DataFrame and close the input, so the handler returns once it is processed
+    DataFrame* dfLeft = new DataFrame;
+    *dfLeft = DataFrame::deepCopy(*df);
+    queueJoin2.push(dfLeft);
+    queueJoin2.close();
+
+    // Join the DataFrame with the grades of the IDs
+    DataFrame grades({"ID", "Grade"});
+    grades.addRow(1, string("A"));
+    grades.addRow(2, string("B"));
+    joinHandler.join(grades, "ID");
+
+    // The handler closed its output queue after the last DataFrame
+    std::cout << "Output closed: " << (queueProdBuy.isClosed() ? "true" : "false") << std::endl; // Output: Output closed: true
 
     // Print the DataFrame
     queueProdBuy.pop()->print();
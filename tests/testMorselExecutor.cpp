@@ -0,0 +1,53 @@
+#include "../src/DataFrame.hpp"
+#include "../src/ThreadPool.hpp"
+#include <iostream>
+#include <atomic>
+
+int main() {
+    ThreadPool pool(4); // Output: Number of threads: 4
+    MorselExecutor morsels(pool.getExecutor(), pool.getThreadCount(), 1000);
+
+    // 100000 rows split into morsels of 1000 rows
+    atomic<size_t> rows{0};
+    morsels.forEachMorsel(100000, [&rows](size_t /*morsel*/, size_t begin, size_t end) { rows += end - begin; });
+    cout << "Morsels: " << morsels.getMorselCount(100000) << ", rows: " << rows << endl; // Output: Morsels: 100, rows: 100000
+
+    // A large DataFrame of events
+    vector<string> types = {"View", "Buy", "Audit"};
+    DataFrame df({"type", "product", "value"});
+    for (int i = 0; i < 30000; i++) {
+        df.addRow(types[i % 3], "P" + to_string(i % 7), i % 100);
+    }
+
+    // Sums and means add the partial results of the morsels
+    cout << "Sum: " << any_cast<int>(df.sum("value", morsels)) << endl; // Output: Sum: 1485000
+    cout << "Mean: " << df.mean("value", morsels) << endl; // Output: Mean: 49.5
+
+    // The statistics of every numeric column come from a single pass over the morsels
+    DataFrame summary = df.describe(morsels);
+    cout << "Described: " << summary.getValueAt(0, 0) << ", variance: " << summary.getValueAt(0, 6) << endl; // Output: Described: value, variance: 833.277776
+
+    // The counts and the groups are the ones of a single thread
+    DataFrame counts = df.valueCounts("type", morsels);
+    counts.print(); // Output: Audit 10000, Buy 10000, View 10000
+
+    DataFrame groups = df.groupBySum("product", "value", morsels);
+    cout << "Groups: " << groups.getRowCount() << ", P0: " << groups.getValueAt(0, 1) << endl; // Output: Groups: 7, P0: 212185
+
+    // The filter keeps the order of the rows
+    df.filterByColumn("type", string("Buy"), CompareOperation::EQUAL, morsels);
+    cout << "Buy rows: " << df.getRowCount() << ", first value: " << df.getValueAt(0, 2) << endl; // Output: Buy rows: 10000, first value: 1
+
+    // The morsels are sorted on their own, then merged
+    df.sortByColumn("value", false, morsels);
+    cout << "Largest: " << df.getValueAt(0, 2) << ", smallest: " << df.getValueAt(df.getRowCount() - 1, 2) << endl; // Output: Largest: 99, smallest: 0
+
+    // An error in a morsel reaches the caller
+    try {
+        df.sum("type", morsels);
+    } catch (const exception& e) {
+        cout << "Error: " << e.what() << endl; // Output: Error: Sum operation not supported for non-arithmetic types.
+    }
+
+    return 0;
+}
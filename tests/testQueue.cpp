@@ -1,4 +1,7 @@
 #include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
 #include "../src/Queue.hpp"
 
 int main() {
@@ -26,5 +29,68 @@ int main() {
     int queueSize = intQueue.size();
     std::cout << "Queue Size: " << queueSize << std::endl; // Output: Queue Size: 2
 
+    // Try to push without waiting: the queue takes one more element, then it is full
+    int element = 40;
+    bool pushed = intQueue.tryPush(element);
+    element = 50;
+    bool pushedFull = intQueue.tryPush(element);
+    std::cout << "Pushed: " << pushed << ", pushed when full: " << pushedFull << std::endl; // Output: Pushed: 1, pushed when full: 0
+
+    // Drain the queue without waiting
+    std::cout << "Drained: ";
+    while (intQueue.tryPop(element)) std::cout << element << " ";
+    std::cout << std::endl; // Output: Drained: 20 30 40
+
+    // A queue with one registered producer and one consumer switches to the single producer mode when sealed
+    Queue<int> edge(2);
+    edge.addProducer();
+    edge.addConsumer();
+    bool single = edge.seal();
+    std::cout << "Single producer: " << (single ? "true" : "false") << std::endl; // Output: Single producer: true
+
+    std::thread producer([&edge] {
+        for (int i = 1; i <= 5; i++) edge.push(i);
+    });
+    int total = 0;
+    for (int i = 0; i < 5; i++) total += edge.pop();
+    producer.join();
+    std::cout << "Total: " << total << std::endl; // Output: Total: 15
+
+    // Push a batch at once, then pop it in two batches
+    Queue<int> batchQueue(4);
+    batchQueue.pushBatch({1, 2, 3, 4});
+    std::vector<int> firstBatch = batchQueue.popBatch(3, std::chrono::milliseconds(100));
+    std::vector<int> rest;
+    size_t drained = batchQueue.drainTo(rest);
+    std::cout << "First batch: " << firstBatch.size() << ", drained: " << drained << std::endl; // Output: First batch: 3, drained: 1
+
+    // Popping a batch from an empty queue gives up after the timeout
+    std::vector<int> timedOut = batchQueue.popBatch(3, std::chrono::milliseconds(20));
+    std::cout << "Timed out batch: " << timedOut.size() << std::endl; // Output: Timed out batch: 0
+
+    // The timed push and pop give up once the timeout passes on a full or empty queue
+    Queue<int> bounded(1);
+    int first = 1;
+    int second = 2;
+    int popped = 0;
+    bool pushedFirst = bounded.tryPushFor(first, std::chrono::milliseconds(10));
+    bool pushedSecond = bounded.tryPushFor(second, std::chrono::milliseconds(10));
+    std::cout << "Timed pushes: " << pushedFirst << " " << pushedSecond << std::endl; // Output: Timed pushes: 1 0
+    bool poppedFirst = bounded.tryPopFor(popped, std::chrono::milliseconds(10));
+    bool poppedSecond = bounded.tryPopFor(popped, std::chrono::milliseconds(10));
+    std::cout << "Timed pops: " << poppedFirst << " " << poppedSecond << std::endl; // Output: Timed pops: 1 0
+
+    // Closing the queue ends its stream: the consumer gets the elements left, then pop returns false
+    Queue<int> stream(4);
+    std::thread streamProducer([&stream] {
+        for (int i = 1; i <= 3; i++) stream.push(i);
+        stream.close();
+    });
+    int received = 0;
+    int value;
+    while (stream.pop(value)) received++;
+    streamProducer.join();
+    std::cout << "Received before close: " << received << std::endl; // Output: Received before close: 3
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "../src/ResultStore.hpp"
+#include <iostream>
+#include <mutex>
+
+int main() {
+    try {
+        ResultStore store;
+
+        // A ranking and a latency result, as the pipeline keeps them
+        DataFrame* ranking = new DataFrame({"Value", "Count"});
+        ranking->addRow(string("VIEW_PRODUCT 3."), 5);
+        ranking->addRow(string("VIEW_PRODUCT 7."), 9);
+        ranking->addRow(string("VIEW_PRODUCT 1."), 2);
+        DataFrame* times = new DataFrame({"time"});
+        for (long long latency = 10; latency <= 100; latency += 10) times->addRow(latency);
+        mutex resultMutex;
+
+        store.addResult("ViewRanking", &ranking, &resultMutex);
+        store.addResult("times_ViewRanking", &times, &resultMutex);
+
+        // Top 2 of the live window
+        ResultQuery top2;
+        top2.topK = 2;
+        ResultSnapshot snapshot = store.query("ViewRanking", top2);
+        for (size_t i = 0; i < snapshot.values.size(); i++) {
+            cout << snapshot.values[i] << ": " << snapshot.counts[i] << endl;
+        }
+        cout << "Total: " << snapshot.total << ", windows: " << snapshot.windows << endl;
+        // Output:
+        // VIEW_PRODUCT 7.: 9
+        // VIEW_PRODUCT 3.: 5
+        // Total: 16, windows: 1
+
+        // Latency percentiles of the live window
+        LatencySummary latency = store.query("times_ViewRanking", ResultQuery()).latency;
+        cout << "Samples: " << latency.samples << ", mean: " << latency.mean << ", p50: " << latency.p50
+             << ", p90: " << latency.p90 << ", max: " << latency.max << endl;
+        // Output: Samples: 10, mean: 55, p50: 60, p90: 100, max: 100
+
+        // A trigger closes the window: the store archives it and the pipeline starts a new one
+        {
+            lock_guard<mutex> lock(resultMutex);
+            store.archive("ViewRanking", *ranking);
+            delete ranking;
+            ranking = new DataFrame({"Value", "Count"});
+            ranking->addRow(string("VIEW_PRODUCT 1."), 20);
+        }
+
+        // The closed and the live windows are merged
+        snapshot = store.query("ViewRanking", top2);
+        cout << "Top: " << snapshot.values[0] << " with " << snapshot.counts[0] << ", windows: " << snapshot.windows << endl;
+        // Output: Top: VIEW_PRODUCT 1. with 22, windows: 2
+
+        // A time range that ends before the live window only sees the closed one
+        ResultQuery past;
+        past.fromMs = 1;
+        past.toMs = 2;
+        snapshot = store.query("ViewRanking", past);
+        cout << "Windows before the store started: " << snapshot.windows << endl; // Output: Windows before the store started: 0
+
+        // Once the pipeline detaches the live window, only the closed one is left
+        store.detachLive("ViewRanking");
+        snapshot = store.query("ViewRanking", top2);
+        cout << "Top: " << snapshot.values[0] << " with " << snapshot.counts[0] << ", windows: " << snapshot.windows << endl;
+        // Output: Top: VIEW_PRODUCT 7. with 9, windows: 1
+
+        // A trigger takes the window and archives it in one step
+        DataFrame* closedTimes = store.closeWindow("times_ViewRanking", &times, &resultMutex);
+        latency = store.query("times_ViewRanking", ResultQuery()).latency;
+        cout << "Closed samples: " << closedTimes->getRowCount() << ", queried samples: " << latency.samples
+             << ", live: " << (times == nullptr ? "empty" : "open") << endl;
+        // Output: Closed samples: 10, queried samples: 10, live: empty
+        delete closedTimes;
+
+        // Unknown results are reported
+        store.query("Unknown", ResultQuery());
+
+        delete ranking;
+        delete times;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception occurred: " << e.what() << std::endl; // Output: Exception occurred: Unknown result: Unknown
+    }
+
+    return 0;
+}
@@ -25,5 +25,26 @@ int main() {
     worker2.join();
     worker3.join();
 
+    // Without a free permit, the try variants give up instead of blocking
+    Semaphore permits(0, 4);
+    std::cout << std::boolalpha;
+    std::cout << "Try acquire: " << permits.tryAcquire() << std::endl; // Output: Try acquire: false
+    std::cout << "Try acquire for 10 ms: " << permits.tryAcquireFor(std::chrono::milliseconds(10)) << std::endl; // Output: Try acquire for 10 ms: false
+
+    // A batch release wakes as many waiting threads
+    std::thread waiter1([&permits] { permits.acquire(); });
+    std::thread waiter2([&permits] { permits.acquire(); });
+    permits.release(3);
+    waiter1.join();
+    waiter2.join();
+    std::cout << "Permits left: " << permits.getCount() << std::endl; // Output: Permits left: 1
+
+    // Releasing above the maximum count is an error, instead of blocking the releasing thread
+    try {
+        permits.release(4);
+    } catch (const std::runtime_error& e) {
+        std::cout << "Caught: " << e.what() << std::endl; // Output: Caught: Semaphore released above its maximum count
+    }
+
     return 0;
 }
\ No newline at end of file
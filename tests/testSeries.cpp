@@ -83,6 +83,17 @@ int main() {
     // cout << "Mean of stringSeries: " << any_cast<double>(stringSeries.mean()) << endl; //-> Throws a runtime error
     cout << endl;
 
+    // Test the precision of the sum: ten million times 0.1 in single precision
+    Series<float> floatSeries("Float Series", vector<float>(10000000, 0.1f));
+    cout << "Sum of floatSeries: " << any_cast<float>(floatSeries.sum()) << endl; // Output: Sum of floatSeries: 1e+06
+    cout << "Naive sum of floatSeries: " << accumulate(floatSeries.getData().begin(), floatSeries.getData().end(), 0.0f) << endl; // Output: Naive sum of floatSeries: 1.08794e+06
+
+    // Test the describe method, which gives all the statistics in one pass
+    SeriesStats stats = intSeries.describe(0, intSeries.size());
+    cout << "Count: " << stats.count << ", sum: " << stats.getSum() << ", mean: " << stats.getMean() << ", min: " << stats.getMin()
+         << ", max: " << stats.getMax() << ", variance: " << stats.getVariance() << endl; // Output: Count: 3, sum: 30, mean: 10, min: 5, max: 15, variance: 25
+    cout << endl;
+
     Series<int> mySeries("Sample Series");
     mySeries.add(1);
     mySeries.add(2);
@@ -0,0 +1,106 @@
+#include "../src/StageSupervisor.hpp"
+#include <iostream>
+#include <atomic>
+
+// A stage that takes 5 ms per DataFrame, the bottleneck of the pipeline
+class SlowHandler : public DataHandler {
+public:
+    SlowHandler(Queue<DataFrame*> *inputQueue, std::vector<Queue<DataFrame*>*> outputQueues)
+        : DataHandler(inputQueue, outputQueues) {};
+
+    void process() {
+        processInput([](DataFrame* df) {
+            this_thread::sleep_for(chrono::milliseconds(5));
+            return df;
+        });
+    }
+};
+
+// A stage that passes the DataFrames on as they are
+class PassHandler : public DataHandler {
+public:
+    PassHandler(Queue<DataFrame*> *inputQueue, std::vector<Queue<DataFrame*>*> outputQueues)
+        : DataHandler(inputQueue, outputQueues) {};
+
+    void process() {
+        processInput([](DataFrame* df) { return df; });
+    }
+};
+
+int main() {
+    Queue<DataFrame*> input(20);
+    Queue<DataFrame*> output(100);
+    vector<Queue<DataFrame*>*> outputQueues = {&output};
+
+    // The slow stage may get up to 3 replicas, which keeps its queues in the multiple producer mode
+    SlowHandler slow(&input, outputQueues);
+    slow.setMaxReplicas(3);
+    input.seal();
+    output.seal();
+
+    ThreadPool pool(5);
+    StageSupervisor supervisor(pool, 3, chrono::milliseconds(10));
+    auto run = [&slow] { slow.process(); };
+    supervisor.addStage(&slow, run);
+
+    Future<void> stage = pool.submit(run);
+    supervisor.start();
+
+    // Count the DataFrames that come out, until the stage closes its output
+    Future<int> received = pool.submit([&output] {
+        int count = 0;
+        DataFrame* df;
+        while (output.pop(df)) {
+            delete df;
+            count++;
+        }
+        return count;
+    });
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 200; i++) {
+        DataFrame* df = new DataFrame({"Count"});
+        df->addRow(i);
+        input.push(df);
+    }
+    input.close();
+
+    stage.get();
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    supervisor.stop();
+
+    cout << "Received: " << received.get() << endl; // Output: Received: 200
+    cout << "Replicas started: " << (supervisor.getReplicasStarted() > 0 ? "yes" : "no") << endl; // Output: Replicas started: yes
+    cout << "Faster than a single thread: " << (elapsed < 200 * 5 ? "yes" : "no") << endl; // Output: Faster than a single thread: yes
+
+    // Replicas leave while the input closes under the main thread: whichever runner leaves last ends the output
+    int ended = 0;
+    for (int round = 0; round < 300; round++) {
+        Queue<DataFrame*> passInput(10);
+        Queue<DataFrame*> passOutput(100);
+        PassHandler pass(&passInput, {&passOutput});
+        pass.setMaxReplicas(2);
+
+        vector<thread> runners;
+        for (int i = 0; i < 3; i++) runners.emplace_back([&pass] { pass.process(); });
+        for (int i = 0; i < 5; i++) {
+            DataFrame* df = new DataFrame({"Count"});
+            df->addRow(i);
+            passInput.push(df);
+        }
+        passInput.close();
+
+        // A stream that never ends stops the count after 2 s
+        int count = 0;
+        DataFrame* df;
+        while (passOutput.tryPopFor(df, chrono::milliseconds(2000))) {
+            delete df;
+            count++;
+        }
+        if (count == 5 && passOutput.isClosed()) ended++;
+        for (auto& runner : runners) runner.join();
+    }
+    cout << "Rounds ended: " << ended << endl; // Output: Rounds ended: 300
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../src/TaskGraph.hpp"
+#include <iostream>
+#include <atomic>
+
+int main() {
+    ThreadPool pool(4);
+
+    // Two extractions feed a join, which feeds a report: the join waits for both extractions
+    atomic<int> rows{0};
+    TaskGraph graph;
+    TaskGraph::NodeId extractUsers = graph.addNode([&rows] { rows += 10; }, "extract users");
+    TaskGraph::NodeId extractOrders = graph.addNode([&rows] { rows += 20; }, "extract orders");
+    TaskGraph::NodeId join = graph.addNode([&rows] { cout << "Join sees " << rows << " rows" << endl; }, "join");
+    TaskGraph::NodeId report = graph.addNode([] { cout << "Report written" << endl; }, "report");
+    graph.addEdge(extractUsers, join);
+    graph.addEdge(extractOrders, join);
+    graph.addEdge(join, report);
+
+    graph.run(pool).get();
+    // Output: Join sees 30 rows
+    // Output: Report written
+
+    // A failed node skips the nodes that depend on it
+    TaskGraph failing;
+    TaskGraph::NodeId broken = failing.addNode([] { throw runtime_error("Extraction failed"); }, "broken");
+    TaskGraph::NodeId after = failing.addNode([] { cout << "Never printed" << endl; }, "after");
+    failing.addEdge(broken, after);
+    try {
+        failing.run(pool).get();
+    } catch (const exception& e) {
+        cout << "Caught: " << e.what() << endl; // Output: Caught: Extraction failed
+    }
+
+    // A cycle is rejected before anything runs
+    TaskGraph cyclic;
+    TaskGraph::NodeId first = cyclic.addNode([] {}, "first");
+    TaskGraph::NodeId second = cyclic.addNode([] {}, "second");
+    cyclic.addEdge(first, second);
+    cyclic.addEdge(second, first);
+    try {
+        cyclic.run(pool);
+    } catch (const exception& e) {
+        cout << "Caught: " << e.what() << endl; // Output: Caught: Task graph has a cycle through first
+    }
+
+    return 0;
+}
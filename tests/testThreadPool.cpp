@@ -1,5 +1,6 @@
 #include "../src/ThreadPool.hpp"
 #include <iostream>
+#include <atomic>
 
 using namespace std;
 
@@ -26,5 +27,34 @@ int main() {
     pool.addTask(task1);
     pool.addTask(task0, 2);
 
+    // Tasks added by a task go to the deque of its thread, where idle threads steal them
+    atomic<int> subtasks{0};
+    pool.submit([&pool, &subtasks] {
+        for (int i = 0; i < 100; i++) pool.submit([&subtasks] { subtasks++; });
+    });
+
+    // Each task runs once: wait for all of them
+    pool.wait();
+    printf("Subtasks executed: %d\n", subtasks.load()); // Output: Subtasks executed: 100
+
+    // Submit gives the Future of the result, which can be continued on the pool
+    Future<int> answer = pool.submit([] { return 6 * 7; });
+    Future<string> text = answer.then([](int value) { return "The answer is " + to_string(value); });
+    printf("%s\n", text.get().c_str()); // Output: The answer is 42
+
+    // Wait for several results at once
+    vector<Future<int>> squares;
+    for (int i = 1; i <= 4; i++) squares.push_back(pool.submit([i] { return i * i; }));
+    vector<int> results = whenAll(squares).get();
+    printf("Squares: %d %d %d %d\n", results[0], results[1], results[2], results[3]); // Output: Squares: 1 4 9 16
+
+    // The exception of a job is thrown by get
+    Future<int> failed = pool.submit([]() -> int { throw runtime_error("Job failed"); });
+    try {
+        failed.get();
+    } catch (const exception& e) {
+        printf("Caught: %s\n", e.what()); // Output: Caught: Job failed
+    }
+
     return 0;
 }
\ No newline at end of file
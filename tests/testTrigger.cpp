@@ -1,20 +1,96 @@
 #include <iostream>
+#include <atomic>
 #include "../src/TimerTrigger.hpp"
 #include "../src/RequestTrigger.hpp"
+#include "../src/ThreadPool.hpp"
 using namespace std;
 
+// Counts the notifications it gets
+class CountingObserver : public Observer {
+public:
+    atomic<int> timeUpdates{0};
+    atomic<int> requestUpdates{0};
+    chrono::milliseconds work;
+
+    CountingObserver(chrono::milliseconds work = chrono::milliseconds(0)) : work(work) {}
+
+    void updateOnTimeTrigger() override {
+        timeUpdates++;
+        this_thread::sleep_for(work);
+    }
+
+    void updateOnRequestTrigger() override {
+        requestUpdates++;
+    }
+};
+
 int main() {
-    // Example usage
-    TimerTrigger timer(std::chrono::seconds(1));
-    RequestTrigger request(std::chrono::seconds(2), std::chrono::seconds(5));
+    ThreadPool pool(2); // Output: Number of threads: 2
 
-    timer.activate();
-    request.activate();
+    // A timer whose observer takes most of the interval keeps its period: 10 ticks in 1 second
+    auto slow = make_shared<CountingObserver>(chrono::milliseconds(80));
+    TimerTrigger timer(chrono::milliseconds(100));
+    timer.setExecutor(pool.getExecutor());
+    timer.addObserver(slow);
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    auto requests = make_shared<CountingObserver>();
+    RequestTrigger request(chrono::milliseconds(50), chrono::milliseconds(150));
+    request.addObserver(requests);
 
+    timer.activate();
+    request.activate();
+    this_thread::sleep_for(chrono::milliseconds(950));
     timer.deactivate();
     request.deactivate();
+    cout << "Timer notifications: " << slow->timeUpdates << endl; // Output: Timer notifications: 10
+    cout << "Request notifications: " << (requests->requestUpdates >= 5 ? "at least 5" : "too few") << endl; // Output: Request notifications: at least 5
+
+    // Nothing fires once the triggers are deactivated
+    int before = slow->timeUpdates;
+    this_thread::sleep_for(chrono::milliseconds(250));
+    cout << "After deactivation: " << slow->timeUpdates - before << endl; // Output: After deactivation: 0
+
+    // An observer slower than the interval skips the deadlines it is still busy for
+    auto busy = make_shared<CountingObserver>(chrono::milliseconds(250));
+    TimerTrigger fast(chrono::milliseconds(100));
+    fast.setExecutor(pool.getExecutor());
+    fast.addObserver(busy);
+    fast.activate();
+    this_thread::sleep_for(chrono::milliseconds(550));
+    fast.deactivate();
+    Trigger::ObserverMetrics busyMetrics = fast.getObserverMetrics()[0];
+    cout << "Busy notifications: " << busyMetrics.notifications << ", skipped: " << busyMetrics.skipped << endl; // Output: Busy notifications: 2, skipped: 4
+
+    // The observers run side by side: a slow one neither delays nor blocks a fast one, and is reported
+    auto stuck = make_shared<CountingObserver>(chrono::milliseconds(350));
+    auto quick = make_shared<CountingObserver>(chrono::milliseconds(5));
+    TimerTrigger fanOut(chrono::milliseconds(100));
+    fanOut.setExecutor(pool.getExecutor());
+    fanOut.addObserver(stuck, chrono::milliseconds(200)); // Output: Observer still running after 200 ms
+    fanOut.addObserver(quick, chrono::milliseconds(200));
+    fanOut.activate();
+    this_thread::sleep_for(chrono::milliseconds(350));
+    fanOut.deactivate();
+    vector<Trigger::ObserverMetrics> metrics = fanOut.getObserverMetrics();
+    cout << "Slow observer: " << metrics[0].notifications << " run, " << metrics[0].skipped << " skipped, "
+         << metrics[0].timeouts << " timeout" << endl; // Output: Slow observer: 1 run, 3 skipped, 1 timeout
+    cout << "Fast observer: " << metrics[1].notifications << " runs, " << metrics[1].timeouts << " timeouts, under 50 ms: "
+         << boolalpha << (metrics[1].maxDuration < chrono::milliseconds(50)) << endl; // Output: Fast observer: 4 runs, 0 timeouts, under 50 ms: true
+
+    // Thousands of triggers share the thread of one wheel
+    TimerWheel wheel;
+    auto shared = make_shared<CountingObserver>();
+    vector<unique_ptr<TimerTrigger>> triggers;
+    for (int i = 0; i < 2000; i++) {
+        triggers.push_back(make_unique<TimerTrigger>(chrono::milliseconds(100), wheel));
+        triggers.back()->setExecutor(pool.getExecutor());
+        triggers.back()->addObserver(shared);
+        triggers.back()->activate();
+    }
+    this_thread::sleep_for(chrono::milliseconds(250));
+    for (auto& trigger : triggers) trigger->deactivate();
+    cout << "Shared wheel notifications: " << shared->timeUpdates << endl; // Output: Shared wheel notifications: 6000
+    cout << "Timers left: " << wheel.size() << endl; // Output: Timers left: 0
 
     return 0;
 }
@@ -34,6 +34,10 @@ int main(int argc, char* argv[]) {
         queueInDC2.push(dfCopy);
     }
 
+    // All the logs are queued: close the inputs, so the handlers end once they processed them
+    queueInDC1.close();
+    queueInDC2.close();
+
     // Número de produtos visualizados por minuto:
     Queue<DataFrame*> queueUser(10);
     vector<Queue<DataFrame*>*> outputQueuesUser = {&queueUser};